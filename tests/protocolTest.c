@@ -0,0 +1,335 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/* #define section*/
+
+//Protocol defines, as in tictactoeServer.c
+#define LEGACY_VERSION 8
+#define COMPACT_VERSION 9
+#define MESSAGE_SIZE 1000
+#define COMPACT_HEADER_SIZE 2
+#define NEW_GAME_COMMAND 0
+#define MOVE_COMMAND 1
+#define RECONNECT_COMMAND 3
+#define GAME_ERROR 2
+#define MOVE_HIGH_FIELD 7
+#define RECONNECT_BOARD_FIELD 7
+#define REPLY_FIELDS 7
+#define MAX_FIELDS 16
+
+//Test defines
+#define SERVER_START_WAITS 100
+#define SERVER_START_WAIT_US 20000
+#define RECEIVE_TIMEOUT 5
+
+pid_t globServer = -1;
+int globPort = 0;
+char globStore[64];
+int globFailures = 0;
+
+//Function declarations
+int pickPort();
+void startServer(char *serverPath);
+void stopServer();
+int connectServer();
+void sendFields(int connectedSocket, unsigned char fields[MAX_FIELDS], int fieldCount, int legacy);
+int readReply(int connectedSocket, unsigned char reply[REPLY_FIELDS], int legacy);
+void check(int passed, char *name);
+void testMoveHighByte(int legacy);
+void testMoveAfterReconnect();
+
+/**
+ * Protocol regression tests. Starts the server given as the only argument on
+ * a free port with a session store of its own, runs every test against it
+ * and stops it.
+ * @param argc: Number of args.
+ * @param *argv[]: The server binary.
+ * @retval 0 if every test passed; 1 otherwise.
+ */
+int main(int argc, char *argv[])
+{
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s <server binary>\n", argv[0]);
+        return 1;
+    }
+
+    startServer(argv[1]);
+
+    //Classic games ignore the m,n,k move high byte, whatever a client leaves there
+    testMoveHighByte(1);
+    testMoveHighByte(0);
+    testMoveAfterReconnect();
+
+    stopServer();
+    printf("%s\n", globFailures == 0 ? "All tests passed" : "Tests failed");
+    return globFailures == 0 ? 0 : 1;
+}
+
+/**
+ * Find a TCP port nothing listens on.
+ * @retval The port; exit(1) if error.
+ */
+int pickPort()
+{
+    struct sockaddr_in address;
+    socklen_t addressLength = sizeof(address);
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int probe = socket(AF_INET, SOCK_STREAM, 0);
+    if (probe < 0 || bind(probe, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+        getsockname(probe, (struct sockaddr *)&address, &addressLength) != 0)
+    {
+        perror("Error finding a free port");
+        exit(1);
+    }
+    close(probe);
+    return ntohs(address.sin_port);
+}
+
+/**
+ * Start the server with its output discarded and wait until it accepts connections.
+ * @param  *serverPath: The server binary.
+ * @retval None; exit(1) if it does not come up.
+ */
+void startServer(char *serverPath)
+{
+    char port[16];
+    globPort = pickPort();
+    snprintf(port, sizeof(port), "%d", globPort);
+    snprintf(globStore, sizeof(globStore), "/tictactoe-test-%d", (int)getpid());
+
+    globServer = fork();
+    if (globServer == 0)
+    {
+        int devNull = open("/dev/null", O_WRONLY);
+        dup2(devNull, STDOUT_FILENO);
+        dup2(devNull, STDERR_FILENO);
+        execl(serverPath, serverPath, "-s", globStore, port, (char *)NULL);
+        _exit(127);
+    }
+
+    int wait;
+    for (wait = 0; wait < SERVER_START_WAITS; wait++)
+    {
+        usleep(SERVER_START_WAIT_US);
+        int connectedSocket = connectServer();
+        if (connectedSocket >= 0)
+        {
+            close(connectedSocket);
+            return;
+        }
+    }
+    fprintf(stderr, "Error: %s did not start on port %d\n", serverPath, globPort);
+    stopServer();
+    exit(1);
+}
+
+/**
+ * Stop the server and remove its session store.
+ * @retval None.
+ */
+void stopServer()
+{
+    if (globServer > 0)
+    {
+        kill(globServer, SIGTERM);
+        waitpid(globServer, NULL, 0);
+        globServer = -1;
+    }
+    shm_unlink(globStore);
+}
+
+/**
+ * Connect to the server, with a receive timeout so a missing reply fails the test.
+ * @retval The socket; -1 if the connection failed.
+ */
+int connectServer()
+{
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(globPort);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int connectedSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if (connectedSocket < 0)
+    {
+        return -1;
+    }
+    if (connect(connectedSocket, (struct sockaddr *)&address, sizeof(address)) != 0)
+    {
+        close(connectedSocket);
+        return -1;
+    }
+
+    struct timeval tv;
+    tv.tv_sec = RECEIVE_TIMEOUT;
+    tv.tv_usec = 0;
+    setsockopt(connectedSocket, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    return connectedSocket;
+}
+
+/**
+ * Send message fields as a legacy 1000 byte frame, or a compact frame of fieldCount fields.
+ * @param  connectedSocket: The connection.
+ * @param  fields[MAX_FIELDS]: The fields; fields[0] is the version.
+ * @param  fieldCount: Fields to send in a compact frame, including the version.
+ * @param  legacy: 1 for a legacy frame.
+ * @retval None; exit(1) if error.
+ */
+void sendFields(int connectedSocket, unsigned char fields[MAX_FIELDS], int fieldCount, int legacy)
+{
+    unsigned char frame[MESSAGE_SIZE];
+    int length;
+    memset(frame, 0, sizeof(frame));
+    if (legacy)
+    {
+        memcpy(frame, fields, MAX_FIELDS);
+        length = MESSAGE_SIZE;
+    }
+    else
+    {
+        frame[0] = fields[0];
+        frame[1] = COMPACT_HEADER_SIZE + fieldCount - 1;
+        memcpy(&frame[COMPACT_HEADER_SIZE], &fields[1], fieldCount - 1);
+        length = frame[1];
+    }
+    if (send(connectedSocket, frame, length, 0) != length)
+    {
+        perror("Error sending to server");
+        exit(1);
+    }
+}
+
+/**
+ * Read one reply and return its first REPLY_FIELDS fields.
+ * @param  connectedSocket: The connection.
+ * @param  reply[REPLY_FIELDS]: Filled with the reply.
+ * @param  legacy: 1 if the server answers this game in legacy frames.
+ * @retval 0 if a reply arrived; -1 if the server closed or did not answer.
+ */
+int readReply(int connectedSocket, unsigned char reply[REPLY_FIELDS], int legacy)
+{
+    unsigned char frame[MESSAGE_SIZE];
+    int expected = legacy ? MESSAGE_SIZE : COMPACT_HEADER_SIZE;
+    if (recv(connectedSocket, frame, expected, MSG_WAITALL) != expected)
+    {
+        return -1;
+    }
+    if (legacy)
+    {
+        memcpy(reply, frame, REPLY_FIELDS);
+        return 0;
+    }
+    int rest = frame[1] - COMPACT_HEADER_SIZE;
+    if (rest < REPLY_FIELDS - 1 || recv(connectedSocket, &frame[COMPACT_HEADER_SIZE], rest, MSG_WAITALL) != rest)
+    {
+        return -1;
+    }
+    reply[0] = frame[0];
+    memcpy(&reply[1], &frame[COMPACT_HEADER_SIZE], REPLY_FIELDS - 1);
+    return 0;
+}
+
+/**
+ * Report one test result.
+ * @param  passed: Whether the test passed.
+ * @param  *name: The test.
+ * @retval None.
+ */
+void check(int passed, char *name)
+{
+    printf("%s: %s\n", passed ? "PASS" : "FAIL", name);
+    if (!passed)
+    {
+        globFailures++;
+    }
+}
+
+/**
+ * A classic move carrying a nonzero byte 7 is still answered as a move.
+ * Byte 7 is the high byte of m,n,k moves, and must not be read for classic games.
+ * @param  legacy: 1 to play in legacy frames, 0 in compact frames.
+ * @retval None.
+ */
+void testMoveHighByte(int legacy)
+{
+    unsigned char fields[MAX_FIELDS];
+    unsigned char reply[REPLY_FIELDS];
+    int connectedSocket = connectServer();
+    int version = legacy ? LEGACY_VERSION : COMPACT_VERSION;
+
+    memset(fields, 0, sizeof(fields));
+    fields[0] = version;
+    fields[4] = NEW_GAME_COMMAND;
+    fields[6] = 1;
+    sendFields(connectedSocket, fields, REPLY_FIELDS, legacy);
+    int started = readReply(connectedSocket, reply, legacy) == 0 && reply[2] != GAME_ERROR;
+
+    memset(fields, 0, sizeof(fields));
+    fields[0] = version;
+    fields[1] = 1;
+    fields[4] = MOVE_COMMAND;
+    fields[5] = reply[5];
+    fields[6] = 3;
+    fields[MOVE_HIGH_FIELD] = 5;
+    sendFields(connectedSocket, fields, MOVE_HIGH_FIELD + 1, legacy);
+    int answered = started && readReply(connectedSocket, reply, legacy) == 0;
+
+    check(answered && reply[2] != GAME_ERROR && reply[4] == MOVE_COMMAND && reply[6] == 4,
+          legacy ? "legacy classic move ignores byte 7" : "compact classic move ignores byte 7");
+    close(connectedSocket);
+}
+
+/**
+ * A legacy client reuses its buffer after a RECONNECT, so its next move still
+ * carries the first board square in byte 7. That move must be played.
+ * @retval None.
+ */
+void testMoveAfterReconnect()
+{
+    unsigned char fields[MAX_FIELDS];
+    unsigned char reply[REPLY_FIELDS];
+    int connectedSocket = connectServer();
+
+    //Client on squares 1 and 9, server on 5, the server's reply never received
+    memset(fields, 0, sizeof(fields));
+    fields[0] = LEGACY_VERSION;
+    fields[4] = RECONNECT_COMMAND;
+    fields[6] = 5;
+    fields[RECONNECT_BOARD_FIELD + 0] = 1;
+    fields[RECONNECT_BOARD_FIELD + 4] = 2;
+    fields[RECONNECT_BOARD_FIELD + 8] = 1;
+    sendFields(connectedSocket, fields, MAX_FIELDS, 1);
+    int resumed = readReply(connectedSocket, reply, 1) == 0 && reply[2] != GAME_ERROR && reply[1] != 0;
+
+    //Next free square, sent from the same buffer
+    int square = 1;
+    while (square == 1 || square == 5 || square == 9 || square == reply[1])
+    {
+        square++;
+    }
+    fields[1] = square;
+    fields[4] = MOVE_COMMAND;
+    fields[5] = reply[5];
+    fields[6] = 7;
+    sendFields(connectedSocket, fields, MAX_FIELDS, 1);
+    int answered = resumed && readReply(connectedSocket, reply, 1) == 0;
+
+    check(answered && reply[2] != GAME_ERROR && reply[4] == MOVE_COMMAND, "legacy move after reconnect ignores stale board byte");
+    close(connectedSocket);
+}
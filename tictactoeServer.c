@@ -1,1259 +1,8895 @@
-/**
- * Server code for project 1
- */
-
-#include <stdlib.h>
-#include <stdio.h>
-#include <string.h>
-#include <errno.h>
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
-#include <unistd.h>
-#include <sys/stat.h>
-#include <sys/time.h>
-#include <sys/select.h>
-
-//Constants
-#define ROWS 3
-#define COLUMNS 3
-#define MAX_MESSSAGE_SIZE 1000
-#define MESSAGE_SIZE 1000
-#define MIN_MESSAGE_SIZE 1000
-#define EARLIEST_VERSION 7
-#define VERSION 8
-#define TIMEOUT 10
-#define PACKET_RETRIES 3
-#define BLOCKING_READ_TIME 1
-#define MAX_NUMBER_OF_ACTIVE_GAMES 3
-
-//Flags and Codes
-#define GAME_IN_PROGRESS 0
-#define GAME_COMPLETE 1
-#define GAME_ERROR 2
-#define SERVER_PLAYER 1
-#define CLIENT_PLAYER 2
-#define DRAW 1
-#define CLIENT_WIN 2
-#define SERVER_WIN 3
-#define TCP_FLAGS 0
-#define DATAGRAM_FLAGS 0
-#define NEW_GAME_COMMAND 0
-#define MOVE_COMMAND 1
-#define END_GAME_COMMAND 2
-#define RECONNECT_COMMAND 3
-#define ERROR_OUT_OF_RESOURCES 1
-#define ERROR_MALFORMED_REQUEST 2
-#define ERROR_SERVER_SHUTDOWN 3
-#define ERROR_TIMEOUT 4
-#define ERROR_RETRY 5
-
-//Multicast defines
-#define MULTICAST_IP "239.0.0.7"
-#define MULTICAST_PORT 1818
-
-//Debug defines
-#define SENT 1
-#define RECEIVED 2
-#define ORIGINAL 1
-#define REPEAT 2
-#define DEBUG_MODE 0 //Switch to 0 to disable packet output
-
-/**
- * Struct for a tictactoe game.
- * active: 0 if game inactive (junk); 1 if active game.
- * socket: The client that is playing the game.
- * board: The game board.
- * timeLastMessage: The time of the last move made by client.
- */
-struct tttGame
-{
-
-    unsigned char active;
-    struct sockaddr_in address;
-    char board[ROWS][COLUMNS];
-    unsigned char lastMessage[MESSAGE_SIZE];
-    //TODO: Make sure this wraps properly
-    unsigned char sequenceNumber;
-    int connectedSocket;
-};
-
-//Array of tttGames
-struct tttGame *tttGames;
-
-//Global variables for shutdown
-int globTCPSocket;
-int globMulticastSocket;
-unsigned short globServerPort;
-
-//Function declarations
-int verifyArgs(int iCount);
-void initTCPSocket(char *strPort);
-long convertPort(char *strPort);
-int recvMessage(unsigned char messageBuffer[MESSAGE_SIZE], int gameNumber);
-void sendMessage(int command, int move, int complete, int completeDescriptor, int gameNumber, unsigned char sequenceNumber, int connectedSocket, unsigned char messageStore[MESSAGE_SIZE]);
-void initSharedState(char board[ROWS][COLUMNS]);
-int placeMove(char board[ROWS][COLUMNS], int move, int player);
-int checkWin(char board[ROWS][COLUMNS], int player);
-int placeServerMove(char board[ROWS][COLUMNS]);
-void closeSockets();
-void allocateGame(int connectedSocket, struct sockaddr_in clientAddress);
-void startGame(int gameNumber, unsigned char clientSequenceNum);
-int findGameByAddress(struct sockaddr_in address);
-int findGameBySocket(int connectedSocket);
-void handleMove(int activeGame, int command, int clientGameNum, int move, int clientComplete, int clientCompleteDescriptor, unsigned char clientSequenceNum);
-int checkTimeout(struct tttGame session);
-void initGamesArray();
-void timeoutGames();
-void sendPacket(unsigned char packet[MESSAGE_SIZE], int connectedSocket);
-void handleEndgame(int gameNumber, int win, int complete, int clientComplete, int clientCompleteDescriptor, unsigned char clientSequenceNum);
-void setupSocketSets(fd_set *readSet, fd_set *exceptSet);
-void onSelect(fd_set *readSet, fd_set *exceptSet);
-void acceptClient();
-void debugPacket(unsigned char buf[MAX_MESSSAGE_SIZE], int sentOrReceived, int repeatOrNot);
-void initMulticastSocket();
-void handleMulticast();
-void reconnectGame(int activeGame, unsigned char boardBytes[9]);
-void handleMoveAfterPlaced(struct tttGame *clientGame, int clientComplete, int activeGame, int clientCompleteDescriptor, unsigned char clientSequenceNum, int clientGameNum);
-void print_board(char board[ROWS][COLUMNS]);
-
-/**
- * Starting point for program.
- * @param argc: Number of args (number of elements in argv).
- * @param *argv[]: Array of args.
- * @retval 0; exit(-1) if error.
- */
-int main(int argc, char *argv[])
-{
-
-    //Verify correct usage
-    verifyArgs(argc);
-
-    //Initialize datagram socket
-    initTCPSocket(argv[1]);
-    initMulticastSocket();
-
-    //Initialize array of games
-    initGamesArray();
-
-    //Print info
-    printf("Protocol Version: %d\n", VERSION);
-    printf("Setup Success, Listening...\n\n");
-
-    //Declare set of socket descriptors for read and exceptions
-    fd_set socketFdReadSet;
-    fd_set socketFdExceptSet;
-
-    //Recieve messages in loop
-    while (1)
-    {
-        //Setup timeout for select()
-        struct timeval tv;
-        tv.tv_sec = BLOCKING_READ_TIME;
-        tv.tv_usec = 0;
-
-        //Add all socket descriptors to sets
-        setupSocketSets(&socketFdReadSet, &socketFdExceptSet);
-
-        //Select ready sockets
-        int selectResult = select(globMulticastSocket + MAX_NUMBER_OF_ACTIVE_GAMES + 1, &socketFdReadSet, NULL, &socketFdExceptSet, &tv);
-        if (selectResult == -1)
-        {
-            perror("Error: Select failed");
-            exit(-1);
-        }
-        else if (select > 0)
-        {
-            //Something is ready
-            onSelect(&socketFdReadSet, &socketFdExceptSet);
-        }
-        //printf("Waiting on clients")
-    }
-
-    //Execution never gets here
-    return 0;
-}
-
-/**
- * Verifies there are the correct number of command-line args.
- * @param iCount: Number of args passed.
- * @retval 0 success; exit(-1) if error.
- */
-int verifyArgs(int iCount)
-{
-    if (iCount != 2)
-    {
-        perror("Error: Incorrect number of args. Consult readme for usage.");
-        exit(-1);
-    }
-    else
-    {
-        return 0;
-    }
-}
-
-/**
- * Opens and binds socket.
- * @param *strPort: The port to bind to.
- * @retval None; exit(-1) if error.
- */
-void initTCPSocket(char *strPort)
-{
-    globServerPort = convertPort(strPort);
-
-    struct sockaddr_in socketAddressServer;
-    socketAddressServer.sin_family = AF_INET;
-    socketAddressServer.sin_port = htons(globServerPort);
-    socketAddressServer.sin_addr.s_addr = INADDR_ANY;
-
-    globTCPSocket = socket(AF_INET, SOCK_STREAM, 0);
-
-    if (globTCPSocket == 0)
-    {
-        perror("Error: Problem opening socket");
-        exit(-1);
-    }
-
-    int bindSuccess = bind(globTCPSocket, (struct sockaddr *)&socketAddressServer, sizeof(socketAddressServer));
-
-    if (bindSuccess != 0)
-    {
-        perror("Error: Problem binding socket");
-        close(globTCPSocket);
-        exit(-1);
-    }
-
-    //Start listening
-    int listenSuccess = listen(globTCPSocket, 1);
-
-    if (listenSuccess != 0)
-    {
-        perror("Error: Problem starting socket listen");
-        close(globTCPSocket);
-        exit(-1);
-    }
-}
-
-/**
- * Parses the passed in string to a long.
- * @param *strPort: the string to parse.
- * @retval Port number to use; exit(-1) if error.
- */
-long convertPort(char *strPort)
-{
-    char *strEndOfParse;
-
-    long lResult = strtol(strPort, &strEndOfParse, 10);
-    if (lResult == 0)
-    {
-        perror("Error: Problem converting port number");
-        exit(-1);
-    }
-
-    if ((*strEndOfParse != '\0') && (*strEndOfParse != '\n'))
-    {
-        perror("Port arg parsing error: invalid character. Please use only ASCII numeric characters");
-        exit(-1);
-    }
-
-    //Conversion success, validate range conforms to port range.
-    if (lResult < 0)
-    {
-        perror("Error: Port out of range. Min port number is 0.");
-        exit(-1);
-    }
-    if (lResult > 65535)
-    {
-        perror("Error: Port out of range. Max port number is 65535.");
-        exit(-1);
-    }
-
-    return lResult;
-}
-
-void initMulticastSocket()
-{
-    struct sockaddr_in multicastAddr;
-    multicastAddr.sin_family = AF_INET;
-    multicastAddr.sin_port = htons(MULTICAST_PORT);
-    multicastAddr.sin_addr.s_addr = htonl(INADDR_ANY);
-
-    globMulticastSocket = socket(AF_INET, SOCK_DGRAM, 0);
-
-    if (globMulticastSocket == 0)
-    {
-        perror("Error: Problem opening socket");
-        close(globTCPSocket);
-        exit(-1);
-    }
-
-    int bindSuccess = bind(globMulticastSocket, (struct sockaddr *)&multicastAddr, sizeof(multicastAddr));
-
-    if (bindSuccess != 0)
-    {
-        perror("Error: Problem binding socket");
-        close(globTCPSocket);
-        close(globMulticastSocket);
-        exit(-1);
-    }
-
-    struct ip_mreq mreq;
-    mreq.imr_multiaddr.s_addr = inet_addr(MULTICAST_IP);
-    mreq.imr_interface.s_addr = htonl(INADDR_ANY);
-    if (setsockopt(globMulticastSocket, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) == -1)
-    {
-        perror("Error: Problem setting multicast socket options");
-        close(globTCPSocket);
-        close(globMulticastSocket);
-        exit(-1);
-    }
-
-    //Setup blocking read timeout
-    //https://stackoverflow.com/questions/13547721/udp-socket-set-timeout
-    struct timeval tv;
-    tv.tv_sec = BLOCKING_READ_TIME;
-    tv.tv_usec = 0;
-    if (setsockopt(globMulticastSocket, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) < 0)
-    {
-        perror("Error: Problem adding timeout to socket");
-    }
-}
-
-/**
- * Receives a message from socket and validates it.
- * @param  messageBuffer[MESSAGE_SIZE]: The buffer to fill with the message.
- * @param  *clientAddress: The address of the client who sent the message.
- * @param  *clientAddressLength: The size of the client address.
- * @retval 1 if message valid; 0 if message invalid; exit(-1) if error.
- */
-int recvMessage(unsigned char messageBuffer[MESSAGE_SIZE], int gameNumber)
-{
-
-    //Assume read happens all at once
-
-    unsigned char *recvPointer = messageBuffer;
-
-    int bytesRead = recv(tttGames[gameNumber].connectedSocket, recvPointer, MESSAGE_SIZE, TCP_FLAGS);
-
-    if (bytesRead < 0)
-    {
-        printf("--- ERROR - Client %d - Socket exception thrown, Closing game. Error: ", gameNumber);
-        perror("");
-        close(tttGames[gameNumber].connectedSocket);
-        tttGames[gameNumber].active = 0;
-        return 0;
-    }
-    if (bytesRead == 0)
-    {
-        printf("--- ERROR - Client %d - Client socket closed unexpectedly, Closing game\n", gameNumber);
-        close(tttGames[gameNumber].connectedSocket);
-        tttGames[gameNumber].active = 0;
-        return 0;
-    }
-    if (bytesRead < MIN_MESSAGE_SIZE)
-    {
-        printf("--- ERROR - Client %d - Message from client too short, Closing game\n", gameNumber);
-        unsigned char messageStore[MESSAGE_SIZE];
-        sendMessage(MOVE_COMMAND, 0, GAME_ERROR, ERROR_MALFORMED_REQUEST, -1, 0, tttGames[gameNumber].connectedSocket, messageStore);
-        close(tttGames[gameNumber].connectedSocket);
-        tttGames[gameNumber].active = 0;
-        return 0;
-    }
-
-    if (!(messageBuffer[0] >= EARLIEST_VERSION))
-    {
-        printf("--- ERROR - Client %d - Client using incompatible protocol version\n", gameNumber);
-        unsigned char messageStore[MESSAGE_SIZE];
-        sendMessage(MOVE_COMMAND, 0, GAME_ERROR, ERROR_MALFORMED_REQUEST, -1, 0, tttGames[gameNumber].connectedSocket, messageStore);
-        close(tttGames[gameNumber].connectedSocket);
-        tttGames[gameNumber].active = 0;
-        return 0;
-    }
-
-    return 1;
-}
-
-/**
- * Sends a message to a client.
- * @param  move: The move to make.
- * @param  complete: The game complete code to send.
- * @param  completeDescriptor: The game complete descritor code to send.
- * @param  gameNumber: The game number to send.
- * @param  clientAddress: The address of the client to send to.
- * @retval None.
- */
-void sendMessage(int command, int move, int complete, int completeDescriptor, int gameNumber, unsigned char clientSequenceNum, int connectedSocket, unsigned char messageStore[MESSAGE_SIZE])
-{
-    unsigned char moveByte = move;
-    unsigned char completeByte = complete;
-    unsigned char completeDescriptorByte = completeDescriptor;
-    unsigned char commandByte = MOVE_COMMAND;
-    unsigned char gameNumByte = gameNumber;
-    unsigned char sequenceByte = clientSequenceNum;
-
-    messageStore[0] = VERSION;
-    messageStore[1] = moveByte;
-    messageStore[2] = completeByte;
-    messageStore[3] = completeDescriptorByte;
-    messageStore[4] = commandByte;
-    messageStore[5] = gameNumByte;
-    messageStore[6] = sequenceByte;
-
-    //Send message
-    if (send(connectedSocket, messageStore, MESSAGE_SIZE, TCP_FLAGS) <= 0)
-    {
-        printf("--- ERROR - Client %d - Couldn't write to socket, Closing game. Error: ", gameNumber);
-        perror("");
-        close(tttGames[gameNumber].connectedSocket);
-        tttGames[gameNumber].active = 0;
-    }
-
-    debugPacket(messageStore, SENT, ORIGINAL);
-}
-
-void sendPacket(unsigned char packet[MESSAGE_SIZE], int connectedSocket)
-{
-    //Send message
-    if (send(connectedSocket, packet, MESSAGE_SIZE, TCP_FLAGS) <= 0)
-    {
-        perror("Error sending packet");
-    }
-}
-
-/**
- * Initialize the state of a tictactoe game board.
- * @param  board[ROWS][COLUMNS]: The board matrix.
- * @retval None.
- */
-void initSharedState(char board[ROWS][COLUMNS])
-{
-    /* this just initializing the shared state aka the board */
-    int i, j, count = 1;
-    for (i = 0; i < 3; i++)
-        for (j = 0; j < 3; j++)
-        {
-            board[i][j] = count + '0';
-            count++;
-        }
-}
-
-/**
- * Validate and place a move on the board.
- * @param  board[ROWS][COLUMNS]: The board to place move on.
- * @param  move: The move to place on board.
- * @param  player: The player placing the move (client or server).
- * @retval 1 if move placed successfully; 0 otherwise.
- */
-int placeMove(char board[ROWS][COLUMNS], int move, int player)
-{
-    char mark = (player == 1) ? 'O' : 'X'; //depending on who the player is, either us x or o
-
-    if (move < 1 || move > 9)
-    {
-        return 0;
-    }
-
-    int choice = move;
-    int row = (int)((choice - 1) / ROWS);
-    int column = (choice - 1) % COLUMNS;
-
-    if (board[row][column] == (choice + '0'))
-    {
-        board[row][column] = mark;
-        return 1;
-    }
-    return 0;
-}
-
-/**
- * Check if a player has won the game.  Assumes this is called between each move made.
- * @param  board[ROWS][COLUMNS]: The game board to check.
- * @param  player: The last player to place a move.
- * @retval {win code} if player has won; {draw code} if tie; -1 otherwise.
- */
-int checkWin(char board[ROWS][COLUMNS], int player)
-{
-    int winner = -2;
-    if (player == SERVER_PLAYER)
-    {
-        winner = SERVER_WIN;
-    }
-    else if (player == CLIENT_PLAYER)
-    {
-        winner = CLIENT_WIN;
-    }
-
-    /************************************************************************/
-    /* brute force check to see if someone won, or if there is a draw       */
-    /************************************************************************/
-    if (board[0][0] == board[0][1] && board[0][1] == board[0][2]) // row matches
-        return winner;
-
-    else if (board[1][0] == board[1][1] && board[1][1] == board[1][2]) // row matches
-        return winner;
-
-    else if (board[2][0] == board[2][1] && board[2][1] == board[2][2]) // row matches
-        return winner;
-
-    else if (board[0][0] == board[1][0] && board[1][0] == board[2][0]) // column
-        return winner;
-
-    else if (board[0][1] == board[1][1] && board[1][1] == board[2][1]) // column
-        return winner;
-
-    else if (board[0][2] == board[1][2] && board[1][2] == board[2][2]) // column
-        return winner;
-
-    else if (board[0][0] == board[1][1] && board[1][1] == board[2][2]) // diagonal
-        return winner;
-
-    else if (board[2][0] == board[1][1] && board[1][1] == board[0][2]) // diagonal
-        return winner;
-
-    else if (board[0][0] != '1' && board[0][1] != '2' && board[0][2] != '3' &&
-             board[1][0] != '4' && board[1][1] != '5' && board[1][2] != '6' &&
-             board[2][0] != '7' && board[2][1] != '8' && board[2][2] != '9')
-
-        return DRAW; // Return of DRAW means game over
-    else
-        return -1; // return of -1 means keep playing
-}
-
-/**
- * Places a valid move for the server.  
- * @param  board[ROWS][COLUMNS]: The board to place a move on.
- * @retval The move placed by server.
- */
-int placeServerMove(char board[ROWS][COLUMNS])
-{
-    int choice = 0;
-    do
-    {
-        choice++;
-    } while (placeMove(board, choice, SERVER_PLAYER) != 1);
-    return choice;
-}
-
-/**
- * Close all open sockets.  
- * @retval None.
- */
-void closeSockets()
-{
-    //TODO: Send server shutdown
-    close(globTCPSocket);
-    close(globMulticastSocket);
-    int i;
-    for (i = 0; i < MAX_NUMBER_OF_ACTIVE_GAMES; i++)
-    {
-        close(tttGames[i].connectedSocket);
-    }
-}
-
-/**
- * Attempt to start a new game, message client with game number if successful
- * Message with error if all games are full
- * @param clientAddress - the client address
- */
-void allocateGame(int connectedSocket, struct sockaddr_in clientAddress)
-{
-    //Check if client already has open game
-    int activeGame = findGameByAddress(clientAddress);
-
-    //Client has open game, send retry and close
-    if (activeGame != -1)
-    {
-        unsigned char messageStore[MESSAGE_SIZE];
-        sendMessage(MOVE_COMMAND, 0, GAME_ERROR, ERROR_RETRY, -1, 0, connectedSocket, messageStore);
-        printf("--- RETRY - Client Rejected and Existing Game %d Canceled ---\n", activeGame);
-
-        close(tttGames[activeGame].connectedSocket);
-        tttGames[activeGame].active = 0;
-        close(connectedSocket);
-        return;
-    }
-
-    //Find the next open game
-    int gameNumber = 0;
-    int gameFound = 0;
-    unsigned char i = 0;
-    for (i = 0; i < MAX_NUMBER_OF_ACTIVE_GAMES; i++)
-    {
-        if (tttGames[i].active == 0)
-        {
-            gameFound = 1;
-            gameNumber = i;
-            break;
-        }
-    }
-
-    //All game slots were full
-    if (gameFound == 0)
-    {
-        unsigned char messageStore[MESSAGE_SIZE];
-        sendMessage(MOVE_COMMAND, 0, GAME_ERROR, ERROR_OUT_OF_RESOURCES, gameNumber, 0, connectedSocket, messageStore);
-        printf("--- OUT OF RESOURCES - New Client Rejected\n");
-        close(connectedSocket);
-    }
-    else
-    {
-        //initialize game and respond to client
-        tttGames[gameNumber].active = 1;
-        tttGames[gameNumber].address = clientAddress;
-        tttGames[gameNumber].connectedSocket = connectedSocket;
-        printf("--- NEW CLIENT CONNECTED - Client %d\n", gameNumber);
-    }
-}
-
-void startGame(int gameNumber, unsigned char clientSequenceNum)
-{
-    //Init game space and sequence num
-    initSharedState(tttGames[gameNumber].board);
-    tttGames[gameNumber].sequenceNumber = clientSequenceNum;
-    sendMessage(MOVE_COMMAND, 0, 0, 0, gameNumber, clientSequenceNum + 1, tttGames[gameNumber].connectedSocket, tttGames[gameNumber].lastMessage);
-    printf("--- NEW GAME - Client %d\n", gameNumber);
-}
-
-/**
- * Find active game for client if one exist.  
- * @param  address: The client address.
- * @retval The index of the clients active game; -1 if no game exists.
- */
-int findGameByAddress(struct sockaddr_in address)
-{
-    int i = -1;
-    int compare = 1;
-    while (i < MAX_NUMBER_OF_ACTIVE_GAMES && compare)
-    {
-        i++;
-        if (tttGames[i].active == 1)
-        {
-            compare = memcmp(&address, &(tttGames[i].address), sizeof(address));
-        }
-    }
-    if (!compare)
-    {
-        return i;
-    }
-    else
-    {
-        return -1;
-    }
-}
-
-int findGameBySocket(int connectedSocket)
-{
-    int i = -1;
-    int match = 0;
-    while (i < MAX_NUMBER_OF_ACTIVE_GAMES && !match)
-    {
-        i++;
-        if (tttGames[i].active == 1)
-        {
-            match = tttGames[i].connectedSocket == connectedSocket;
-        }
-    }
-    if (match)
-    {
-        return i;
-    }
-    else
-    {
-        return -1;
-    }
-}
-
-/**
- * Handle a move command by the client. Sends appropriate response and deactives game if necessary.
- * @param  activeGame: The index of a clients active game (or -1 if none).
- * @param  gameNumber: The gameNumber sent by client.
- * @param  move: The move sent by client.
- * @param  clientComplete: The complete code sent by client.
- * @param  clientCompleteDescriptor: The complete descriptor code sent by client.
- * @param  clientAddress: The client address.
- * @retval None.
- */
-void handleMove(int activeGame, int command, int clientGameNum, int move, int clientComplete, int clientCompleteDescriptor, unsigned char clientSequenceNum)
-{
-    //Check that game number matches active game
-    if (activeGame != clientGameNum)
-    {
-        printf("--- ERROR - Client %d - Malformed Request: Incorrect game number, Closing game\n", activeGame);
-        //Send error
-        unsigned char messageStore[MESSAGE_SIZE];
-        sendMessage(MOVE_COMMAND, 0, GAME_ERROR, ERROR_MALFORMED_REQUEST, clientGameNum, clientSequenceNum + 1, tttGames[activeGame].connectedSocket, messageStore);
-        close(tttGames[activeGame].connectedSocket);
-        tttGames[activeGame].active = 0;
-        return;
-    }
-
-    //Get client game
-    struct tttGame *clientGame = &tttGames[activeGame];
-    if (clientSequenceNum == (*clientGame).sequenceNumber)
-    {
-        //Bypass
-
-        // //TODO:
-        // //Should I resend or just wait for timeout to resend here
-        // return;
-    }
-    else if (clientSequenceNum != (*clientGame).sequenceNumber + 2)
-    {
-        //Bypass
-
-        // //Client sequence number is invalid
-        // sendMessage(MOVE_COMMAND, 0, GAME_ERROR, ERROR_MALFORMED_REQUEST, clientGameNum, clientSequenceNum + 1, (*clientGame).connectedSocket, (*clientGame).lastMessage);
-        // printf("--- ERROR - Client %d - Malformed Request: Invalid sequence number, Closing game\n", activeGame);
-        // close(tttGames[activeGame].connectedSocket);
-        // tttGames[activeGame].active = 0;
-        // return;
-    }
-    else
-    {
-        (*clientGame).sequenceNumber = clientSequenceNum;
-    }
-
-    //Check for error message
-    if (clientComplete == GAME_ERROR)
-    {
-        printf("--- ERROR - Client %d reported a general error, ending game\n");
-        close((*clientGame).connectedSocket);
-        (*clientGame).active = 0;
-        return;
-    }
-
-    //Catch endgame response
-    if (command == END_GAME_COMMAND)
-    {
-        printf("--- HANDSHAKE - Client %d - End Game Response\n", activeGame);
-        close((*clientGame).connectedSocket);
-        (*clientGame).active = 0;
-        return;
-    }
-
-    //Validate and place client move
-    if (placeMove((*clientGame).board, move, CLIENT_PLAYER) == 0)
-    {
-        //Invalid move -- Send error and end game
-        sendMessage(MOVE_COMMAND, 0, GAME_ERROR, ERROR_MALFORMED_REQUEST, clientGameNum, clientSequenceNum + 1, (*clientGame).connectedSocket, (*clientGame).lastMessage);
-        printf("--- ERROR - Client %d - Malformed Request: Invalid move, Closing game\n", activeGame);
-        close((*clientGame).connectedSocket);
-        (*clientGame).active = 0;
-        return;
-    }
-
-    printf("--- MOVE - Client %d\n", activeGame);
-
-    handleMoveAfterPlaced(clientGame, clientComplete, activeGame, clientCompleteDescriptor, clientSequenceNum, clientGameNum);
-}
-
-void handleMoveAfterPlaced(struct tttGame *clientGame, int clientComplete, int activeGame, int clientCompleteDescriptor, unsigned char clientSequenceNum, int clientGameNum)
-{
-    //Check for game complete and winner
-    int win = checkWin((*clientGame).board, CLIENT_PLAYER);
-    int complete = GAME_IN_PROGRESS;
-    if (win != -1)
-    {
-        complete = GAME_COMPLETE;
-    }
-
-    //Check if client claims game complete
-    if (clientComplete == GAME_COMPLETE)
-    {
-        //Handle endgame handshake
-        handleEndgame(activeGame, win, complete, clientComplete, clientCompleteDescriptor, clientSequenceNum);
-    }
-    else if (complete == GAME_COMPLETE)
-    {
-        //Game is complete but client did not claim appropiately
-        //Malformed request
-        sendMessage(MOVE_COMMAND, 0, GAME_ERROR, ERROR_MALFORMED_REQUEST, clientGameNum, clientSequenceNum + 1, (*clientGame).connectedSocket, (*clientGame).lastMessage);
-        printf("--- ERROR - Client %d - Malformed Request: Expected game complete, Clsoing game\n", activeGame);
-        close((*clientGame).connectedSocket);
-        (*clientGame).active = 0;
-        return;
-    }
-    else
-    {
-        //Get and place valid server move
-        int serverMove = placeServerMove((*clientGame).board);
-
-        //Check game complete
-        win = checkWin((*clientGame).board, SERVER_PLAYER);
-        complete = GAME_IN_PROGRESS;
-        if (win != -1)
-        {
-            complete = GAME_COMPLETE;
-            printf("--- GAME OVER - Client %d\n", activeGame);
-        }
-
-        //Send move to client
-        sendMessage(MOVE_COMMAND, serverMove, complete, win, clientGameNum, clientSequenceNum + 1, (*clientGame).connectedSocket, (*clientGame).lastMessage);
-    }
-}
-
-/**
- * Initalizes the array of tttGames with MAX_NUMBER_OF_ACTIVE_GAMES inactive games. 
- * @retval None.
- */
-void initGamesArray()
-{
-    tttGames = malloc(MAX_NUMBER_OF_ACTIVE_GAMES * sizeof(struct tttGame));
-    int i;
-    for (i = 0; i < MAX_NUMBER_OF_ACTIVE_GAMES; i++)
-    {
-        tttGames[i].active = 0;
-    }
-}
-
-void handleEndgame(int gameNumber, int win, int complete, int clientComplete, int clientCompleteDescriptor, unsigned char clientSequenceNum)
-{
-    //Get client game
-    struct tttGame *clientGame = &tttGames[gameNumber];
-
-    //Check that game is actually over
-    if (complete != GAME_COMPLETE)
-    {
-        //Game not complete or client didn't set game complete byte
-        sendMessage(MOVE_COMMAND, 0, GAME_ERROR, ERROR_MALFORMED_REQUEST, gameNumber, clientSequenceNum + 1, (*clientGame).connectedSocket, (*clientGame).lastMessage);
-        printf("--- ERROR - Client %d - Malformed Request: Invalid game complete recieved, Closing game\n", gameNumber);
-        close((*clientGame).connectedSocket);
-        (*clientGame).active = 0;
-        return;
-    }
-
-    //Check that winners match
-    if (win != clientCompleteDescriptor)
-    {
-        //Game winners do not match
-        sendMessage(MOVE_COMMAND, 0, GAME_ERROR, ERROR_MALFORMED_REQUEST, gameNumber, clientSequenceNum + 1, (*clientGame).connectedSocket, (*clientGame).lastMessage);
-        printf("--- ERROR - Client %d - Malformed Request: Mismatch endgame results, Closing game\n", gameNumber);
-        close((*clientGame).connectedSocket);
-        (*clientGame).active = 0;
-        return;
-    }
-
-    //Endgame response
-    sendMessage(END_GAME_COMMAND, 0, complete, win, gameNumber, clientSequenceNum + 1, (*clientGame).connectedSocket, (*clientGame).lastMessage);
-    printf("--- HANDSHAKE - Client %d - End Game Sent\n", gameNumber);
-    close((*clientGame).connectedSocket);
-    (*clientGame).active = 0;
-}
-
-void setupSocketSets(fd_set *readSet, fd_set *exceptSet)
-{
-    //Set the socket sets
-    FD_ZERO(readSet);
-    FD_ZERO(exceptSet);
-    //Include listening port
-    FD_SET(globTCPSocket, readSet);
-    FD_SET(globTCPSocket, exceptSet);
-    FD_SET(globMulticastSocket, readSet);
-    FD_SET(globMulticastSocket, exceptSet);
-
-    //Set socket for all active games
-    int i;
-    for (i = 0; i < MAX_NUMBER_OF_ACTIVE_GAMES; i++)
-    {
-        if (tttGames[i].active)
-        {
-            FD_SET(tttGames[i].connectedSocket, readSet);
-            FD_SET(tttGames[i].connectedSocket, exceptSet);
-        }
-    }
-}
-
-void onSelect(fd_set *readSet, fd_set *exceptSet)
-{
-    //Handle exceptions
-    if (exceptSet != NULL)
-    {
-        if (FD_ISSET(globTCPSocket, exceptSet))
-        {
-            perror("Error: Exception thrown on TCP Socket");
-            closeSockets();
-            exit(-1);
-        }
-        if (FD_ISSET(globMulticastSocket, exceptSet))
-        {
-            perror("Error: Exception thrown on Multicast Socket");
-            closeSockets();
-            exit(-1);
-        }
-        int i;
-        for (i = 0; i < MAX_NUMBER_OF_ACTIVE_GAMES; i++)
-        {
-            if (tttGames[i].active && FD_ISSET(tttGames[i].connectedSocket, exceptSet))
-            {
-                printf("--- ERROR - Client %d - Socket exception thrown, Closing game\n", i);
-                close(tttGames[i].connectedSocket);
-                tttGames[i].active = 0;
-            }
-        }
-    }
-
-    //Handle reads
-    if (readSet != NULL)
-    {
-        if (FD_ISSET(globTCPSocket, readSet))
-        {
-            acceptClient();
-        }
-        if (FD_ISSET(globMulticastSocket, readSet))
-        {
-            handleMulticast();
-        }
-        int i;
-        for (i = 0; i < MAX_NUMBER_OF_ACTIVE_GAMES; i++)
-        {
-            if (tttGames[i].active && FD_ISSET(tttGames[i].connectedSocket, readSet))
-            {
-                //Recieve message from a client and process if valid
-                //Blocks temporarily for read
-                unsigned char messageBuffer[MAX_MESSSAGE_SIZE];
-                if (recvMessage(messageBuffer, i))
-                {
-                    //Debug
-                    debugPacket(messageBuffer, RECEIVED, ORIGINAL);
-
-                    //Find active game
-                    int activeGame = i;
-
-                    //Parse message from client
-                    int clientVersion = messageBuffer[0];
-                    int clientMove = messageBuffer[1];
-                    int clientComplete = messageBuffer[2];
-                    //If version 4+ get clientCompleteInfo byte
-                    int clientCompleteInfo = -1;
-                    if (messageBuffer[0] >= 4)
-                    {
-                        clientCompleteInfo = messageBuffer[3];
-                    }
-                    //If version 5+ get command and game bytes
-                    int clientCommand = -1;
-                    int clientGameNum = -1;
-                    if (messageBuffer[0] >= 5)
-                    {
-                        clientCommand = messageBuffer[4];
-                        clientGameNum = messageBuffer[5];
-                    }
-                    //If version 6+ get sequence number byte
-                    unsigned char clientSequenceNum = 0;
-                    if (clientVersion >= 6)
-                    {
-                        clientSequenceNum = messageBuffer[6];
-                    }
-
-                    //Handle Command
-                    if (clientCommand == NEW_GAME_COMMAND)
-                    {
-                        startGame(activeGame, clientSequenceNum);
-                    }
-                    else if (clientCommand == RECONNECT_COMMAND)
-                    {
-                        unsigned char boardBytes[9];
-                        int i = 0;
-                        for (i = 0; i < 9; i++)
-                        {
-                            boardBytes[i] = messageBuffer[i + 7];
-                        }
-
-                        reconnectGame(activeGame, boardBytes);
-                    }
-                    else if (clientCommand == MOVE_COMMAND || clientCommand == END_GAME_COMMAND)
-                    {
-                        handleMove(activeGame, clientCommand, clientGameNum, clientMove, clientComplete, clientCompleteInfo, clientSequenceNum);
-                    }
-                    else
-                    {
-                        printf("--- ERROR - Client %d - Malformed Request: Incorrect game number, Closing game\n", activeGame);
-                        //Send error
-                        unsigned char messageStore[MESSAGE_SIZE];
-                        sendMessage(MOVE_COMMAND, 0, GAME_ERROR, ERROR_MALFORMED_REQUEST, clientGameNum, clientSequenceNum + 1, tttGames[activeGame].connectedSocket, messageStore);
-                        close(tttGames[activeGame].connectedSocket);
-                        tttGames[activeGame].active = 0;
-                        return;
-                    }
-                }
-            }
-        }
-    }
-}
-
-void acceptClient()
-{
-    //Declare client socket
-    struct sockaddr_in clientAddress;
-    socklen_t clientAddressLength;
-    //Initialize clientAddressLength
-    clientAddressLength = sizeof(clientAddress);
-
-    int connectedSocket = accept(globTCPSocket, (struct sockaddr *)&clientAddress, &clientAddressLength);
-
-    if (connectedSocket == 0)
-    {
-        perror("--- ERROR - Problem accepting client: ");
-        exit(-1);
-    }
-
-    //Allocate resources and start game
-    allocateGame(connectedSocket, clientAddress);
-}
-
-void debugPacket(unsigned char buf[MAX_MESSSAGE_SIZE], int sentOrReceived, int repeatOrNot)
-{
-    if (DEBUG_MODE)
-    {
-        if (sentOrReceived == SENT)
-        {
-            printf("\nSENT - ");
-        }
-        else
-        {
-            printf("\nRECEIVED - ");
-        }
-        if (repeatOrNot == ORIGINAL)
-        {
-            printf("ORIGINAL\n");
-        }
-        else
-        {
-            printf("REPEAT\n");
-        }
-
-        printf("[Byte 1] Version = %d\n", buf[0]);
-        printf("[Byte 2] Position = %d\n", buf[1]);
-
-        printf("[Byte 3] Game State = %d ", buf[2]);
-        switch (buf[2])
-        {
-        case 0:
-            printf("(Game in Progress)\n");
-            switch (buf[3])
-            {
-            case 0:
-                printf("[Byte 4] Modifier = %d ", buf[3]);
-                printf("(Game in progress)\n");
-                break;
-            default:
-                printf("Unknown\n");
-            }
-            break;
-        case 1:
-            printf("(Game Complete)\n");
-            switch (buf[3])
-            {
-            case 1:
-                printf("[Byte 4] Modifier = %d ", buf[3]);
-                printf("(Draw)\n");
-                break;
-            case 2:
-                printf("[Byte 4] Modifier = %d ", buf[3]);
-                printf("(Client Win)\n");
-                break;
-            case 3:
-                printf("[Byte 4] Modifier = %d ", buf[3]);
-                printf("(Server Win)\n");
-                break;
-            default:
-                printf("Unknown\n");
-            }
-            break;
-        case 2:
-            printf("(Game Error)\n");
-            switch (buf[3])
-            {
-            case 1:
-                printf("[Byte 4] Modifier = %d ", buf[3]);
-                printf("(Out of resources)\n");
-                break;
-            case 2:
-                printf("[Byte 4] Modifier = %d ", buf[3]);
-                printf("(Malformed Request)\n");
-                break;
-            case 3:
-                printf("[Byte 4] Modifier = %d ", buf[3]);
-                printf("(Server Shutdown)\n");
-                break;
-            case 4:
-                printf("[Byte 4] Modifier = %d ", buf[3]);
-                printf("(Client game timeout)\n");
-                break;
-            case 5:
-                printf("[Byte 4] Modifier = %d ", buf[3]);
-                printf("(Try again)\n");
-                break;
-            default:
-                printf("Unknown\n");
-            }
-            break;
-        default:
-            printf("Unknown Byte\n");
-        }
-
-        printf("[Byte 5] Command = %d ", buf[4]);
-        switch (buf[4])
-        {
-        case 0:
-            printf("(New Game)\n");
-            break;
-        case 1:
-            printf("(Move)\n");
-            break;
-        case 2:
-            printf("(End Game)\n");
-            break;
-        default:
-            printf("Unknown\n");
-        }
-        printf("[Byte 6] Game Num = %d\n", buf[5]);
-        printf("[Byte 7] Sequence = %d\n", buf[6]);
-    }
-}
-
-void handleMulticast()
-{
-    unsigned char messageBuffer[MESSAGE_SIZE];
-
-    //Declare client socket
-    struct sockaddr_in clientAddress;
-    socklen_t clientAddressLength;
-    //Initialize clientAddressLength
-    clientAddressLength = sizeof(clientAddress);
-
-    errno = 0;
-    int bytesRead = recvfrom(globMulticastSocket, &messageBuffer, MESSAGE_SIZE, DATAGRAM_FLAGS, (struct sockaddr *)&clientAddress, &clientAddressLength);
-
-    if (bytesRead < 0)
-    {
-        if (errno == EAGAIN || errno == EWOULDBLOCK)
-        {
-            //Blocking read timeout
-            return;
-        }
-        perror("Error: Problem reading from socket");
-        closeSockets();
-        exit(-1);
-    }
-    // if (bytesRead < MIN_MESSAGE_SIZE)
-    // {
-    //     printf("--- ERROR - Multicast message too short\n");
-    //     return;
-    // }
-
-    if (!(messageBuffer[0] >= EARLIEST_VERSION))
-    {
-        printf("--- ERROR - Multicast received using incompatible protocol version\n");
-        return;
-    }
-
-    if (!(messageBuffer[1]) == 1)
-    {
-        printf("--- ERROR - Multicast received with invalid command\n");
-        return;
-    }
-
-    printf("--- MULTICAST - Multicast request received\n");
-
-    unsigned char responseBuffer[MESSAGE_SIZE];
-    unsigned char versionByte = VERSION;
-    unsigned char commandByte = 2;
-    unsigned int portHTON = htons(globServerPort);
-    //TODO: Iterate here as well possibly
-    // *portBytes = ;
-
-    responseBuffer[0] = versionByte;
-    responseBuffer[1] = commandByte;
-    memcpy(&(responseBuffer[2]), &portHTON, 2);
-
-    printf("Port: %ld\n", globServerPort);
-    printf("Response byte 1: %x\n", responseBuffer[0]);
-    printf("Response byte 2: %x\n", responseBuffer[1]);
-    printf("Response byte 3: %x\n", responseBuffer[2]);
-    printf("Response byte 4: %x\n", responseBuffer[3]);
-
-    // printf("Response byte 3: %x\n", portBytes[0]);
-    // printf("Response byte 4: %x\n", portBytes[1]);
-
-    //Send datagram
-    if (sendto(globMulticastSocket, responseBuffer, MESSAGE_SIZE, DATAGRAM_FLAGS, (struct sockaddr *)&clientAddress, sizeof(clientAddress)) <= 0)
-    {
-        perror("Error: Problem sending multicast response");
-    }
-
-    printf("--- MULTICAST - Multicast respnse sent\n");
-
-    return;
-}
-
-void reconnectGame(int activeGame, unsigned char boardBytes[9])
-{
-    //Get tttGame
-    struct tttGame *clientGame = &tttGames[activeGame];
-
-    //Init game space and sequence num
-    initSharedState((*clientGame).board);
-    (*clientGame).sequenceNumber = 0;
-    int i;
-    for (i = 0; i < 9; i++)
-    {
-        if (boardBytes[i] == 1)
-        {
-            placeMove((*clientGame).board, i + 1, CLIENT_PLAYER);
-        }
-        else if (boardBytes[i] == 2)
-        {
-            placeMove((*clientGame).board, i + 1, SERVER_PLAYER);
-        }
-        else if (boardBytes[i] != 0)
-        {
-            //Invalid board state
-            sendMessage(MOVE_COMMAND, 0, GAME_ERROR, ERROR_MALFORMED_REQUEST, activeGame, (*clientGame).sequenceNumber + 2, (*clientGame).connectedSocket, (*clientGame).lastMessage);
-            printf("--- ERROR - Client %d - Malformed Request: Invalid reconnect board state, Closing game\n", activeGame);
-            close((*clientGame).connectedSocket);
-            (*clientGame).active = 0;
-            return;
-        }
-    }
-    printf("--- NEW GAME FROM RECONNECT - Client %d\n", activeGame);
-
-    if (DEBUG_MODE)
-    {
-        print_board((*clientGame).board);
-    }
-
-    //Make move
-    handleMoveAfterPlaced(clientGame, GAME_IN_PROGRESS, activeGame, 0, tttGames[activeGame].sequenceNumber + 2, activeGame);
-
-    //Pretty sure there will be errors thown here if they try to recconnect with a final move
-}
-
-//For debug
-/**
- * Visually print the ASCII board to the screen
- * */
-void print_board(char board[ROWS][COLUMNS])
-{
-    /*****************************************************************/
-    /* brute force print out the board and all the squares/values    */
-    /*****************************************************************/
-
-    printf("\n\n\n\tCurrent TicTacToe Game\n\n");
-
-    printf("Player 1 (O)  -  Player 2 (X)\n\n\n");
-
-    printf("     |     |     \n");
-    printf("  %c  |  %c  |  %c \n", board[0][0], board[0][1], board[0][2]);
-
-    printf("_____|_____|_____\n");
-    printf("     |     |     \n");
-
-    printf("  %c  |  %c  |  %c \n", board[1][0], board[1][1], board[1][2]);
-
-    printf("_____|_____|_____\n");
-    printf("     |     |     \n");
-
-    printf("  %c  |  %c  |  %c \n", board[2][0], board[2][1], board[2][2]);
-
-    printf("     |     |     \n\n");
-}
+/**
+ * Server code for project 1
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/select.h>
+#include <sys/epoll.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <sys/random.h>
+#include <sys/un.h>
+#include <sys/eventfd.h>
+#include <linux/io_uring.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+//Constants
+#define ROWS 3
+#define COLUMNS 3
+#define SQUARES (ROWS * COLUMNS)
+#define FULL_BOARD ((1 << SQUARES) - 1)
+#define WIN_LINES 8
+#define EVAL_CLIENT_LINE 1
+#define EVAL_SERVER_LINE 2
+#define EVAL_FULL 4
+#define POSITIONS 19683 //3^SQUARES board encodings
+#define SYMMETRIES 8
+#define POSITION_SLOTS 1024
+#define POSITION_SLOT_MASK (POSITION_SLOTS - 1)
+#define SOLUTION_MAGIC "TTTSOLVE"
+#define SOLUTION_VERSION 2
+#define SOLUTION_INITIAL_SLOTS 1024
+#define SOLUTION_MAX_SLOTS (1ULL << 28)
+#define MAX_SOLUTION_FILES 8
+#define NO_POSITION -1
+#define DIFFICULTY_PERFECT 0
+#define DIFFICULTY_GREEDY 1
+#define DIFFICULTY_RANDOM 2
+#define MAX_BLUNDER_RATE 100
+#define MIN_MNK_SIDE 3
+#define MNK_WIN_SCORE (1 << 28)
+#define MNK_INFINITY (MNK_WIN_SCORE + 1024)
+#define MNK_MAX_WINDOW_WEIGHT 7
+#define MNK_CLOCK_CHECK_NODES 16
+#define DEFAULT_MOVE_BUDGET_MS 20
+#define DEFAULT_TRANSPOSITION_MB 16
+#define TRANSPOSITION_BUCKET 2
+#define TRANSPOSITION_EXACT 0
+#define TRANSPOSITION_LOWER 1
+#define TRANSPOSITION_UPPER 2
+#define TRANSPOSITION_GENERATIONS 32
+#define TRANSPOSITION_VALID (1ULL << 63)
+#define TRANSPOSITION_REPORT_SEARCHES 1024
+#define ZOBRIST_SEED 0x7474746D6E6BULL
+#define MAX_SEARCH_THREADS 64
+#define MAX_MESSSAGE_SIZE 1000
+#define MESSAGE_SIZE 1000
+#define MIN_MESSAGE_SIZE 1000
+#define EARLIEST_VERSION 7
+#define LEGACY_VERSION 8
+#define COMPACT_VERSION 9
+#define VERSION COMPACT_VERSION
+#define MOVE_HIGH_FIELD 7
+#define MNK_ROWS_FIELD 7
+#define MNK_COLUMNS_FIELD 8
+#define MNK_K_FIELD 9
+#define MNK_BOARD_FIELD 10
+#define MAX_MNK_SIDE 19
+#define MAX_MNK_SQUARES (MAX_MNK_SIDE * MAX_MNK_SIDE)
+#define MESSAGE_FIELDS (MNK_BOARD_FIELD + (MAX_MNK_SQUARES + 3) / 4 + RESUME_TOKEN_SIZE)
+#define COMPACT_HEADER_SIZE 2
+#define MIN_COMPACT_FRAME (COMPACT_HEADER_SIZE + 6)
+#define MAX_COMPACT_FRAME (COMPACT_HEADER_SIZE + MESSAGE_FIELDS - 1)
+#define RECONNECT_FIELDS 16
+#define RECONNECT_BOARD_FIELD 7
+#define REPLY_FIELDS 7
+#define WIDE_REPLY_FIELDS 8
+#define RESUME_TOKEN_FIELD 8
+#define RESUME_TOKEN_SIZE 8
+#define TOKEN_REPLY_FIELDS (RESUME_TOKEN_FIELD + RESUME_TOKEN_SIZE)
+#define LEGACY_RECORD_SIZE TOKEN_REPLY_FIELDS //Bytes queued per legacy frame; the rest is padding
+#define LEGACY_FLUSH_FRAMES 16
+#define COMPACT_REPLY_SIZE (COMPACT_HEADER_SIZE + REPLY_FIELDS - 1)
+#define REPLY_DESCRIPTORS (ERROR_RETRY + 1) //Complete descriptors a template exists for
+#define RECONNECT_WIDE_BOARD 1
+#define RECONNECT_RESUME_TOKEN 2
+#define MALFORMED_FRAME -1
+#define TIMEOUT 10
+#define TIMER_TICK_MS 100
+#define TIMEOUT_TICKS (TIMEOUT * 1000 / TIMER_TICK_MS)
+#define TIMER_WHEEL_SLOTS 256
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SLOTS - 1)
+#define TIMER_SLOT_WORDS (TIMER_WHEEL_SLOTS / 64)
+#define PACKET_RETRIES 3
+#define DEFAULT_MAX_ACTIVE_GAMES 65536
+#define DEFAULT_RESERVED_GAMES 256
+#define DEFAULT_LISTEN_BACKLOG 4096
+#define MAX_ACCEPTS_PER_WAKEUP 64
+#define GAME_CHUNK_SHIFT 8
+#define GAME_CHUNK_SIZE (1 << GAME_CHUNK_SHIFT)
+#define NO_GAME -1
+#define INITIAL_SOCKET_INDEX_SIZE 1024
+#define INITIAL_PENDING_FLUSH_SIZE 256
+#define INITIAL_PENDING_MOVES_SIZE 256
+#define MAX_WORKERS 64
+#define READ_BUFFER_SIZE 65536
+#define MAX_READY_EVENTS 256
+#define SESSION_STORE_NAME "/tictactoe-sessions"
+#define SESSION_MAGIC "TTTSESSN"
+#define SESSION_VERSION 3
+#define SESSION_SLOTS 65536
+#define SESSION_PROBES 64
+#define SESSION_LOCK_SPINS 1024
+#define SESSION_RECOVER_RECORDS 4096
+#define SESSION_EXPIRY_MS (5 * 60 * 1000)
+#define SESSION_STORE_READY 2
+#define NO_SESSION -1
+#define HANDOFF_MAGIC "TTTHANDO"
+#define HANDOFF_VERSION 1
+#define HANDOFF_ACCEPTED 0
+#define HANDOFF_REFUSED 1
+#define HANDOFF_SOCKETS_PER_MESSAGE 253 //SCM_MAX_FD, the most sockets one message carries
+
+//Flags and Codes
+#define GAME_IN_PROGRESS 0
+#define GAME_COMPLETE 1
+#define GAME_ERROR 2
+#define SERVER_PLAYER 1
+#define CLIENT_PLAYER 2
+#define DRAW 1
+#define CLIENT_WIN 2
+#define SERVER_WIN 3
+#define TCP_FLAGS 0
+#define DATAGRAM_FLAGS 0
+#define NEW_GAME_COMMAND 0
+#define MOVE_COMMAND 1
+#define END_GAME_COMMAND 2
+#define RECONNECT_COMMAND 3
+#define ERROR_OUT_OF_RESOURCES 1
+#define ERROR_MALFORMED_REQUEST 2
+#define ERROR_SERVER_SHUTDOWN 3
+#define ERROR_TIMEOUT 4
+#define ERROR_RETRY 5
+
+//Event backend defines
+#define BACKEND_EPOLL 0
+#define BACKEND_SELECT 1
+#define BACKEND_URING 2
+#define READY_READ 1
+#define READY_ERROR 2
+#define READY_WRITE 4
+#define READY_DATA 8
+#define READY_ACCEPT 16
+#define LEVEL_TRIGGERED 0
+#define EDGE_TRIGGERED 1
+
+//io_uring backend defines
+#define URING_SQ_ENTRIES 1024
+#define URING_CQ_ENTRIES 8192
+#define URING_BUFFER_COUNT 1024
+#define URING_BUFFER_SIZE 2048
+#define URING_BUFFER_GROUP 0
+#define URING_OP_ACCEPT 1
+#define URING_OP_POLL 2
+#define URING_OP_RECV 3
+#define URING_OP_SEND 4
+#define URING_OP_CANCEL 5
+#define URING_OP_SHIFT 56
+#define URING_GENERATION_SHIFT 32
+#define URING_GENERATION_MASK 0xFFFFFF
+#define NO_SEND -1
+
+//Benchmark defines
+#define BENCH_GAMES 10000
+#define BENCH_CONNECTIONS 64
+#define BENCH_IDLE_MS 5000
+#define BENCH_STORM_CLIENTS 10000
+#define BENCH_CONNECTING 0
+#define BENCH_NEW_GAME 1
+#define BENCH_PLAYING 2
+#define BENCH_DONE 3
+#define BENCH_RECONNECT 4
+#define BENCH_MOVE_ROUNDS 2000
+#define BENCH_SYMMETRY_ROUNDS 2000
+#define BENCH_REPLY_ROUNDS 100000
+#define BENCH_REPLY_BATCH 16
+#define BENCH_SEARCH_MS 1000
+#define BENCH_SEARCH_THREADS 16
+#define BENCH_EVALUATE_BOARDS 65536
+#define BENCH_EVALUATE_ROUNDS 500
+
+//Multicast defines
+#define MULTICAST_IP "239.0.0.7"
+#define MULTICAST_PORT 1818
+#define MULTICAST_DISCOVER 1
+#define MULTICAST_RESPONSE 2
+#define MULTICAST_ANNOUNCE 3
+#define DISCOVERY_MESSAGE_SIZE 13
+#define DISCOVERY_FREE_FIELD 4
+#define DISCOVERY_ACTIVE_FIELD 8
+#define DISCOVERY_LOAD_FIELD 12
+#define MAX_DATAGRAMS_PER_WAKEUP 64
+#define LOAD_WINDOW_US 1000000
+
+//Debug defines
+#define SENT 1
+#define RECEIVED 2
+#define ORIGINAL 1
+#define REPEAT 2
+#define DEBUG_MODE 0 //Switch to 0 to disable packet output
+
+/**
+ * A tictactoe board as one bit mask per player; square n (1-9) is bit n - 1.
+ * client: Squares taken by the client (X).
+ * server: Squares taken by the server (O).
+ */
+struct tttBoard
+{
+    unsigned short client;
+    unsigned short server;
+};
+
+/**
+ * What a batch evaluation found on one board. Laid out like tttBoard, so a
+ * vector of boards becomes a vector of results in place.
+ * status: EVAL_CLIENT_LINE and EVAL_SERVER_LINE if that player holds a whole
+ * line, EVAL_FULL if no square is free; 0 for a game in progress.
+ * legal: Mask of the free squares.
+ */
+struct boardStatus
+{
+    unsigned short status;
+    unsigned short legal;
+};
+
+/**
+ * A classic move placed this loop iteration, waiting for the batch
+ * evaluation before it is answered.
+ * serverMove: The reply, once the server has moved.
+ */
+struct pendingMove
+{
+    int gameNumber;
+    int clientComplete;
+    int clientCompleteDescriptor;
+    unsigned char clientSequenceNum;
+    int serverMove;
+};
+
+/**
+ * Header of a solution file, followed by slotCount solutionEntry slots: an
+ * open addressed hash table of every position reachable from the empty board,
+ * client first, keyed by the position's Zobrist hash as the m,n,k search
+ * computes it (variantKey, then each stone's globZobrist key). A position's
+ * slot is its key masked to the slot count, or the next free one after it.
+ * Fields are in host byte order.
+ * magic/version: SOLUTION_MAGIC and SOLUTION_VERSION.
+ * headerSize/entrySize: Sizes the writer used, checked against this build's.
+ * rows/columns/k: The variant solved.
+ * slotCount: A power of two, at most SOLUTION_MAX_SLOTS, with at most three
+ * quarters of the slots used.
+ * entryCount: Positions stored.
+ * checksum: FNV-1a of the slots.
+ */
+struct solutionHeader
+{
+    char magic[8];
+    unsigned int version;
+    unsigned int headerSize;
+    unsigned int entrySize;
+    unsigned char rows;
+    unsigned char columns;
+    unsigned char k;
+    unsigned char reserved;
+    unsigned long long slotCount;
+    unsigned long long entryCount;
+    unsigned int checksum;
+    unsigned int reserved2;
+};
+
+/**
+ * One slot of a solution file.
+ * key: The position's hash; 0 for an empty slot.
+ * bestMove/greedyMove: Perfect and greedy move (1 based) for the player to
+ * move, who is the server if the client has more stones; 0 if the game is over.
+ * depth: Moves left in the game with perfect play.
+ * outcome: DRAW, CLIENT_WIN or SERVER_WIN with perfect play.
+ */
+struct solutionEntry
+{
+    unsigned long long key;
+    unsigned short bestMove;
+    unsigned short greedyMove;
+    unsigned short depth;
+    unsigned char outcome;
+    unsigned char reserved;
+};
+
+/**
+ * A solution file mapped by -S, registered for its variant.
+ * path: The file.
+ * rows/columns/k: The variant it solves.
+ * slotMask: Slot count - 1.
+ * entries: The slots, read-only.
+ */
+struct solutionTable
+{
+    char *path;
+    int rows;
+    int columns;
+    int k;
+    unsigned long long slotMask;
+    const struct solutionEntry *entries;
+};
+
+/**
+ * A solved position, stored once for all of its rotations and reflections.
+ * key: The canonical board, server mask << SQUARES | client mask.
+ * used: 1 if the slot holds a position.
+ * score: Minimax score for the server; faster wins score higher.
+ * bestMove/greedyMove: Perfect and greedy move (1-9) for the player to move
+ * on the canonical board, 0 if the game is over.
+ */
+struct positionEntry
+{
+    unsigned int key;
+    unsigned char used;
+    signed char score;
+    unsigned char bestMove;
+    unsigned char greedyMove;
+};
+
+/**
+ * Header of the shared session store, followed by slotCount sessionRecords.
+ * magic/version: SESSION_MAGIC and SESSION_VERSION.
+ * state: 0 in a new store, SESSION_STORE_READY once the first process to
+ * open it has filled in the header.
+ * slotCount/slotSize: Layout the creator used, checked against this build's.
+ */
+struct sessionHeader
+{
+    char magic[8];
+    unsigned int version;
+    unsigned int state;
+    unsigned int slotCount;
+    unsigned int slotSize;
+};
+
+/**
+ * A game in the shared session store, from which any server process on the
+ * host can resume it given its token. Fields are in host byte order.
+ * lock: The record's generation in the low 32 bits: odd while a process
+ * reads or writes the record, and each use adds 2. While it is odd the high
+ * 32 bits hold the pid of the process using it. A record found odd with no
+ * process using the store, or held by a pid that no longer exists, was torn
+ * by a process that died.
+ * nonce: Random half of the resume token, changed on every resume; 0 while free.
+ * createdMs/updatedMs: Wall clock times the session was opened and last saved,
+ * so they stay meaningful in a store that outlives the host's uptime.
+ * A record not saved for SESSION_EXPIRY_MS may be reused.
+ * lastMove: Latest stone of an m,n,k board, -1 if none.
+ * rows/columns/k: The m,n,k variant; rows 0 for classic games.
+ * sequenceNumber/sequenceSynced/difficulty/blunderRate: As in tttGame.
+ * lastMessage: The first WIDE_REPLY_FIELDS fields of the game's last reply.
+ * cells: The board, four squares per byte, two bits each (0 empty, 1 client,
+ * 2 server), lowest bits first, as in a RECONNECT_WIDE_BOARD reconnect.
+ */
+struct sessionRecord
+{
+    unsigned long long lock;
+    unsigned int nonce;
+    long long createdMs;
+    long long updatedMs;
+    short lastMove;
+    unsigned char rows;
+    unsigned char columns;
+    unsigned char k;
+    unsigned char sequenceNumber;
+    unsigned char sequenceSynced;
+    unsigned char difficulty;
+    unsigned char blunderRate;
+    unsigned char lastMessage[WIDE_REPLY_FIELDS];
+    unsigned char cells[(MAX_MNK_SQUARES + 3) / 4];
+};
+
+/**
+ * An m,n,k board: rows x columns, k in a row wins. Only games that are not
+ * classic 3x3 tictactoe allocate one.
+ * stones: Squares taken by either player.
+ * lastMove: Square (0 based) of the latest stone, -1 if none; wins are
+ * checked only on lines through it.
+ * hash: Zobrist hash of the variant and every stone, kept up to date by mnkPush and mnkPop.
+ * cells: CLIENT_PLAYER, SERVER_PLAYER or 0 for each square, row by row.
+ */
+struct mnkBoard
+{
+    unsigned char rows;
+    unsigned char columns;
+    unsigned char k;
+    int stones;
+    int lastMove;
+    unsigned long long hash;
+    unsigned char cells[MAX_MNK_SQUARES];
+};
+
+/**
+ * One time-budgeted search for a server move on an m,n,k board.
+ * deadlineMs: Monotonic time at which the search gives up.
+ * nodes: Positions visited; the clock is read every MNK_CLOCK_CHECK_NODES.
+ * aborted: 1 once the deadline passed; the unfinished depth is discarded.
+ * generation: Age stamped on transposition entries this search stores.
+ * stop: Set by the thread that owns the move to end its helpers' searches early.
+ */
+struct mnkSearch
+{
+    long long deadlineMs;
+    long long nodes;
+    int aborted;
+    unsigned int generation;
+    int *stop;
+};
+
+/**
+ * A server move posted for helper threads to search alongside its owner.
+ * Helpers search their own copy of the board with the same deadline, and
+ * share what they find only through the transposition table (Lazy SMP).
+ * wanted: Helpers still to join; the owner zeroes it when it finishes.
+ * joined: Helpers that have joined, numbering each one so they search differently.
+ * active: Helpers still searching; the owner waits for none before returning.
+ * nodes: Nodes searched by helpers that have finished.
+ */
+struct searchJob
+{
+    struct mnkBoard board;
+    long long deadlineMs;
+    unsigned int generation;
+    int wanted;
+    int joined;
+    int active;
+    int stop;
+    long long nodes;
+    struct searchJob *next;
+};
+
+/**
+ * One entry of the shared transposition table. Entries are written and read
+ * as two relaxed atomic words with no lock; check holds the position key
+ * XOR data, so an entry torn by two threads storing at once fails
+ * verification instead of answering for the wrong position.
+ * data: score (bits 0-31), best square + 1 (32-47), depth (48-55),
+ * bound (56-57), generation (58-62) and TRANSPOSITION_VALID (63), set on
+ * every stored entry so a result that encodes to 0 is not taken for an
+ * empty slot.
+ */
+struct transpositionEntry
+{
+    unsigned long long check;
+    unsigned long long data;
+};
+
+/**
+ * Struct for a tictactoe game.
+ * active: 0 if game inactive (junk); 1 if active game.
+ * socket: The client that is playing the game.
+ * board: The game board.
+ * timerDeadline: Wheel tick at which the game times out, while timerArmed.
+ * prevTimer/nextTimer: Links in the timing wheel slot for timerDeadline.
+ * gameNumber: Index of this game in the game pool.
+ * prevFree/nextFree: Free list links while the game is inactive.
+ * nextByAddress: Next game in the same address hash bucket while active.
+ * inBuffer/inLength: Bytes of a frame that has only partly arrived.
+ * outBuffer: Replies not yet taken by the socket, starting at outStart.
+ * outLegacy: 1 if outBuffer holds LEGACY_RECORD_SIZE bytes per legacy frame,
+ * staged into globLegacyFrames when sent; 0 if it holds compact frames as sent.
+ * outFrameSent: Bytes of the first legacy frame the socket has already taken.
+ * watchingWrites: 1 while the backend reports writability for this game.
+ * closing: 1 once the game is over and only waits for its output to drain.
+ * flushQueued: 1 while the game is on the pending flush list.
+ * clientVersion: Protocol version the client last spoke, used for replies.
+ * difficulty: How the server picks its moves, DIFFICULTY_PERFECT, _GREEDY or _RANDOM.
+ * blunderRate: Percent of server moves played at random instead.
+ * mnk: The board of an m,n,k game; NULL for classic games, which use board.
+ * sessionIndex/sessionNonce: The game's record in the session store and the
+ * nonce of its token; sessionIndex is NO_SESSION if it has none.
+ * tokenPending: 1 until the next reply has carried the token to the client.
+ */
+struct tttGame
+{
+
+    unsigned char active;
+    struct sockaddr_in address;
+    struct tttBoard board;
+    unsigned char lastMessage[MESSAGE_FIELDS];
+    //TODO: Make sure this wraps properly
+    unsigned char sequenceNumber;
+    unsigned char sequenceSynced;
+    int connectedSocket;
+    int gameNumber;
+    int prevFree;
+    int nextFree;
+    int nextByAddress;
+    long long timerDeadline;
+    int prevTimer;
+    int nextTimer;
+    unsigned char timerArmed;
+    unsigned char inBuffer[MESSAGE_SIZE];
+    int inLength;
+    unsigned char *outBuffer;
+    int outStart;
+    int outLength;
+    int outCapacity;
+    unsigned char outLegacy;
+    int outFrameSent;
+    unsigned char watchingWrites;
+    unsigned char closing;
+    unsigned char flushQueued;
+    unsigned char evaluationQueued;
+    unsigned char clientVersion;
+    unsigned char difficulty;
+    unsigned char blunderRate;
+    struct mnkBoard *mnk;
+    int sessionIndex;
+    unsigned int sessionNonce;
+    unsigned char tokenPending;
+};
+
+/**
+ * A fixed block of games. Chunks never move once allocated, so pointers to
+ * games stay valid while the pool grows.
+ * liveCount: Number of active games in the chunk.
+ */
+struct gameChunk
+{
+    struct tttGame games[GAME_CHUNK_SIZE];
+    int liveCount;
+};
+
+/**
+ * First message of a hot restart handoff, sent by the old process with its
+ * multicast socket attached.
+ * magic/version: HANDOFF_MAGIC and HANDOFF_VERSION.
+ * status: HANDOFF_ACCEPTED, or HANDOFF_REFUSED if the old process cannot hand off.
+ * workerCount: Shards that follow. The new process runs as many workers, so
+ * every game keeps its shard and its number.
+ * gameSize/boardSize: Sizes of handoffGame and mnkBoard in the old build,
+ * which must match this build's.
+ */
+struct handoffHeader
+{
+    char magic[8];
+    unsigned int version;
+    int status;
+    int workerCount;
+    int gameSize;
+    int boardSize;
+};
+
+/**
+ * One worker's share of a handoff, sent with its listening socket attached.
+ * gameCount: Live games. Their records follow, then their sockets in the same
+ * order, at most HANDOFF_SOCKETS_PER_MESSAGE per message; -1 if the worker
+ * could not copy its games.
+ * highestGame: Largest game number, so the new pool can be grown to hold it.
+ * length: Bytes of the records.
+ */
+struct handoffShard
+{
+    int gameCount;
+    int highestGame;
+    long long length;
+};
+
+/**
+ * A live game in a handoff, followed by inLength bytes of a partly arrived
+ * frame, outLength bytes of output the socket has not taken and, if hasMnk,
+ * the game's mnkBoard. Fields are as in tttGame.
+ */
+struct handoffGame
+{
+    int gameNumber;
+    struct sockaddr_in address;
+    struct tttBoard board;
+    unsigned char lastMessage[MESSAGE_FIELDS];
+    unsigned char sequenceNumber;
+    unsigned char sequenceSynced;
+    unsigned char clientVersion;
+    unsigned char difficulty;
+    unsigned char blunderRate;
+    unsigned char closing;
+    unsigned char outLegacy;
+    unsigned char tokenPending;
+    unsigned char hasMnk;
+    int inLength;
+    int outLength;
+    int outFrameSent;
+    int sessionIndex;
+    unsigned int sessionNonce;
+};
+
+/**
+ * A socket reported ready by an event backend.
+ * data: The pointer registered with the socket (a tttGame, or a global socket).
+ * flags: READY_READ, READY_WRITE and/or READY_ERROR; READY_DATA or READY_ACCEPT from completion backends.
+ * bytes/length: With READY_DATA, bytes already received (length 0 if the peer closed). Valid until the next wait.
+ * acceptedSocket: With READY_ACCEPT, the connection already accepted on the listening socket.
+ */
+struct readyEvent
+{
+    void *data;
+    unsigned char flags;
+    unsigned char *bytes;
+    int length;
+    int acceptedSocket;
+};
+
+/**
+ * Dispatch interface implemented by every event loop backend.
+ * add/remove register a socket with the data pointer handed back by wait.
+ * watchWrites turns write readiness reports on or off for a game socket.
+ * send writes game output, returning bytes taken or -1 with errno (EAGAIN if it must wait for READY_WRITE).
+ * wait fills at most maxEvents ready sockets and returns how many, or -1 on error.
+ */
+struct eventBackend
+{
+    const char *name;
+    int (*init)();
+    int (*add)(int fd, void *data, int edgeTriggered);
+    int (*remove)(int fd);
+    int (*watchWrites)(int fd, void *data, int wantWrite);
+    int (*send)(int fd, void *data, unsigned char *bytes, int length);
+    int (*wait)(struct readyEvent *events, int maxEvents, int timeoutMs);
+};
+
+//Worker threads, set with -t. Everything marked __thread below is owned by one
+//worker, so workers share nothing while handling games.
+int globWorkerCount = 1;
+int globShardBits = 0;
+__thread int globShardId = 0;
+__thread int globShardMaxGames;
+__thread int globShardReservedGames;
+
+//Pool of tttGames, grown and shrunk a chunk at a time
+__thread struct gameChunk **globGameChunks;
+__thread int globChunkCount = 0;
+__thread int globMaxChunks;
+__thread int globReservedChunks;
+__thread int globFreeHead = NO_GAME;
+__thread int globFreeTail = NO_GAME;
+__thread int globActiveGames = 0;
+
+//Game lookup indexes: socket -> game table and address hash buckets
+__thread int *globSocketIndex;
+__thread int globSocketIndexSize = 0;
+__thread int *globAddressBuckets;
+__thread unsigned int globAddressBucketMask;
+
+//Games with output queued this loop iteration, written once the batch is handled
+__thread int *globPendingFlush;
+__thread int globPendingFlushCount = 0;
+__thread int globPendingFlushSize = 0;
+
+//Classic moves placed this loop iteration, evaluated together before replying
+__thread struct pendingMove *globPendingMoves;
+__thread struct tttBoard *globPendingBoards;
+__thread struct boardStatus *globPendingStatus;
+__thread int globPendingMoveCount = 0;
+__thread int globPendingMoveSize = 0;
+
+//Requests repeating the last sequence number, answered from lastMessage, and
+//requests with a sequence number outside the window, rejected; per worker
+__thread long long globRetransmits = 0;
+__thread long long globOutOfWindow = 0;
+
+//Idle timeout wheel: one list of games per tick, with a bit per non-empty slot
+__thread int globTimerSlots[TIMER_WHEEL_SLOTS];
+__thread uint64_t globTimerOccupied[TIMER_SLOT_WORDS];
+__thread long long globTimerTick;
+__thread int globTimedGames = 0;
+
+//Pool limits for the whole server, set with -g and -r
+int globMaxActiveGames = DEFAULT_MAX_ACTIVE_GAMES;
+int globReservedGames = DEFAULT_RESERVED_GAMES;
+
+//Pending connection queue of each listening socket, set with -l
+int globListenBacklog = DEFAULT_LISTEN_BACKLOG;
+
+//Longest the server thinks about a move on an m,n,k board, set with -m
+int globMoveBudgetMs = DEFAULT_MOVE_BUDGET_MS;
+
+//Zobrist keys for each square and player, the player to move, and variants
+unsigned long long globZobrist[MAX_MNK_SQUARES][2];
+unsigned long long globZobristSide;
+
+//Transposition table shared by every game and worker, sized with -T, in
+//buckets of TRANSPOSITION_BUCKET entries: a depth-preferred and an always-replace entry
+int globTranspositionMb = DEFAULT_TRANSPOSITION_MB;
+struct transpositionEntry *globTransposition;
+unsigned long long globTranspositionMask;
+unsigned int globTranspositionGeneration = 0;
+
+//Transposition table counters: each worker counts its own and adds them to
+//the process totals after every search
+__thread long long globProbes, globProbeHits, globProbeCutoffs, globTranspositionStores;
+long long globTotalProbes, globTotalProbeHits, globTotalProbeCutoffs, globTotalTranspositionStores, globTotalSearches;
+
+//Threads searching each server move (-p) and helper threads in the process
+//(-P); idle helpers join the oldest move still wanting help
+int globSearchThreads = 1;
+int globSearchHelpers = -1;
+int globSearchHelpersStarted = 0;
+struct searchJob *globSearchJobs = NULL;
+pthread_mutex_t globSearchLock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t globSearchPosted = PTHREAD_COND_INITIALIZER;
+pthread_cond_t globSearchFinished = PTHREAD_COND_INITIALIZER;
+
+/**
+ * io_uring backend state for one file descriptor.
+ * data: Pointer handed back in ready events.
+ * generation: Bumped on remove, so completions for an earlier socket with the same fd are dropped.
+ * op: The request kept armed on the socket (URING_OP_ACCEPT, URING_OP_POLL or URING_OP_RECV).
+ * sending: 1 while a send is in flight. Sends are issued one at a time to keep them in order.
+ * wantWrite: 1 while the game waits to hear that it may send again.
+ */
+struct uringSocket
+{
+    void *data;
+    int generation;
+    unsigned char op;
+    unsigned char sending;
+    unsigned char wantWrite;
+};
+
+/**
+ * A send in flight on the io_uring backend. The bytes are owned by the
+ * backend until the send completes, so game output can move meanwhile.
+ */
+struct uringSend
+{
+    unsigned char *bytes;
+    int capacity;
+    int length;
+    int fd;
+    int generation;
+    int nextFree;
+};
+
+/**
+ * One connection of the benchmark load generator, playing a game against a server.
+ * board: The client's copy of the board.
+ * state: BENCH_CONNECTING, BENCH_NEW_GAME, BENCH_PLAYING, BENCH_DONE (last move sent) or BENCH_RECONNECT.
+ * reconnect: 1 to open with a RECONNECT instead of a NEW_GAME.
+ * startMs: When the connection was opened.
+ * inBuffer/inLength: Bytes of a reply that has only partly arrived.
+ */
+struct benchClient
+{
+    int connectedSocket;
+    unsigned char reconnect;
+    long long startMs;
+    struct tttBoard board;
+    unsigned char gameNumber;
+    unsigned char sequenceNumber;
+    int state;
+    unsigned char inBuffer[MESSAGE_SIZE];
+    int inLength;
+};
+
+//Event loop backend in use
+__thread struct eventBackend *globBackend;
+int globBackendType = BACKEND_EPOLL;
+
+//epoll backend state
+__thread int globEpollFd;
+
+//io_uring backend state: the mapped rings, the provided receive buffers,
+//and per socket and per send bookkeeping
+__thread int globUringFd = -1;
+__thread unsigned int *globUringSqHead;
+__thread unsigned int *globUringSqTail;
+__thread unsigned int globUringSqMask;
+__thread unsigned int globUringSqEntries;
+__thread unsigned int globUringSqLocalTail;
+__thread struct io_uring_sqe *globUringSqes;
+__thread unsigned int *globUringCqHead;
+__thread unsigned int *globUringCqTail;
+__thread unsigned int globUringCqMask;
+__thread struct io_uring_cqe *globUringCqes;
+__thread struct io_uring_buf_ring *globUringBufferRing;
+__thread unsigned char *globUringBuffers;
+__thread unsigned short globUringBufferTail;
+__thread int globUringRecycle[URING_BUFFER_COUNT];
+__thread int globUringRecycleCount = 0;
+__thread struct uringSocket *globUringSockets;
+__thread int globUringSocketsSize = 0;
+__thread struct uringSend *globUringSends;
+__thread int globUringSendsSize = 0;
+__thread int globUringFreeSend = NO_SEND;
+
+//select backend state
+__thread fd_set globSelectReadSet;
+__thread fd_set globSelectExceptSet;
+__thread fd_set globSelectWriteSet;
+__thread int globSelectMaxFd = -1;
+__thread void *globSelectData[FD_SETSIZE];
+
+//Global variables for shutdown (each worker has its own listening socket)
+__thread int globTCPSocket;
+
+//Scratch space each worker reads sockets into before splitting frames
+__thread unsigned char globReadBuffer[READ_BUFFER_SIZE];
+int globMulticastSocket;
+unsigned short globServerPort;
+
+//Benchmark to run instead of serving, set with -B
+char *globBenchmark = NULL;
+
+//Legacy frames staged for sending; only the first LEGACY_RECORD_SIZE bytes of each are ever written
+__thread unsigned char globLegacyFrames[LEGACY_FLUSH_FRAMES * MESSAGE_SIZE];
+
+//Every classic reply pre-encoded once at startup, by [compact][complete][descriptor][move]: legacy
+//ones as the records queueReply stores, compact ones as sent; only the game and sequence bytes vary
+unsigned char globReplyTemplates[2][GAME_ERROR + 1][REPLY_DESCRIPTORS][SQUARES + 1][LEGACY_RECORD_SIZE];
+
+//Squares of each row, column and diagonal
+const unsigned short globWinLines[WIN_LINES] = {0007, 0070, 0700, 0111, 0222, 0444, 0421, 0124};
+
+//1 for every player mask that contains a whole line, filled once by initWinTable
+unsigned char globWinTable[1 << SQUARES];
+
+//Batch evaluation kernel, the widest the CPU supports, chosen by initEvaluateBoards
+void (*globEvaluateBoards)(const struct tttBoard *boards, struct boardStatus *results, int count);
+const char *globEvaluateKernel = "scalar";
+
+//Solved game tree, filled once by initPositionTable: every reachable position
+//up to symmetry, in an open addressed hash table keyed by canonicalPosition
+struct positionEntry globPositions[POSITION_SLOTS];
+int globSolvedPositions = 0;
+
+//Solution files mapped read-only by -S, one per variant, shared through the
+//page cache by every server on the host; globSolution is the classic board's,
+//whose moves are looked up there instead of in globMoveIndex
+char *globSolutionPaths[MAX_SOLUTION_FILES];
+int globSolutionFileCount = 0;
+struct solutionTable globSolutionTables[MAX_SOLUTION_FILES];
+int globSolutionTableCount = 0;
+const struct solutionTable *globSolution = NULL;
+
+//Classic board's solution key part for each mask of client squares (with
+//the variant's key) and of server squares; a board's key is their XOR
+unsigned long long globSolutionKeys[2][FULL_BOARD + 1];
+
+//Solution file -G writes, the variant it solves (-V), and the table it fills
+char *globGeneratePath = NULL;
+int globGenerateRows = ROWS, globGenerateColumns = COLUMNS, globGenerateK = ROWS;
+struct solutionEntry *globBuildEntries = NULL;
+unsigned long long globBuildMask = 0, globBuildCount = 0;
+
+//Base 3 index of each mask, counting a square as 1: the client's part of a solution index
+unsigned short globTernary[1 << SQUARES];
+
+//Every board encoding's perfect move (low 4 bits) and greedy move (high 4
+//bits), mapped back from globPositions by indexMoves, so a move costs one load
+unsigned char globMoveIndex[POSITIONS];
+
+//The 8 symmetries of the board: where each square goes, the image of every
+//mask, and the symmetry that undoes each one
+unsigned char globTransformSquare[SYMMETRIES][SQUARES];
+unsigned short globTransformMask[SYMMETRIES][1 << SQUARES];
+unsigned char globInverseTransform[SYMMETRIES];
+
+//Greedy moves: win, else block, else the first free square in this order (center, corners, edges)
+const unsigned char globGreedyOrder[SQUARES] = {4, 0, 2, 6, 8, 1, 3, 5, 7};
+
+//Free squares (1-9) of each mask of free squares, in order, for random moves
+unsigned char globFreeSquares[1 << SQUARES][SQUARES];
+
+//Each worker's random moves and blunders
+__thread unsigned int globRandomState = 1;
+
+//Session store shared by every server process on the host, mapped by
+//initSessionStore; NULL if it could not be opened, so games get no tokens
+char *globSessionName = SESSION_STORE_NAME;
+char *globSessionFile = NULL;
+struct sessionRecord *globSessions = NULL;
+
+//What recoverSessions found, if this process opened the store first
+int globSessionsRecovered = -1;
+int globSessionsTorn = 0;
+
+//Hot restart, set with -H: the UNIX socket a new process connects to for the
+//handoff, and the eventfd that stops every worker between event batches for it
+char *globHandoffPath = NULL;
+int globHandoffSocket = -1;
+int globHandoffEvent = -1;
+__thread int globHandoffRequested = 0;
+pthread_mutex_t globHandoffLock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t globHandoffChanged = PTHREAD_COND_INITIALIZER;
+int globHandoffRound = 0;
+int globHandoffParked = 0;
+int globHandoffResumedRound = 0;
+
+//Each worker's games in a handoff: copied by the worker for the old process
+//to send, or received by the new process for the worker to resume
+int globHandoffReceived = 0;
+struct handoffShard globHandoffShards[MAX_WORKERS];
+unsigned char *globHandoffRecords[MAX_WORKERS];
+int *globHandoffSockets[MAX_WORKERS];
+int globHandoffListeners[MAX_WORKERS];
+
+//What each worker last published for discovery answers: its active games, the
+//percent of the last LOAD_WINDOW_US it spent handling events, and when it
+//started waiting (0 while busy), so a worker asleep for a whole window counts as idle
+int globShardGames[MAX_WORKERS];
+int globShardLoad[MAX_WORKERS];
+long long globShardIdleSince[MAX_WORKERS];
+__thread long long globLoadWindowStart;
+__thread long long globLoadIdleUs = 0;
+
+//Seconds between announcements to the multicast group, set with -A; 0 for none
+int globAnnounceSeconds = 0;
+long long globNextAnnounceMs = 0;
+
+//Function declarations
+int parseOptions(int argc, char *argv[]);
+int verifyArgs(int iCount);
+void initTCPSocket();
+void *runWorker(void *shard);
+void receiveHandoff();
+void startHandoffListener();
+void *runHandoffListener(void *unused);
+int sendHandoff(int channel);
+void refuseHandoff(int channel);
+void parkForHandoff();
+void copyShard();
+void restoreShard();
+int handoffWrite(int channel, void *bytes, long long length, int *sockets, int socketCount);
+int handoffRead(int channel, void *bytes, long long length, int *sockets, int socketCount);
+void startWorkers();
+unsigned char protocolGameNumber(int gameNumber);
+long convertPort(char *strPort);
+int frameLength(unsigned char *buffer, int available);
+void decodeFrame(unsigned char *frame, int length, unsigned char fields[MESSAGE_FIELDS]);
+int encodeFrame(unsigned char fields[MESSAGE_FIELDS], int fieldCount, unsigned char wire[MESSAGE_SIZE]);
+void handleMessage(int gameNumber, unsigned char *frame, int length);
+void initReplyTemplates();
+void queueTemplate(struct tttGame *clientGame, int legacy, int move, int complete, int completeDescriptor, unsigned char gameByte, unsigned char clientSequenceNum);
+void queueReply(struct tttGame *clientGame, unsigned char fields[MESSAGE_FIELDS], int fieldCount);
+unsigned char *reserveOutput(struct tttGame *clientGame, int length);
+unsigned char *stageOutput(struct tttGame *clientGame, int *length);
+void consumeOutput(struct tttGame *clientGame, int bytesSent);
+int flushOutput(struct tttGame *clientGame);
+void queueFlush(struct tttGame *clientGame);
+void flushPendingOutput();
+void resendLastMessage(struct tttGame *clientGame);
+void sendMessage(int command, int move, int complete, int completeDescriptor, int gameNumber, unsigned char sequenceNumber, int connectedSocket, unsigned char messageStore[MESSAGE_FIELDS]);
+void initWinTable();
+void initSharedState(struct tttBoard *board);
+int placeMove(struct tttBoard *board, int move, int player);
+int checkWin(struct tttBoard *board, int player);
+void initEvaluateBoards();
+void evaluateBoards(const struct tttBoard *boards, struct boardStatus *results, int count);
+void evaluateBoardsScalar(const struct tttBoard *boards, struct boardStatus *results, int count);
+#if defined(__x86_64__) || defined(__i386__)
+void evaluateBoardsSse2(const struct tttBoard *boards, struct boardStatus *results, int count);
+void evaluateBoardsAvx2(const struct tttBoard *boards, struct boardStatus *results, int count);
+#endif
+int boardResult(struct boardStatus *status, int player);
+void queueEvaluation(int activeGame, int clientComplete, int clientCompleteDescriptor, unsigned char clientSequenceNum);
+void evaluatePendingMoves();
+int placeServerMove(struct tttBoard *board, int difficulty, int blunderRate);
+int firstFreeSquare(struct tttBoard *board);
+int greedyMove(unsigned short mover, unsigned short opponent);
+int randomSquare(unsigned short empty);
+unsigned int nextRandom();
+void initPositionTable();
+unsigned int solutionChecksum(const struct solutionEntry *entries, unsigned long long count);
+void writeSolutionFile(char *path, int rows, int columns, int k);
+int solveMnkPosition(struct mnkBoard *board, int lastSquare);
+void storeSolution(unsigned long long key, int score, int empty, int bestMove, int greedyMove);
+int solutionScore(const struct solutionEntry *entry, int empty);
+void growSolution();
+unsigned long long solutionSlot(const struct solutionEntry *entries, unsigned long long slotMask, unsigned long long key);
+void loadSolutionFile(char *path);
+const struct solutionEntry *findSolution(const struct solutionTable *table, unsigned long long key);
+const struct solutionEntry *findMnkSolution(struct mnkBoard *board);
+void initTransforms();
+unsigned int canonicalPosition(unsigned short client, unsigned short server, int *transform);
+struct positionEntry *findPosition(unsigned int key);
+int lookupMove(struct tttBoard *board, int greedy);
+int canonicalMove(struct tttBoard *board, int greedy);
+void indexMoves();
+int solvePosition(unsigned short client, unsigned short server);
+int validMnkVariant(int rows, int columns, int k);
+struct mnkBoard *createMnkBoard(int rows, int columns, int k);
+int mnkPlace(struct mnkBoard *board, int move, int player);
+void mnkPush(struct mnkBoard *board, int square, int player);
+void mnkPop(struct mnkBoard *board, int square);
+unsigned long long splitMix64(unsigned long long *state);
+void initZobrist();
+void initTransposition();
+unsigned long long variantKey(int rows, int columns, int k);
+int probeTransposition(unsigned long long key, int depth, int ply, int *alpha, int *beta, int *score, int *move);
+void storeTransposition(unsigned long long key, unsigned int generation, int depth, int ply, int score, int bound, int move);
+void addTranspositionCounters();
+void reportTransposition();
+int mnkRunLength(struct mnkBoard *board, int square, int rowStep, int columnStep);
+int mnkWinsAt(struct mnkBoard *board, int square);
+int mnkCheckWin(struct mnkBoard *board, int player);
+int mnkEvaluate(struct mnkBoard *board, int player);
+int mnkCandidates(struct mnkBoard *board, int player, unsigned short moves[MAX_MNK_SQUARES]);
+int mnkNegamax(struct mnkBoard *board, struct mnkSearch *search, int depth, int ply, int alpha, int beta, int player);
+int mnkSearchMove(struct mnkBoard *board, int budgetMs, int threads, int *depthReached, long long *nodes);
+int mnkIterate(struct mnkBoard *board, struct mnkSearch *search, int helper, int *depthReached);
+void startSearchHelpers(int helpers);
+void *runSearchHelper(void *unused);
+int mnkGreedyMove(struct mnkBoard *board, int player);
+int mnkRandomMove(struct mnkBoard *board);
+int placeMnkServerMove(struct mnkBoard *board, int difficulty, int blunderRate);
+void closeSockets();
+void allocateGame(int connectedSocket, struct sockaddr_in clientAddress);
+void startGame(int gameNumber, unsigned char clientSequenceNum, int difficulty, int blunderRate, int rows, int columns, int k);
+int findGameByAddress(struct sockaddr_in address);
+int findGameBySocket(int connectedSocket);
+void handleMove(int activeGame, int command, int clientGameNum, int move, int clientComplete, int clientCompleteDescriptor, unsigned char clientSequenceNum);
+int checkTimeout(struct tttGame *clientGame);
+long long currentTimeMs();
+long long currentTimeUs();
+void initTimerWheel();
+void armTimeout(int gameNumber);
+void disarmTimeout(int gameNumber);
+int nextTimeoutMs();
+int nextWaitMs();
+void initGamePool();
+struct tttGame *getGame(int gameNumber);
+int acquireGameSlot();
+void releaseGameSlot(int gameNumber);
+int growGamePool();
+void shrinkGamePool();
+void pushFreeGame(int gameNumber, int atTail);
+void unlinkFreeGame(int gameNumber);
+void initGameIndexes();
+void indexGame(int gameNumber);
+void unindexGame(int gameNumber);
+unsigned int hashAddress(struct sockaddr_in *address);
+int sameAddress(struct sockaddr_in *first, struct sockaddr_in *second);
+void timeoutGames();
+void sendPacket(unsigned char packet[MESSAGE_SIZE], int connectedSocket);
+void handleEndgame(int gameNumber, int win, int complete, int clientComplete, int clientCompleteDescriptor, unsigned char clientSequenceNum);
+void onReady(struct readyEvent *events, int eventCount);
+void handleClientReadable(int gameNumber);
+void handleClientData(int gameNumber, unsigned char *bytes, int length);
+int handleClientBytes(int gameNumber, int length);
+void closeGame(int gameNumber);
+void closeGameNow(int gameNumber);
+void abortGame(struct tttGame *clientGame);
+void initEventBackend();
+int epollInit();
+int epollAdd(int fd, void *data, int edgeTriggered);
+int epollRemove(int fd);
+int epollWatchWrites(int fd, void *data, int wantWrite);
+int epollWait(struct readyEvent *events, int maxEvents, int timeoutMs);
+int selectInit();
+int selectAdd(int fd, void *data, int edgeTriggered);
+int selectRemove(int fd);
+int selectWatchWrites(int fd, void *data, int wantWrite);
+int selectWait(struct readyEvent *events, int maxEvents, int timeoutMs);
+int directSend(int fd, void *data, unsigned char *bytes, int length);
+int uringInit();
+int uringAdd(int fd, void *data, int edgeTriggered);
+int uringRemove(int fd);
+int uringWatchWrites(int fd, void *data, int wantWrite);
+int uringSend(int fd, void *data, unsigned char *bytes, int length);
+int uringWait(struct readyEvent *events, int maxEvents, int timeoutMs);
+int uringEnter(unsigned int toSubmit, unsigned int minComplete, unsigned int flags, void *arg, size_t argSize);
+struct io_uring_sqe *uringGetSqe();
+int uringSubmit();
+struct uringSocket *uringSocketFor(int fd);
+void uringArm(int fd);
+void uringProvideBuffer(int bufferId);
+int uringComplete(struct io_uring_cqe *cqe, struct readyEvent *event);
+void acceptClient();
+void admitClient(int connectedSocket);
+void debugPacket(unsigned char buf[MESSAGE_FIELDS], int sentOrReceived, int repeatOrNot);
+void initMulticastSocket();
+void handleMulticast();
+void recordLoad(long long idleStart, long long idleEnd);
+unsigned int buildDiscovery(unsigned char message[DISCOVERY_MESSAGE_SIZE], unsigned char version, unsigned char command);
+void announceServer();
+void reconnectGame(int activeGame, unsigned char boardBytes[9]);
+void reconnectMnkGame(int activeGame, unsigned char fields[MESSAGE_FIELDS]);
+int resumeGame(int activeGame, unsigned char fields[MESSAGE_FIELDS], int modifier);
+void initSessionStore();
+void recoverSessions(int fd, struct sessionRecord *records);
+long long sessionTimeMs();
+int lockSession(struct sessionRecord *record);
+void unlockSession(struct sessionRecord *record);
+unsigned int sessionNonce();
+int sessionCell(struct tttGame *clientGame, int square);
+void writeSession(struct sessionRecord *record, struct tttGame *clientGame);
+void openSession(struct tttGame *clientGame);
+void saveSession(struct tttGame *clientGame);
+void endSession(struct tttGame *clientGame);
+int restoreSession(struct tttGame *clientGame, unsigned int index, unsigned int nonce);
+void handleMoveAfterPlaced(struct tttGame *clientGame, int clientComplete, int activeGame, int clientCompleteDescriptor, unsigned char clientSequenceNum, int clientGameNum);
+int answerClientMove(struct tttGame *clientGame, int win, int clientComplete, int activeGame, int clientCompleteDescriptor, unsigned char clientSequenceNum);
+void sendServerMove(struct tttGame *clientGame, int activeGame, int serverMove, int win, unsigned char clientSequenceNum);
+void print_board(struct tttBoard *board);
+void runBenchmark(char *name);
+void benchBackends();
+void benchStorm();
+void benchMoves();
+void benchSymmetry();
+void benchParallel();
+void benchEvaluate();
+void benchReplies();
+int benchRebuildReply(struct tttGame *clientGame, int move, unsigned char sequenceNumber);
+int benchFieldsReply(struct tttGame *clientGame, int move, unsigned char sequenceNumber);
+int benchStormServer(int backendType, int clients, double *seconds, double *slowestMs);
+void benchSendReconnect(struct benchClient *client);
+int benchServer(int backendType, int games, int connections, double *seconds, struct rusage *usage);
+pid_t benchStartServer(int backendType);
+void benchStopServer(pid_t server, struct rusage *usage);
+int benchConnect(struct benchClient *client, int epollFd, int reconnect);
+void benchSend(struct benchClient *client, int move, int complete, int completeDescriptor, int command);
+int benchReply(struct benchClient *client, unsigned char fields[MESSAGE_FIELDS]);
+int benchReadable(struct benchClient *client);
+
+//Event loop backends
+struct eventBackend epollBackend = {"epoll", epollInit, epollAdd, epollRemove, epollWatchWrites, directSend, epollWait};
+struct eventBackend selectBackend = {"select", selectInit, selectAdd, selectRemove, selectWatchWrites, directSend, selectWait};
+struct eventBackend uringBackend = {"io_uring", uringInit, uringAdd, uringRemove, uringWatchWrites, uringSend, uringWait};
+const char *globBackendNames[] = {"epoll", "select", "io_uring"};
+
+/**
+ * Starting point for program.
+ * @param argc: Number of args (number of elements in argv).
+ * @param *argv[]: Array of args.
+ * @retval 0; exit(-1) if error.
+ */
+int main(int argc, char *argv[])
+{
+
+    //Parse options and verify correct usage
+    int firstArg = parseOptions(argc, argv);
+
+    //Write the solution file and stop, without serving
+    if (globGeneratePath != NULL)
+    {
+        initWinTable();
+        initZobrist();
+        initPositionTable();
+        writeSolutionFile(globGeneratePath, globGenerateRows, globGenerateColumns, globGenerateK);
+        return 0;
+    }
+    verifyArgs(argc - firstArg);
+
+    //Port shared by every worker
+    globServerPort = convertPort(argv[firstArg]);
+
+    //Win lookup and solved positions shared read-only by every worker
+    initWinTable();
+    initEvaluateBoards();
+    initZobrist();
+    int file;
+    for (file = 0; file < globSolutionFileCount; file++)
+    {
+        loadSolutionFile(globSolutionPaths[file]);
+    }
+    initPositionTable();
+    initTransposition();
+    initReplyTemplates();
+
+    //Sessions shared with every other server on the host, so reconnects can resume
+    initSessionStore();
+
+    //Take over the sockets and games of the server this one replaces, if one is running
+    if (globHandoffPath != NULL)
+    {
+        receiveHandoff();
+    }
+
+    //Initialize datagram socket, unless it was handed over
+    if (!globHandoffReceived)
+    {
+        initMulticastSocket();
+    }
+
+    if (globBenchmark != NULL)
+    {
+        runBenchmark(globBenchmark);
+        return 0;
+    }
+
+    //Helpers for m,n,k searches, by default enough for every worker to search at once
+    if (globSearchHelpers < 0)
+    {
+        globSearchHelpers = (globSearchThreads - 1) * globWorkerCount;
+        if (globSearchHelpers > MAX_SEARCH_THREADS)
+        {
+            globSearchHelpers = MAX_SEARCH_THREADS;
+        }
+    }
+    startSearchHelpers(globSearchHelpers);
+
+    //Print info
+    printf("Protocol Version: %d\n", VERSION);
+    printf("Event Backend: %s\n", globBackendNames[globBackendType]);
+    printf("Workers: %d\n", globWorkerCount);
+    printf("Search Threads: %d per move, %d helpers\n", globSearchThreads, globSearchHelpers);
+    printf("Board Evaluation: %s\n", globEvaluateKernel);
+    for (file = 0; file < globSolutionTableCount; file++)
+        printf("Solutions: %dx%d k=%d mapped from %s\n", globSolutionTables[file].rows, globSolutionTables[file].columns,
+               globSolutionTables[file].k, globSolutionTables[file].path);
+    if (globSolution == NULL)
+        printf("Solutions: %d positions solved at startup\n", globSolvedPositions);
+    if (globSessions != NULL)
+        printf("Sessions: %d shared in %s\n", SESSION_SLOTS, globSessionFile != NULL ? globSessionFile : globSessionName);
+    else
+        printf("Sessions: unavailable, reconnects use the client's board\n");
+    if (globSessionsRecovered >= 0)
+        printf("Sessions: %d recovered, %d torn records freed\n", globSessionsRecovered, globSessionsTorn);
+    if (globAnnounceSeconds > 0)
+        printf("Discovery: announced to %s:%d every %d seconds\n", MULTICAST_IP, MULTICAST_PORT, globAnnounceSeconds);
+    if (globHandoffPath != NULL)
+    {
+        startHandoffListener();
+        printf("Hot Restart: the next server takes over through %s\n", globHandoffPath);
+    }
+
+    if (globWorkerCount > 1)
+    {
+        startWorkers();
+    }
+    else
+    {
+        runWorker((void *)0);
+    }
+
+    //Execution never gets here
+    return 0;
+}
+
+/**
+ * Start one worker thread per shard and wait on them.
+ * Workers bind the port with SO_REUSEPORT so the kernel spreads new connections across them.
+ * @retval None; exit(-1) if error.
+ */
+void startWorkers()
+{
+    while ((1 << globShardBits) < globWorkerCount)
+    {
+        globShardBits++;
+    }
+
+    pthread_t workers[MAX_WORKERS];
+    int i;
+    for (i = 0; i < globWorkerCount; i++)
+    {
+        errno = pthread_create(&workers[i], NULL, runWorker, (void *)(intptr_t)i);
+        if (errno != 0)
+        {
+            perror("Error: Problem starting worker thread");
+            exit(-1);
+        }
+    }
+    for (i = 0; i < globWorkerCount; i++)
+    {
+        pthread_join(workers[i], NULL);
+    }
+}
+
+/**
+ * Run one shard: its own listening socket, event loop and pool of games.
+ * Shard 0 also answers multicast discovery.
+ * @param *shard: The shard number, cast to a pointer.
+ * @retval Never returns; exit(-1) if error.
+ */
+void *runWorker(void *shard)
+{
+    globShardId = (int)(intptr_t)shard;
+    globShardMaxGames = (globMaxActiveGames + globWorkerCount - 1) / globWorkerCount;
+    globShardReservedGames = globReservedGames / globWorkerCount;
+    globRandomState = (unsigned int)currentTimeMs() ^ ((globShardId + 1) * 0x9E3779B9u);
+    if (globRandomState == 0)
+    {
+        globRandomState = 1;
+    }
+
+    //Initialize listening socket, or take the one the old process handed over
+    if (globHandoffReceived)
+    {
+        globTCPSocket = globHandoffListeners[globShardId];
+        if (globShardMaxGames <= globHandoffShards[globShardId].highestGame)
+        {
+            globShardMaxGames = globHandoffShards[globShardId].highestGame + 1;
+        }
+    }
+    else
+    {
+        initTCPSocket();
+    }
+
+    //Initialize pool of games and their lookup indexes
+    initGamePool();
+    initGameIndexes();
+    initTimerWheel();
+
+    //Register listening sockets with the event backend
+    initEventBackend();
+
+    //Resume the games handed over in their own slots
+    if (globHandoffReceived)
+    {
+        restoreShard();
+    }
+
+    printf("Setup Success, Worker %d Listening...\n\n", globShardId);
+
+    //Ready sockets reported by the backend
+    struct readyEvent readyEvents[MAX_READY_EVENTS];
+    globLoadWindowStart = currentTimeUs();
+
+    //Recieve messages in loop
+    while (1)
+    {
+        //Publish this worker's games, then wait for ready sockets as idle time
+        __atomic_store_n(&globShardGames[globShardId], globActiveGames, __ATOMIC_RELAXED);
+        long long idleStart = currentTimeUs();
+        __atomic_store_n(&globShardIdleSince[globShardId], idleStart, __ATOMIC_RELAXED);
+        int readyCount = (*globBackend).wait(readyEvents, MAX_READY_EVENTS, nextWaitMs());
+        recordLoad(idleStart, currentTimeUs());
+        if (readyCount == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            perror("Error: Event wait failed");
+            closeSockets();
+            exit(-1);
+        }
+        else if (readyCount > 0)
+        {
+            //Something is ready
+            onReady(readyEvents, readyCount);
+        }
+
+        //Answer every classic move placed by this batch, evaluated together
+        evaluatePendingMoves();
+
+        //Reclaim games that have gone quiet
+        timeoutGames();
+
+        //Write every reply produced by this batch, one send per connection
+        flushPendingOutput();
+
+        //Stop here while a new process takes over
+        if (globHandoffRequested)
+        {
+            parkForHandoff();
+        }
+
+        //Give back chunks emptied by this batch
+        shrinkGamePool();
+
+        //Tell the multicast group about this server, when due
+        if (globShardId == 0 && globAnnounceSeconds > 0 && currentTimeMs() >= globNextAnnounceMs)
+        {
+            announceServer();
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Take over from the server listening on globHandoffPath, if one is. Receives
+ * its multicast socket, each worker's listening socket, and every live game
+ * with its connection, then tells it to exit. Bytes clients send meanwhile
+ * wait in the kernel for this process to read. The games are resumed by
+ * restoreShard once the workers start.
+ * @retval None; exit(-1) if the handoff fails part way, leaving the old process serving.
+ */
+void receiveHandoff()
+{
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, globHandoffPath);
+
+    int channel = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (channel == -1 || connect(channel, (struct sockaddr *)&address, sizeof(address)) != 0)
+    {
+        //No server to take over from
+        if (channel != -1)
+        {
+            close(channel);
+        }
+        return;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    //Every game's socket is about to be held by this process as well
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    struct handoffHeader header;
+    int received = handoffRead(channel, &header, sizeof(header), &globMulticastSocket, 1);
+    if (received < 0 || memcmp(header.magic, HANDOFF_MAGIC, sizeof(header.magic)) != 0 || header.version != HANDOFF_VERSION ||
+        header.gameSize != sizeof(struct handoffGame) || header.boardSize != sizeof(struct mnkBoard))
+    {
+        fprintf(stderr, "Error: The server at %s does not speak version %d of the handoff.\n", globHandoffPath, HANDOFF_VERSION);
+        exit(-1);
+    }
+    if (header.status != HANDOFF_ACCEPTED || received != 1)
+    {
+        fprintf(stderr, "Error: The server at %s refused the handoff. Servers on the io_uring backend cannot hand off.\n", globHandoffPath);
+        exit(-1);
+    }
+    if (header.workerCount < 1 || header.workerCount > MAX_WORKERS)
+    {
+        fprintf(stderr, "Error: The server at %s sent %d workers.\n", globHandoffPath, header.workerCount);
+        exit(-1);
+    }
+    if (header.workerCount != globWorkerCount)
+    {
+        printf("Hot Restart: running %d workers, as the old server did\n", header.workerCount);
+        globWorkerCount = header.workerCount;
+    }
+
+    int games = 0;
+    int shard;
+    for (shard = 0; shard < globWorkerCount; shard++)
+    {
+        struct handoffShard *handoff = &globHandoffShards[shard];
+        if (handoffRead(channel, handoff, sizeof(struct handoffShard), &globHandoffListeners[shard], 1) != 1 ||
+            (*handoff).gameCount < 0 || (*handoff).length < 0)
+        {
+            perror("Error: Problem receiving handoff");
+            exit(-1);
+        }
+
+        globHandoffRecords[shard] = malloc((*handoff).length + 1);
+        globHandoffSockets[shard] = malloc(((*handoff).gameCount + 1) * sizeof(int));
+        if (globHandoffRecords[shard] == NULL || globHandoffSockets[shard] == NULL ||
+            handoffRead(channel, globHandoffRecords[shard], (*handoff).length, NULL, 0) != 0)
+        {
+            perror("Error: Problem receiving handed off games");
+            exit(-1);
+        }
+
+        //Sockets come in the order of the records, a message at a time
+        int first;
+        for (first = 0; first < (*handoff).gameCount; first += HANDOFF_SOCKETS_PER_MESSAGE)
+        {
+            int count = (*handoff).gameCount - first;
+            if (count > HANDOFF_SOCKETS_PER_MESSAGE)
+            {
+                count = HANDOFF_SOCKETS_PER_MESSAGE;
+            }
+            int sent;
+            if (handoffRead(channel, &sent, sizeof(sent), globHandoffSockets[shard] + first, count) != count || sent != count)
+            {
+                perror("Error: Problem receiving handed off sockets");
+                exit(-1);
+            }
+        }
+        games += (*handoff).gameCount;
+    }
+
+    //Everything arrived; the old process may exit
+    unsigned char accepted = HANDOFF_ACCEPTED;
+    if (send(channel, &accepted, 1, MSG_NOSIGNAL) != 1)
+    {
+        perror("Error: Problem finishing handoff");
+        exit(-1);
+    }
+    close(channel);
+    globHandoffReceived = 1;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double ms = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+    printf("Hot Restart: took over %d games from %d workers in %.2f ms\n", games, globWorkerCount, ms);
+}
+
+/**
+ * Listen on globHandoffPath for the process that will replace this one,
+ * replacing the socket of the process this one replaced.
+ * @retval None; exit(-1) if error.
+ */
+void startHandoffListener()
+{
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, globHandoffPath);
+
+    unlink(globHandoffPath);
+    globHandoffSocket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    globHandoffEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (globHandoffSocket == -1 || globHandoffEvent == -1 ||
+        bind(globHandoffSocket, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(globHandoffSocket, 1) != 0)
+    {
+        perror("Error: Problem opening hot restart socket");
+        closeSockets();
+        exit(-1);
+    }
+
+    pthread_t listener;
+    errno = pthread_create(&listener, NULL, runHandoffListener, NULL);
+    if (errno != 0)
+    {
+        perror("Error: Problem starting hot restart thread");
+        closeSockets();
+        exit(-1);
+    }
+    pthread_detach(listener);
+}
+
+/**
+ * Wait for a new process and hand it everything. Each worker is stopped
+ * between event batches and copies its own games, then they are all sent
+ * and this process exits. If the new process goes away first, the workers
+ * carry on, since their games were only copied.
+ * @param *unused: Unused.
+ * @retval NULL if the socket fails; otherwise never returns.
+ */
+void *runHandoffListener(void *unused)
+{
+    while (1)
+    {
+        int channel = accept4(globHandoffSocket, NULL, NULL, SOCK_CLOEXEC);
+        if (channel == -1)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+            {
+                continue;
+            }
+            perror("Error: Problem accepting hot restart");
+            return NULL;
+        }
+
+        //io_uring keeps receives in flight on every game, which could take bytes the new process needs
+        if (globBackendType == BACKEND_URING)
+        {
+            printf("--- HANDOFF - Refused, io_uring workers cannot hand off\n");
+            refuseHandoff(channel);
+            close(channel);
+            continue;
+        }
+
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        //Stop every worker; the event stays readable until they are all parked
+        pthread_mutex_lock(&globHandoffLock);
+        globHandoffRound++;
+        globHandoffParked = 0;
+        pthread_mutex_unlock(&globHandoffLock);
+        uint64_t one = 1;
+        if (write(globHandoffEvent, &one, sizeof(one)) != sizeof(one))
+        {
+            perror("Error: Problem signalling workers for hot restart");
+        }
+        pthread_mutex_lock(&globHandoffLock);
+        while (globHandoffParked < globWorkerCount)
+        {
+            pthread_cond_wait(&globHandoffChanged, &globHandoffLock);
+        }
+        pthread_mutex_unlock(&globHandoffLock);
+
+        int games = 0;
+        int shard;
+        for (shard = 0; shard < globWorkerCount; shard++)
+        {
+            games += globHandoffShards[shard].gameCount;
+        }
+        if (sendHandoff(channel) == 0)
+        {
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            double ms = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+            printf("--- HANDOFF - %d games handed to the new process in %.2f ms, Exiting\n", games, ms);
+            fflush(stdout);
+            exit(0);
+        }
+
+        //The new process did not take over; carry on serving
+        printf("--- HANDOFF - New process did not take over, Resuming\n");
+        close(channel);
+        uint64_t signalled;
+        if (read(globHandoffEvent, &signalled, sizeof(signalled)) != sizeof(signalled))
+        {
+            perror("Error: Problem clearing hot restart event");
+        }
+        pthread_mutex_lock(&globHandoffLock);
+        globHandoffResumedRound = globHandoffRound;
+        pthread_cond_broadcast(&globHandoffChanged);
+        pthread_mutex_unlock(&globHandoffLock);
+    }
+    return NULL;
+}
+
+/**
+ * Send the multicast socket, then each worker's listening socket, games and
+ * game sockets, and wait for the new process to confirm it has them all.
+ * @param  channel: The connection from the new process.
+ * @retval 0 once the new process has everything; -1 otherwise.
+ */
+int sendHandoff(int channel)
+{
+    int shard;
+    for (shard = 0; shard < globWorkerCount; shard++)
+    {
+        if (globHandoffShards[shard].gameCount < 0)
+        {
+            refuseHandoff(channel);
+            return -1;
+        }
+    }
+
+    struct handoffHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, HANDOFF_MAGIC, sizeof(header.magic));
+    header.version = HANDOFF_VERSION;
+    header.status = HANDOFF_ACCEPTED;
+    header.workerCount = globWorkerCount;
+    header.gameSize = sizeof(struct handoffGame);
+    header.boardSize = sizeof(struct mnkBoard);
+    if (handoffWrite(channel, &header, sizeof(header), &globMulticastSocket, 1) != 0)
+    {
+        return -1;
+    }
+
+    for (shard = 0; shard < globWorkerCount; shard++)
+    {
+        struct handoffShard *handoff = &globHandoffShards[shard];
+        if (handoffWrite(channel, handoff, sizeof(struct handoffShard), &globHandoffListeners[shard], 1) != 0 ||
+            handoffWrite(channel, globHandoffRecords[shard], (*handoff).length, NULL, 0) != 0)
+        {
+            return -1;
+        }
+        int first;
+        for (first = 0; first < (*handoff).gameCount; first += HANDOFF_SOCKETS_PER_MESSAGE)
+        {
+            int count = (*handoff).gameCount - first;
+            if (count > HANDOFF_SOCKETS_PER_MESSAGE)
+            {
+                count = HANDOFF_SOCKETS_PER_MESSAGE;
+            }
+            if (handoffWrite(channel, &count, sizeof(count), globHandoffSockets[shard] + first, count) != 0)
+            {
+                return -1;
+            }
+        }
+    }
+
+    unsigned char accepted;
+    if (recv(channel, &accepted, 1, 0) != 1 || accepted != HANDOFF_ACCEPTED)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Tell a new process this one will not hand off.
+ * @param  channel: The connection from the new process.
+ * @retval None.
+ */
+void refuseHandoff(int channel)
+{
+    struct handoffHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, HANDOFF_MAGIC, sizeof(header.magic));
+    header.version = HANDOFF_VERSION;
+    header.status = HANDOFF_REFUSED;
+    header.gameSize = sizeof(struct handoffGame);
+    header.boardSize = sizeof(struct mnkBoard);
+    handoffWrite(channel, &header, sizeof(header), NULL, 0);
+}
+
+/**
+ * Copy this worker's games for the handoff and wait while they are sent.
+ * Called between event batches, once every reply of the batch has been
+ * written, so the games hold nothing but their partial input and what the
+ * socket would not take. Returns only if the handoff fails.
+ * @retval None.
+ */
+void parkForHandoff()
+{
+    globHandoffRequested = 0;
+    copyShard();
+
+    pthread_mutex_lock(&globHandoffLock);
+    int round = globHandoffRound;
+    globHandoffParked++;
+    pthread_cond_broadcast(&globHandoffChanged);
+    while (globHandoffResumedRound < round)
+    {
+        pthread_cond_wait(&globHandoffChanged, &globHandoffLock);
+    }
+    pthread_mutex_unlock(&globHandoffLock);
+
+    free(globHandoffRecords[globShardId]);
+    free(globHandoffSockets[globShardId]);
+    globHandoffRecords[globShardId] = NULL;
+    globHandoffSockets[globShardId] = NULL;
+}
+
+/**
+ * Copy this worker's listening socket and live games into its handoff shard.
+ * The games themselves are left as they are.
+ * @retval None; the shard's gameCount is -1 if out of memory.
+ */
+void copyShard()
+{
+    struct handoffShard *handoff = &globHandoffShards[globShardId];
+    (*handoff).gameCount = 0;
+    (*handoff).highestGame = NO_GAME;
+    (*handoff).length = 0;
+    globHandoffListeners[globShardId] = globTCPSocket;
+
+    //Size the records first, so they are built in one buffer
+    int chunk, i;
+    for (chunk = 0; chunk < globChunkCount; chunk++)
+    {
+        if ((*globGameChunks[chunk]).liveCount == 0)
+        {
+            continue;
+        }
+        for (i = 0; i < GAME_CHUNK_SIZE; i++)
+        {
+            struct tttGame *clientGame = &(*globGameChunks[chunk]).games[i];
+            if ((*clientGame).active)
+            {
+                (*handoff).gameCount++;
+                (*handoff).length += sizeof(struct handoffGame) + (*clientGame).inLength + (*clientGame).outLength +
+                                     ((*clientGame).mnk != NULL ? sizeof(struct mnkBoard) : 0);
+            }
+        }
+    }
+
+    unsigned char *position = malloc((*handoff).length + 1);
+    int *sockets = malloc(((*handoff).gameCount + 1) * sizeof(int));
+    globHandoffRecords[globShardId] = position;
+    globHandoffSockets[globShardId] = sockets;
+    if (position == NULL || sockets == NULL)
+    {
+        perror("Error: Problem copying games for hot restart");
+        (*handoff).gameCount = -1;
+        return;
+    }
+
+    for (chunk = 0; chunk < globChunkCount; chunk++)
+    {
+        if ((*globGameChunks[chunk]).liveCount == 0)
+        {
+            continue;
+        }
+        for (i = 0; i < GAME_CHUNK_SIZE; i++)
+        {
+            struct tttGame *clientGame = &(*globGameChunks[chunk]).games[i];
+            if (!(*clientGame).active)
+            {
+                continue;
+            }
+            struct handoffGame record;
+            memset(&record, 0, sizeof(record));
+            record.gameNumber = (*clientGame).gameNumber;
+            record.address = (*clientGame).address;
+            record.board = (*clientGame).board;
+            memcpy(record.lastMessage, (*clientGame).lastMessage, MESSAGE_FIELDS);
+            record.sequenceNumber = (*clientGame).sequenceNumber;
+            record.sequenceSynced = (*clientGame).sequenceSynced;
+            record.clientVersion = (*clientGame).clientVersion;
+            record.difficulty = (*clientGame).difficulty;
+            record.blunderRate = (*clientGame).blunderRate;
+            record.closing = (*clientGame).closing;
+            record.outLegacy = (*clientGame).outLegacy;
+            record.tokenPending = (*clientGame).tokenPending;
+            record.hasMnk = (*clientGame).mnk != NULL;
+            record.inLength = (*clientGame).inLength;
+            record.outLength = (*clientGame).outLength;
+            record.outFrameSent = (*clientGame).outFrameSent;
+            record.sessionIndex = (*clientGame).sessionIndex;
+            record.sessionNonce = (*clientGame).sessionNonce;
+
+            memcpy(position, &record, sizeof(record));
+            position += sizeof(record);
+            memcpy(position, (*clientGame).inBuffer, record.inLength);
+            position += record.inLength;
+            memcpy(position, (*clientGame).outBuffer + (*clientGame).outStart, record.outLength);
+            position += record.outLength;
+            if (record.hasMnk)
+            {
+                memcpy(position, (*clientGame).mnk, sizeof(struct mnkBoard));
+                position += sizeof(struct mnkBoard);
+            }
+            *sockets++ = (*clientGame).connectedSocket;
+            (*handoff).highestGame = record.gameNumber;
+        }
+    }
+}
+
+/**
+ * Resume the games the old process handed this worker, each in the slot with
+ * its old number, so the game byte clients send still finds it. Input waiting
+ * on the sockets is read on the first wait, and output the old process could
+ * not send is written straight away. Idle timeouts start over.
+ * @retval None; exit(-1) if the pool cannot hold the games.
+ */
+void restoreShard()
+{
+    struct handoffShard *handoff = &globHandoffShards[globShardId];
+    unsigned char *position = globHandoffRecords[globShardId];
+    int restored = 0;
+    int i;
+    for (i = 0; i < (*handoff).gameCount; i++)
+    {
+        struct handoffGame record;
+        memcpy(&record, position, sizeof(record));
+        position += sizeof(record);
+        int connectedSocket = globHandoffSockets[globShardId][i];
+
+        while (globChunkCount <= (record.gameNumber >> GAME_CHUNK_SHIFT))
+        {
+            if (growGamePool() != 0)
+            {
+                perror("Error: Problem growing game pool for handed off games");
+                closeSockets();
+                exit(-1);
+            }
+        }
+        unlinkFreeGame(record.gameNumber);
+        (*globGameChunks[record.gameNumber >> GAME_CHUNK_SHIFT]).liveCount++;
+        globActiveGames++;
+
+        struct tttGame *clientGame = getGame(record.gameNumber);
+        (*clientGame).active = 1;
+        (*clientGame).address = record.address;
+        (*clientGame).board = record.board;
+        memcpy((*clientGame).lastMessage, record.lastMessage, MESSAGE_FIELDS);
+        (*clientGame).sequenceNumber = record.sequenceNumber;
+        (*clientGame).sequenceSynced = record.sequenceSynced;
+        (*clientGame).connectedSocket = connectedSocket;
+        (*clientGame).inLength = record.inLength;
+        memcpy((*clientGame).inBuffer, position, record.inLength);
+        position += record.inLength;
+        (*clientGame).outBuffer = NULL;
+        (*clientGame).outStart = 0;
+        (*clientGame).outLength = 0;
+        (*clientGame).outCapacity = 0;
+        if (record.outLength > 0)
+        {
+            (*clientGame).outBuffer = malloc(record.outLength);
+            if ((*clientGame).outBuffer != NULL)
+            {
+                memcpy((*clientGame).outBuffer, position, record.outLength);
+                (*clientGame).outLength = record.outLength;
+                (*clientGame).outCapacity = record.outLength;
+            }
+        }
+        position += record.outLength;
+        (*clientGame).outLegacy = record.outLegacy;
+        (*clientGame).outFrameSent = record.outFrameSent;
+        (*clientGame).watchingWrites = 0;
+        (*clientGame).closing = record.closing;
+        (*clientGame).flushQueued = 0;
+        (*clientGame).evaluationQueued = 0;
+        (*clientGame).clientVersion = record.clientVersion;
+        (*clientGame).difficulty = record.difficulty;
+        (*clientGame).blunderRate = record.blunderRate;
+        (*clientGame).mnk = NULL;
+        if (record.hasMnk)
+        {
+            (*clientGame).mnk = malloc(sizeof(struct mnkBoard));
+            if ((*clientGame).mnk != NULL)
+            {
+                memcpy((*clientGame).mnk, position, sizeof(struct mnkBoard));
+            }
+            position += sizeof(struct mnkBoard);
+        }
+        (*clientGame).sessionIndex = record.sessionIndex;
+        (*clientGame).sessionNonce = record.sessionNonce;
+        (*clientGame).tokenPending = record.tokenPending;
+        (*clientGame).timerArmed = 0;
+
+        if ((record.outLength > 0 && (*clientGame).outBuffer == NULL) || (record.hasMnk && (*clientGame).mnk == NULL) ||
+            (*globBackend).add(connectedSocket, clientGame, EDGE_TRIGGERED) != 0)
+        {
+            printf("--- ERROR - Client %d - Could not resume handed off game, Closing game\n", record.gameNumber);
+            close(connectedSocket);
+            free((*clientGame).outBuffer);
+            (*clientGame).outBuffer = NULL;
+            free((*clientGame).mnk);
+            (*clientGame).mnk = NULL;
+            releaseGameSlot(record.gameNumber);
+            continue;
+        }
+        indexGame(record.gameNumber);
+        armTimeout(record.gameNumber);
+        if ((*clientGame).outLength > 0 || (*clientGame).closing)
+        {
+            queueFlush(clientGame);
+        }
+        restored++;
+    }
+
+    free(globHandoffRecords[globShardId]);
+    free(globHandoffSockets[globShardId]);
+    globHandoffRecords[globShardId] = NULL;
+    globHandoffSockets[globShardId] = NULL;
+    printf("--- HANDOFF - Worker %d resumed %d games\n", globShardId, restored);
+
+    //Output the old process could not send goes out before the first wait
+    flushPendingOutput();
+}
+
+/**
+ * Write all of a handoff message, with sockets attached to its first byte.
+ * @param  channel: The handoff connection.
+ * @param  *bytes: The message.
+ * @param  length: Bytes in the message.
+ * @param  *sockets: Sockets to pass, or NULL.
+ * @param  socketCount: Number of sockets, at most HANDOFF_SOCKETS_PER_MESSAGE.
+ * @retval 0 on success; -1 on error.
+ */
+int handoffWrite(int channel, void *bytes, long long length, int *sockets, int socketCount)
+{
+    char control[CMSG_SPACE(HANDOFF_SOCKETS_PER_MESSAGE * sizeof(int))];
+    long long written = 0;
+    while (written < length)
+    {
+        struct iovec chunk;
+        chunk.iov_base = (unsigned char *)bytes + written;
+        chunk.iov_len = length - written;
+        struct msghdr message;
+        memset(&message, 0, sizeof(message));
+        message.msg_iov = &chunk;
+        message.msg_iovlen = 1;
+        if (written == 0 && socketCount > 0)
+        {
+            memset(control, 0, sizeof(control));
+            message.msg_control = control;
+            message.msg_controllen = CMSG_SPACE(socketCount * sizeof(int));
+            struct cmsghdr *header = CMSG_FIRSTHDR(&message);
+            (*header).cmsg_level = SOL_SOCKET;
+            (*header).cmsg_type = SCM_RIGHTS;
+            (*header).cmsg_len = CMSG_LEN(socketCount * sizeof(int));
+            memcpy(CMSG_DATA(header), sockets, socketCount * sizeof(int));
+        }
+
+        ssize_t sent = sendmsg(channel, &message, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (sent <= 0)
+        {
+            return -1;
+        }
+        written += sent;
+    }
+    return 0;
+}
+
+/**
+ * Read exactly one handoff message and the sockets passed with it. Reading
+ * exactly its length keeps the next message's sockets out of this read.
+ * @param  channel: The handoff connection.
+ * @param  *bytes: Where to read the message.
+ * @param  length: Bytes in the message.
+ * @param  *sockets: Where to store passed sockets, or NULL.
+ * @param  socketCount: Most sockets expected.
+ * @retval Number of sockets received; -1 on error.
+ */
+int handoffRead(int channel, void *bytes, long long length, int *sockets, int socketCount)
+{
+    char control[CMSG_SPACE(HANDOFF_SOCKETS_PER_MESSAGE * sizeof(int))];
+    long long received = 0;
+    int socketsReceived = 0;
+    int unexpected = 0;
+    while (received < length)
+    {
+        struct iovec chunk;
+        chunk.iov_base = (unsigned char *)bytes + received;
+        chunk.iov_len = length - received;
+        struct msghdr message;
+        memset(&message, 0, sizeof(message));
+        message.msg_iov = &chunk;
+        message.msg_iovlen = 1;
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+
+        ssize_t got = recvmsg(channel, &message, MSG_CMSG_CLOEXEC);
+        if (got < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (got <= 0 || (message.msg_flags & MSG_CTRUNC))
+        {
+            return -1;
+        }
+
+        struct cmsghdr *header;
+        for (header = CMSG_FIRSTHDR(&message); header != NULL; header = CMSG_NXTHDR(&message, header))
+        {
+            if ((*header).cmsg_level != SOL_SOCKET || (*header).cmsg_type != SCM_RIGHTS)
+            {
+                continue;
+            }
+            int count = ((*header).cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            int *passed = (int *)CMSG_DATA(header);
+            int j;
+            for (j = 0; j < count; j++)
+            {
+                int passedSocket;
+                memcpy(&passedSocket, passed + j, sizeof(int));
+                if (socketsReceived < socketCount)
+                {
+                    sockets[socketsReceived++] = passedSocket;
+                }
+                else
+                {
+                    close(passedSocket);
+                    unexpected = 1;
+                }
+            }
+        }
+        received += got;
+    }
+    return unexpected ? -1 : socketsReceived;
+}
+
+/**
+ * Parses command-line options.
+ * -b <epoll|select|uring>: The event loop backend to use (default epoll).
+ * -g <games>: Most games active at once (default DEFAULT_MAX_ACTIVE_GAMES).
+ * -r <games>: Games kept allocated when idle (default DEFAULT_RESERVED_GAMES).
+ * -t <workers>: Worker threads, each with its own shard of games (default 1).
+ * -l <backlog>: Pending connections each listening socket queues (default DEFAULT_LISTEN_BACKLOG).
+ * -m <ms>: Time budget for each server move on an m,n,k board (default DEFAULT_MOVE_BUDGET_MS).
+ * -T <MB>: Size of the shared transposition table (default DEFAULT_TRANSPOSITION_MB).
+ * -p <threads>: Threads searching each m,n,k server move (default 1).
+ * -P <helpers>: Helper threads in the process for those searches (default (p - 1) * workers).
+ * -S <file>: Map a solution file, for classic moves instead of solving at startup or for
+ *            m,n,k moves before searching; once per variant, at most MAX_SOLUTION_FILES.
+ * -s <name>: Shared memory object holding the session store (default SESSION_STORE_NAME).
+ * -F <file>: Keep the session store in this file instead of shared memory.
+ * -H <path>: UNIX socket for hot restarts: take over from the server listening there, then listen there for the next one.
+ * -A <seconds>: Announce this server to the multicast group this often (default never).
+ * -G <file>: Write the solution file and exit; no port is needed.
+ * -V <rows>,<columns>,<k>: Variant -G solves (default the classic board).
+ * -B <name>: Run a benchmark against servers on the port instead of serving.
+ * @param argc: Number of args (number of elements in argv).
+ * @param *argv[]: Array of args.
+ * @retval Index of the first positional arg; exit(-1) if error.
+ */
+int parseOptions(int argc, char *argv[])
+{
+    int option;
+    while ((option = getopt(argc, argv, "b:g:r:t:l:m:T:p:P:S:s:F:H:A:G:V:B:")) != -1)
+    {
+        switch (option)
+        {
+        case 'b':
+            if (strcmp(optarg, "epoll") == 0)
+            {
+                globBackendType = BACKEND_EPOLL;
+            }
+            else if (strcmp(optarg, "select") == 0)
+            {
+                globBackendType = BACKEND_SELECT;
+            }
+            else if (strcmp(optarg, "uring") == 0)
+            {
+                globBackendType = BACKEND_URING;
+            }
+            else
+            {
+                fprintf(stderr, "Error: Unknown backend %s. Use epoll, select or uring.\n", optarg);
+                exit(-1);
+            }
+            break;
+        case 'g':
+            globMaxActiveGames = atoi(optarg);
+            if (globMaxActiveGames <= 0)
+            {
+                fprintf(stderr, "Error: Max games must be positive.\n");
+                exit(-1);
+            }
+            break;
+        case 'r':
+            globReservedGames = atoi(optarg);
+            if (globReservedGames < 0)
+            {
+                fprintf(stderr, "Error: Reserved games must not be negative.\n");
+                exit(-1);
+            }
+            break;
+        case 't':
+            globWorkerCount = atoi(optarg);
+            if (globWorkerCount <= 0 || globWorkerCount > MAX_WORKERS)
+            {
+                fprintf(stderr, "Error: Workers must be between 1 and %d.\n", MAX_WORKERS);
+                exit(-1);
+            }
+            break;
+        case 'l':
+            globListenBacklog = atoi(optarg);
+            if (globListenBacklog <= 0)
+            {
+                fprintf(stderr, "Error: Listen backlog must be positive.\n");
+                exit(-1);
+            }
+            break;
+        case 'm':
+            globMoveBudgetMs = atoi(optarg);
+            if (globMoveBudgetMs <= 0)
+            {
+                fprintf(stderr, "Error: Move budget must be positive.\n");
+                exit(-1);
+            }
+            break;
+        case 'T':
+            globTranspositionMb = atoi(optarg);
+            if (globTranspositionMb <= 0)
+            {
+                fprintf(stderr, "Error: Transposition table size must be positive.\n");
+                exit(-1);
+            }
+            break;
+        case 'p':
+            globSearchThreads = atoi(optarg);
+            if (globSearchThreads <= 0 || globSearchThreads > MAX_SEARCH_THREADS)
+            {
+                fprintf(stderr, "Error: Search threads must be between 1 and %d.\n", MAX_SEARCH_THREADS);
+                exit(-1);
+            }
+            break;
+        case 'P':
+            globSearchHelpers = atoi(optarg);
+            if (globSearchHelpers < 0 || globSearchHelpers > MAX_SEARCH_THREADS)
+            {
+                fprintf(stderr, "Error: Search helpers must be between 0 and %d.\n", MAX_SEARCH_THREADS);
+                exit(-1);
+            }
+            break;
+        case 'S':
+            if (globSolutionFileCount == MAX_SOLUTION_FILES)
+            {
+                fprintf(stderr, "Error: At most %d solution files can be mapped.\n", MAX_SOLUTION_FILES);
+                exit(-1);
+            }
+            globSolutionPaths[globSolutionFileCount++] = optarg;
+            break;
+        case 's':
+            globSessionName = optarg;
+            break;
+        case 'F':
+            globSessionFile = optarg;
+            break;
+        case 'H':
+            if (strlen(optarg) >= sizeof(((struct sockaddr_un){0}).sun_path))
+            {
+                fprintf(stderr, "Error: Hot restart socket path is too long.\n");
+                exit(-1);
+            }
+            globHandoffPath = optarg;
+            break;
+        case 'A':
+            globAnnounceSeconds = atoi(optarg);
+            if (globAnnounceSeconds <= 0)
+            {
+                fprintf(stderr, "Error: Announcement interval must be positive.\n");
+                exit(-1);
+            }
+            break;
+        case 'G':
+            globGeneratePath = optarg;
+            break;
+        case 'V':
+            if (sscanf(optarg, "%d,%d,%d", &globGenerateRows, &globGenerateColumns, &globGenerateK) != 3 ||
+                !validMnkVariant(globGenerateRows, globGenerateColumns, globGenerateK))
+            {
+                fprintf(stderr, "Error: Variant must be rows,columns,k with sides from %d to %d and k from %d to the longer side.\n",
+                        MIN_MNK_SIDE, MAX_MNK_SIDE, MIN_MNK_SIDE);
+                exit(-1);
+            }
+            break;
+        case 'B':
+            globBenchmark = optarg;
+            break;
+        default:
+            fprintf(stderr, "Error: Unknown option. Consult readme for usage.\n");
+            exit(-1);
+        }
+    }
+    return optind;
+}
+
+/**
+ * Verifies there are the correct number of positional command-line args.
+ * @param iCount: Number of positional args passed.
+ * @retval 0 success; exit(-1) if error.
+ */
+int verifyArgs(int iCount)
+{
+    if (iCount != 1)
+    {
+        perror("Error: Incorrect number of args. Consult readme for usage.");
+        exit(-1);
+    }
+    else
+    {
+        return 0;
+    }
+}
+
+/**
+ * Opens and binds this worker's listening socket on globServerPort.
+ * @retval None; exit(-1) if error.
+ */
+void initTCPSocket()
+{
+    struct sockaddr_in socketAddressServer;
+    socketAddressServer.sin_family = AF_INET;
+    socketAddressServer.sin_port = htons(globServerPort);
+    socketAddressServer.sin_addr.s_addr = INADDR_ANY;
+
+    //Non-blocking so acceptClient() can drain the queue until it is empty
+    globTCPSocket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+    if (globTCPSocket == 0)
+    {
+        perror("Error: Problem opening socket");
+        exit(-1);
+    }
+
+    //Rebind straight away even while closed games sit in TIME_WAIT
+    int reuseAddress = 1;
+    setsockopt(globTCPSocket, SOL_SOCKET, SO_REUSEADDR, &reuseAddress, sizeof(reuseAddress));
+
+    //Every worker binds the same port
+    int reusePort = 1;
+    if (globWorkerCount > 1 && setsockopt(globTCPSocket, SOL_SOCKET, SO_REUSEPORT, &reusePort, sizeof(reusePort)) != 0)
+    {
+        perror("Error: Problem setting SO_REUSEPORT");
+        close(globTCPSocket);
+        exit(-1);
+    }
+
+    int bindSuccess = bind(globTCPSocket, (struct sockaddr *)&socketAddressServer, sizeof(socketAddressServer));
+
+    if (bindSuccess != 0)
+    {
+        perror("Error: Problem binding socket");
+        close(globTCPSocket);
+        exit(-1);
+    }
+
+    //Start listening; the kernel caps the backlog at net.core.somaxconn
+    int listenSuccess = listen(globTCPSocket, globListenBacklog);
+
+    if (listenSuccess != 0)
+    {
+        perror("Error: Problem starting socket listen");
+        close(globTCPSocket);
+        exit(-1);
+    }
+}
+
+/**
+ * Parses the passed in string to a long.
+ * @param *strPort: the string to parse.
+ * @retval Port number to use; exit(-1) if error.
+ */
+long convertPort(char *strPort)
+{
+    char *strEndOfParse;
+
+    long lResult = strtol(strPort, &strEndOfParse, 10);
+    if (lResult == 0)
+    {
+        perror("Error: Problem converting port number");
+        exit(-1);
+    }
+
+    if ((*strEndOfParse != '\0') && (*strEndOfParse != '\n'))
+    {
+        perror("Port arg parsing error: invalid character. Please use only ASCII numeric characters");
+        exit(-1);
+    }
+
+    //Conversion success, validate range conforms to port range.
+    if (lResult < 0)
+    {
+        perror("Error: Port out of range. Min port number is 0.");
+        exit(-1);
+    }
+    if (lResult > 65535)
+    {
+        perror("Error: Port out of range. Max port number is 65535.");
+        exit(-1);
+    }
+
+    return lResult;
+}
+
+/**
+ * Open the non-blocking discovery socket and join the multicast group.
+ * SO_REUSEADDR lets every server on the host bind the group port, so each
+ * of them hears the probes; handleMulticast drains it from the event loop.
+ * @retval None; exit(-1) if error.
+ */
+void initMulticastSocket()
+{
+    struct sockaddr_in multicastAddr;
+    multicastAddr.sin_family = AF_INET;
+    multicastAddr.sin_port = htons(MULTICAST_PORT);
+    multicastAddr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    globMulticastSocket = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+    if (globMulticastSocket == -1)
+    {
+        perror("Error: Problem opening socket");
+        close(globTCPSocket);
+        exit(-1);
+    }
+
+    int reuse = 1;
+    if (setsockopt(globMulticastSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) == -1)
+    {
+        perror("Error: Problem setting multicast socket options");
+        close(globMulticastSocket);
+        exit(-1);
+    }
+
+    int bindSuccess = bind(globMulticastSocket, (struct sockaddr *)&multicastAddr, sizeof(multicastAddr));
+
+    if (bindSuccess != 0)
+    {
+        perror("Error: Problem binding socket");
+        close(globTCPSocket);
+        close(globMulticastSocket);
+        exit(-1);
+    }
+
+    struct ip_mreq mreq;
+    mreq.imr_multiaddr.s_addr = inet_addr(MULTICAST_IP);
+    mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+    if (setsockopt(globMulticastSocket, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) == -1)
+    {
+        perror("Error: Problem setting multicast socket options");
+        close(globTCPSocket);
+        close(globMulticastSocket);
+        exit(-1);
+    }
+}
+
+/**
+ * Size of the frame starting at buffer. Versions before 9 use fixed MESSAGE_SIZE
+ * frames; version 9 frames are [version][frame length][fields 1..n].
+ * @param  *buffer: Start of the frame.
+ * @param  available: Bytes available at buffer.
+ * @retval Frame size in bytes; 0 if more bytes are needed to tell; MALFORMED_FRAME if invalid.
+ */
+int frameLength(unsigned char *buffer, int available)
+{
+    if (available < 1)
+    {
+        return 0;
+    }
+    if (buffer[0] < COMPACT_VERSION)
+    {
+        return MESSAGE_SIZE;
+    }
+    if (available < COMPACT_HEADER_SIZE)
+    {
+        return 0;
+    }
+    if (buffer[1] < MIN_COMPACT_FRAME || buffer[1] > MAX_COMPACT_FRAME)
+    {
+        return MALFORMED_FRAME;
+    }
+    return buffer[1];
+}
+
+/**
+ * Unpack a frame of any version into the fixed field layout used by the game
+ * code (byte 0 version, byte 1 move, ..., bytes 7-15 reconnect board).
+ * Fields the frame does not carry are zero.
+ * @param  *frame: The complete frame.
+ * @param  length: Size of the frame.
+ * @param  fields[MESSAGE_FIELDS]: Filled with the message fields.
+ * @retval None.
+ */
+void decodeFrame(unsigned char *frame, int length, unsigned char fields[MESSAGE_FIELDS])
+{
+    memset(fields, 0, MESSAGE_FIELDS);
+    if (frame[0] < COMPACT_VERSION)
+    {
+        memcpy(fields, frame, MESSAGE_FIELDS);
+        return;
+    }
+    fields[0] = frame[0];
+    memcpy(&fields[1], &frame[COMPACT_HEADER_SIZE], length - COMPACT_HEADER_SIZE);
+}
+
+/**
+ * Pack message fields into a frame for the version in fields[0].
+ * Legacy frames are zero padded to MESSAGE_SIZE; compact frames carry only fieldCount fields.
+ * @param  fields[MESSAGE_FIELDS]: The message fields.
+ * @param  fieldCount: Number of meaningful fields, including the version.
+ * @param  wire[MESSAGE_SIZE]: Filled with the frame.
+ * @retval Size of the frame.
+ */
+int encodeFrame(unsigned char fields[MESSAGE_FIELDS], int fieldCount, unsigned char wire[MESSAGE_SIZE])
+{
+    if (fields[0] < COMPACT_VERSION)
+    {
+        memset(wire, 0, MESSAGE_SIZE);
+        memcpy(wire, fields, fieldCount);
+        return MESSAGE_SIZE;
+    }
+    wire[0] = fields[0];
+    wire[1] = COMPACT_HEADER_SIZE + fieldCount - 1;
+    memcpy(&wire[COMPACT_HEADER_SIZE], &fields[1], fieldCount - 1);
+    return wire[1];
+}
+
+/**
+ * Game number as sent in byte 6. The low bits name the worker shard that owns
+ * the game, so the receiving worker can check it without looking elsewhere.
+ * The byte wraps once games outnumber it, so live games may share a byte; it
+ * is only compared against the game found by its connection, never looked up.
+ * @param  gameNumber: The game number within this shard; -1 if none.
+ * @retval The protocol game number byte.
+ */
+unsigned char protocolGameNumber(int gameNumber)
+{
+    if (gameNumber < 0)
+    {
+        return 0xFF;
+    }
+    return (unsigned char)((gameNumber << globShardBits) | globShardId);
+}
+
+/**
+ * Sends a message to a client, framed in the version the client speaks.
+ * @param  move: The move to make.
+ * @param  complete: The game complete code to send.
+ * @param  completeDescriptor: The game complete descritor code to send.
+ * @param  gameNumber: The game number to send.
+ * @param  clientAddress: The address of the client to send to.
+ * @retval None.
+ */
+void sendMessage(int command, int move, int complete, int completeDescriptor, int gameNumber, unsigned char clientSequenceNum, int connectedSocket, unsigned char messageStore[MESSAGE_FIELDS])
+{
+    //Replies for a game name it, so its socket only needs looking up when they do not
+    struct tttGame *clientGame = gameNumber >= 0 ? getGame(gameNumber) : NULL;
+    if (clientGame == NULL || !(*clientGame).active || (*clientGame).connectedSocket != connectedSocket)
+    {
+        clientGame = getGame(findGameBySocket(connectedSocket));
+    }
+
+    //Reply in compact frames to clients that use them
+    unsigned char versionByte = LEGACY_VERSION;
+    if (clientGame != NULL && (*clientGame).clientVersion >= COMPACT_VERSION)
+    {
+        versionByte = COMPACT_VERSION;
+    }
+    //Moves on m,n,k boards can pass 255, so their replies carry the high byte too
+    int fieldCount = REPLY_FIELDS;
+    if (clientGame != NULL && (*clientGame).mnk != NULL)
+    {
+        fieldCount = WIDE_REPLY_FIELDS;
+    }
+
+    //Only the fields a reply carries are stored; a retransmission resends the same ones
+    messageStore[0] = versionByte;
+    messageStore[1] = move;
+    messageStore[2] = complete;
+    messageStore[3] = completeDescriptor;
+    messageStore[4] = MOVE_COMMAND;
+    messageStore[5] = protocolGameNumber(gameNumber);
+    messageStore[6] = clientSequenceNum;
+    messageStore[MOVE_HIGH_FIELD] = fieldCount == WIDE_REPLY_FIELDS ? move >> 8 : 0;
+
+    //The first reply of a new or resumed session hands the client its token:
+    //the record index, then the nonce, both big endian
+    if (clientGame != NULL && (*clientGame).tokenPending && (*clientGame).sessionIndex != NO_SESSION)
+    {
+        int i;
+        for (i = 0; i < 4; i++)
+        {
+            messageStore[RESUME_TOKEN_FIELD + i] = (unsigned int)(*clientGame).sessionIndex >> (24 - 8 * i);
+            messageStore[RESUME_TOKEN_FIELD + 4 + i] = (*clientGame).sessionNonce >> (24 - 8 * i);
+        }
+        fieldCount = TOKEN_REPLY_FIELDS;
+        (*clientGame).tokenPending = 0;
+    }
+
+    debugPacket(messageStore, SENT, ORIGINAL);
+
+    //Queue message behind any earlier replies to this game, copied from its template if it is a classic reply
+    if (clientGame != NULL)
+    {
+        if (fieldCount == REPLY_FIELDS && move >= 0 && move <= SQUARES && complete >= 0 && complete <= GAME_ERROR &&
+            completeDescriptor >= 0 && completeDescriptor < REPLY_DESCRIPTORS)
+        {
+            queueTemplate(clientGame, versionByte < COMPACT_VERSION, move, complete, completeDescriptor, messageStore[5], clientSequenceNum);
+            return;
+        }
+        queueReply(clientGame, messageStore, fieldCount);
+        return;
+    }
+
+    //Socket has no game yet (rejected client), so send what fits right away
+    unsigned char wire[MESSAGE_SIZE];
+    int wireLength = encodeFrame(messageStore, fieldCount, wire);
+    if (send(connectedSocket, wire, wireLength, TCP_FLAGS | MSG_DONTWAIT | MSG_NOSIGNAL) <= 0)
+    {
+        printf("--- ERROR - Couldn't write to rejected client socket. Error: ");
+        perror("");
+    }
+}
+
+/**
+ * Send a game's last reply again, as stored by sendMessage, without touching the game.
+ * @param  *clientGame: The game.
+ * @retval None.
+ */
+void resendLastMessage(struct tttGame *clientGame)
+{
+    debugPacket((*clientGame).lastMessage, SENT, REPEAT);
+    queueReply(clientGame, (*clientGame).lastMessage, (*clientGame).mnk != NULL ? WIDE_REPLY_FIELDS : REPLY_FIELDS);
+}
+
+/**
+ * Encode every classic reply into globReplyTemplates, with game and sequence
+ * bytes of 0, exactly as queueReply would queue it. The table is only read after this.
+ * @retval None.
+ */
+void initReplyTemplates()
+{
+    unsigned char fields[MESSAGE_FIELDS];
+    memset(fields, 0, sizeof(fields));
+    int compact, complete, descriptor, move;
+    for (compact = 0; compact < 2; compact++)
+    {
+        for (complete = 0; complete <= GAME_ERROR; complete++)
+        {
+            for (descriptor = 0; descriptor < REPLY_DESCRIPTORS; descriptor++)
+            {
+                for (move = 0; move <= SQUARES; move++)
+                {
+                    unsigned char *reply = globReplyTemplates[compact][complete][descriptor][move];
+                    fields[0] = compact ? COMPACT_VERSION : LEGACY_VERSION;
+                    fields[1] = move;
+                    fields[2] = complete;
+                    fields[3] = descriptor;
+                    fields[4] = MOVE_COMMAND;
+                    if (compact)
+                    {
+                        reply[0] = COMPACT_VERSION;
+                        reply[1] = COMPACT_REPLY_SIZE;
+                        memcpy(&reply[COMPACT_HEADER_SIZE], &fields[1], REPLY_FIELDS - 1);
+                    }
+                    else
+                    {
+                        memcpy(reply, fields, LEGACY_RECORD_SIZE);
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Queue a classic reply by copying its template into a game's output and
+ * patching in the game and sequence bytes. Queues the same bytes as
+ * queueReply, without building the frame.
+ * @param  *clientGame: The game to send to.
+ * @param  legacy: 1 if the reply is for a legacy client.
+ * @param  move: The move, 0 to SQUARES.
+ * @param  complete: The game complete code, at most GAME_ERROR.
+ * @param  completeDescriptor: The descriptor, below REPLY_DESCRIPTORS.
+ * @param  gameByte: The protocol game number.
+ * @param  clientSequenceNum: The sequence number.
+ * @retval None.
+ */
+void queueTemplate(struct tttGame *clientGame, int legacy, int move, int complete, int completeDescriptor, unsigned char gameByte, unsigned char clientSequenceNum)
+{
+    //Output already queued keeps its format, as in queueReply
+    if ((*clientGame).outLength == 0)
+    {
+        (*clientGame).outLegacy = legacy;
+    }
+
+    if ((*clientGame).outLegacy)
+    {
+        unsigned char *record = reserveOutput(clientGame, LEGACY_RECORD_SIZE);
+        if (record != NULL)
+        {
+            memcpy(record, globReplyTemplates[0][complete][completeDescriptor][move], LEGACY_RECORD_SIZE);
+            record[5] = gameByte;
+            record[6] = clientSequenceNum;
+        }
+        return;
+    }
+    unsigned char *frame = reserveOutput(clientGame, COMPACT_REPLY_SIZE);
+    if (frame != NULL)
+    {
+        memcpy(frame, globReplyTemplates[1][complete][completeDescriptor][move], COMPACT_REPLY_SIZE);
+        frame[COMPACT_HEADER_SIZE + 4] = gameByte;
+        frame[COMPACT_HEADER_SIZE + 5] = clientSequenceNum;
+    }
+}
+
+/**
+ * Queue a reply straight into a game's output, framed for the game's client.
+ * A compact frame is written as sent. A legacy frame stores only its first
+ * LEGACY_RECORD_SIZE bytes; flushOutput patches them into a frame whose
+ * padding is already zero, so the padding is never built or copied here.
+ * @param  *clientGame: The game to send to.
+ * @param  fields[MESSAGE_FIELDS]: The reply; fields[0] is the version and
+ * the first LEGACY_RECORD_SIZE fields must be set.
+ * @param  fieldCount: Number of meaningful fields, including the version.
+ * @retval None.
+ */
+void queueReply(struct tttGame *clientGame, unsigned char fields[MESSAGE_FIELDS], int fieldCount)
+{
+    //Output already queued keeps its format; the new version applies once it drains
+    if ((*clientGame).outLength == 0)
+    {
+        (*clientGame).outLegacy = fields[0] < COMPACT_VERSION;
+    }
+
+    if ((*clientGame).outLegacy)
+    {
+        unsigned char *record = reserveOutput(clientGame, LEGACY_RECORD_SIZE);
+        if (record != NULL)
+        {
+            memcpy(record, fields, fieldCount);
+            memset(record + fieldCount, 0, LEGACY_RECORD_SIZE - fieldCount);
+            record[0] = fields[0] < COMPACT_VERSION ? fields[0] : LEGACY_VERSION;
+        }
+        return;
+    }
+    unsigned char *frame = reserveOutput(clientGame, COMPACT_HEADER_SIZE + fieldCount - 1);
+    if (frame != NULL)
+    {
+        frame[0] = COMPACT_VERSION;
+        frame[1] = COMPACT_HEADER_SIZE + fieldCount - 1;
+        memcpy(&frame[COMPACT_HEADER_SIZE], &fields[1], fieldCount - 1);
+    }
+}
+
+/**
+ * Make room at the end of a game's output. The output is written at the end
+ * of the loop iteration so replies to pipelined requests go out in a single send.
+ * @param  *clientGame: The game to send to.
+ * @param  length: Number of bytes to add.
+ * @retval Where to write them; NULL if the game was closed for lack of memory.
+ */
+unsigned char *reserveOutput(struct tttGame *clientGame, int length)
+{
+    //Compact before growing so the buffer only grows for real backlog
+    if ((*clientGame).outStart > 0)
+    {
+        memmove((*clientGame).outBuffer, (*clientGame).outBuffer + (*clientGame).outStart, (*clientGame).outLength);
+        (*clientGame).outStart = 0;
+    }
+    if ((*clientGame).outLength + length > (*clientGame).outCapacity)
+    {
+        int newCapacity = (*clientGame).outCapacity > 0 ? (*clientGame).outCapacity * 2 : MESSAGE_SIZE;
+        while (newCapacity < (*clientGame).outLength + length)
+        {
+            newCapacity *= 2;
+        }
+        unsigned char *newBuffer = realloc((*clientGame).outBuffer, newCapacity);
+        if (newBuffer == NULL)
+        {
+            printf("--- ERROR - Client %d - Out of memory for output, Closing game\n", (*clientGame).gameNumber);
+            abortGame(clientGame);
+            return NULL;
+        }
+        (*clientGame).outBuffer = newBuffer;
+        (*clientGame).outCapacity = newCapacity;
+    }
+    unsigned char *space = (*clientGame).outBuffer + (*clientGame).outLength;
+    (*clientGame).outLength += length;
+
+    queueFlush(clientGame);
+    return space;
+}
+
+/**
+ * Lay out a game's queued output for one send. Compact frames are sent from
+ * outBuffer as they are. Legacy records are patched over the first bytes of
+ * globLegacyFrames, whose padding stays zero, skipping what the socket
+ * already took of the first frame.
+ * @param  *clientGame: The game, with output queued.
+ * @param  *length: Set to the number of bytes to send.
+ * @retval The bytes to send.
+ */
+unsigned char *stageOutput(struct tttGame *clientGame, int *length)
+{
+    unsigned char *start = (*clientGame).outBuffer + (*clientGame).outStart;
+    if (!(*clientGame).outLegacy)
+    {
+        *length = (*clientGame).outLength;
+        return start;
+    }
+
+    int frames = (*clientGame).outLength / LEGACY_RECORD_SIZE;
+    if (frames > LEGACY_FLUSH_FRAMES)
+    {
+        frames = LEGACY_FLUSH_FRAMES;
+    }
+    int frame;
+    for (frame = 0; frame < frames; frame++)
+    {
+        memcpy(globLegacyFrames + frame * MESSAGE_SIZE, start + frame * LEGACY_RECORD_SIZE, LEGACY_RECORD_SIZE);
+    }
+    *length = frames * MESSAGE_SIZE - (*clientGame).outFrameSent;
+    return globLegacyFrames + (*clientGame).outFrameSent;
+}
+
+/**
+ * Drop output the socket has taken.
+ * @param  *clientGame: The game.
+ * @param  bytesSent: Bytes sent, counting legacy padding.
+ * @retval None.
+ */
+void consumeOutput(struct tttGame *clientGame, int bytesSent)
+{
+    if (!(*clientGame).outLegacy)
+    {
+        (*clientGame).outStart += bytesSent;
+        (*clientGame).outLength -= bytesSent;
+        return;
+    }
+    int sent = (*clientGame).outFrameSent + bytesSent;
+    (*clientGame).outStart += sent / MESSAGE_SIZE * LEGACY_RECORD_SIZE;
+    (*clientGame).outLength -= sent / MESSAGE_SIZE * LEGACY_RECORD_SIZE;
+    (*clientGame).outFrameSent = sent % MESSAGE_SIZE;
+}
+
+/**
+ * Put a game on the pending flush list, once.
+ * @param  *clientGame: The game with output to write.
+ * @retval None; exit(-1) if error.
+ */
+void queueFlush(struct tttGame *clientGame)
+{
+    if ((*clientGame).flushQueued)
+    {
+        return;
+    }
+    if (globPendingFlushCount == globPendingFlushSize)
+    {
+        int newSize = globPendingFlushSize > 0 ? globPendingFlushSize * 2 : INITIAL_PENDING_FLUSH_SIZE;
+        int *newList = realloc(globPendingFlush, newSize * sizeof(int));
+        if (newList == NULL)
+        {
+            perror("Error: Problem growing pending flush list");
+            closeSockets();
+            exit(-1);
+        }
+        globPendingFlush = newList;
+        globPendingFlushSize = newSize;
+    }
+    globPendingFlush[globPendingFlushCount++] = (*clientGame).gameNumber;
+    (*clientGame).flushQueued = 1;
+}
+
+/**
+ * Flush every game queued by queueFlush(). Games closed since they were
+ * queued have flushQueued cleared and are skipped.
+ * @retval None.
+ */
+void flushPendingOutput()
+{
+    int i;
+    for (i = 0; i < globPendingFlushCount; i++)
+    {
+        struct tttGame *clientGame = getGame(globPendingFlush[i]);
+        if (clientGame == NULL || !(*clientGame).flushQueued)
+        {
+            continue;
+        }
+        (*clientGame).flushQueued = 0;
+        flushOutput(clientGame);
+    }
+    globPendingFlushCount = 0;
+}
+
+/**
+ * Write queued output until the socket would block. Write readiness is only
+ * watched while output remains, and a closing game is closed once drained.
+ * A game whose socket fails is closed at the end of the batch instead.
+ * @param  *clientGame: The game to flush.
+ * @retval 0 if the game is still open; -1 if it was closed or is closing.
+ */
+int flushOutput(struct tttGame *clientGame)
+{
+    while ((*clientGame).outLength > 0)
+    {
+        int length;
+        unsigned char *bytes = stageOutput(clientGame, &length);
+        int bytesSent = (*globBackend).send((*clientGame).connectedSocket, clientGame, bytes, length);
+        if (bytesSent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            break;
+        }
+        if (bytesSent < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (bytesSent <= 0)
+        {
+            printf("--- ERROR - Client %d - Couldn't write to socket, Closing game. Error: ", (*clientGame).gameNumber);
+            perror("");
+            abortGame(clientGame);
+            return -1;
+        }
+        consumeOutput(clientGame, bytesSent);
+    }
+    if ((*clientGame).outLength == 0)
+    {
+        (*clientGame).outStart = 0;
+    }
+
+    int wantWrite = (*clientGame).outLength > 0;
+    if (wantWrite != (*clientGame).watchingWrites)
+    {
+        (*globBackend).watchWrites((*clientGame).connectedSocket, clientGame, wantWrite);
+        (*clientGame).watchingWrites = wantWrite;
+    }
+
+    if (!wantWrite && (*clientGame).closing)
+    {
+        closeGameNow((*clientGame).gameNumber);
+        return -1;
+    }
+    return 0;
+}
+
+void sendPacket(unsigned char packet[MESSAGE_SIZE], int connectedSocket)
+{
+    //Send message
+    if (send(connectedSocket, packet, MESSAGE_SIZE, TCP_FLAGS) <= 0)
+    {
+        perror("Error sending packet");
+    }
+}
+
+/**
+ * Fill globWinTable: entry m is 1 if the squares in mask m cover a whole line.
+ * @retval None.
+ */
+void initWinTable()
+{
+    int mask, line;
+    for (mask = 0; mask <= FULL_BOARD; mask++)
+    {
+        globWinTable[mask] = 0;
+        for (line = 0; line < WIN_LINES; line++)
+        {
+            if ((mask & globWinLines[line]) == globWinLines[line])
+            {
+                globWinTable[mask] = 1;
+            }
+        }
+    }
+}
+
+/**
+ * Initialize the state of a tictactoe game board.
+ * @param  board: The board to clear.
+ * @retval None.
+ */
+void initSharedState(struct tttBoard *board)
+{
+    (*board).client = 0;
+    (*board).server = 0;
+}
+
+/**
+ * Validate and place a move on the board.
+ * @param  board: The board to place move on.
+ * @param  move: The move to place on board.
+ * @param  player: The player placing the move (client or server).
+ * @retval 1 if move placed successfully; 0 otherwise.
+ */
+int placeMove(struct tttBoard *board, int move, int player)
+{
+    if (move < 1 || move > SQUARES)
+    {
+        return 0;
+    }
+
+    unsigned short square = 1 << (move - 1);
+    if (((*board).client | (*board).server) & square)
+    {
+        return 0;
+    }
+
+    if (player == SERVER_PLAYER)
+    {
+        (*board).server |= square;
+    }
+    else
+    {
+        (*board).client |= square;
+    }
+    return 1;
+}
+
+/**
+ * Check if a player has won the game.  Assumes this is called between each move made.
+ * @param  board: The game board to check.
+ * @param  player: The last player to place a move.
+ * @retval {win code} if player has won; {draw code} if tie; -1 otherwise.
+ */
+int checkWin(struct tttBoard *board, int player)
+{
+    int winner = -2;
+    if (player == SERVER_PLAYER)
+    {
+        winner = SERVER_WIN;
+    }
+    else if (player == CLIENT_PLAYER)
+    {
+        winner = CLIENT_WIN;
+    }
+
+    //Any completed line ends the game in favour of the last player to move
+    if (globWinTable[(*board).client] || globWinTable[(*board).server])
+        return winner;
+    else if (((*board).client | (*board).server) == FULL_BOARD)
+        return DRAW; // Return of DRAW means game over
+    else
+        return -1; // return of -1 means keep playing
+}
+
+/**
+ * Choose the batch evaluation kernel: AVX2 or SSE2 when the CPU has them,
+ * otherwise the scalar loop.
+ * @retval None.
+ */
+void initEvaluateBoards()
+{
+    globEvaluateBoards = evaluateBoardsScalar;
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        globEvaluateBoards = evaluateBoardsAvx2;
+        globEvaluateKernel = "avx2";
+    }
+    else if (__builtin_cpu_supports("sse2"))
+    {
+        globEvaluateBoards = evaluateBoardsSse2;
+        globEvaluateKernel = "sse2";
+    }
+#endif
+}
+
+/**
+ * Evaluate many boards at once: who holds a line, whether the board is full,
+ * and which squares are free.
+ * @param  boards: The boards.
+ * @param  results: Filled with one status per board.
+ * @param  count: Number of boards.
+ * @retval None.
+ */
+void evaluateBoards(const struct tttBoard *boards, struct boardStatus *results, int count)
+{
+    (*globEvaluateBoards)(boards, results, count);
+}
+
+/**
+ * Batch evaluation one board at a time through globWinTable.
+ * @param  boards/results/count: As for evaluateBoards.
+ * @retval None.
+ */
+void evaluateBoardsScalar(const struct tttBoard *boards, struct boardStatus *results, int count)
+{
+    int i;
+    for (i = 0; i < count; i++)
+    {
+        unsigned short taken = boards[i].client | boards[i].server;
+        results[i].status = (globWinTable[boards[i].client] ? EVAL_CLIENT_LINE : 0) |
+                            (globWinTable[boards[i].server] ? EVAL_SERVER_LINE : 0) |
+                            (taken == FULL_BOARD ? EVAL_FULL : 0);
+        results[i].legal = FULL_BOARD & ~taken;
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+/**
+ * Batch evaluation four boards per 128 bit vector. Each 32 bit lane holds a
+ * board, client mask low and server mask high; every mask is compared with
+ * each line at once, and the lane is rewritten as its boardStatus. The
+ * kernels are optimized whatever the makefile's flags, since unoptimized
+ * intrinsics spill every vector to the stack and lose to the scalar loop.
+ * @param  boards/results/count: As for evaluateBoards.
+ * @retval None.
+ */
+__attribute__((target("sse2"), optimize("O2"))) void evaluateBoardsSse2(const struct tttBoard *boards, struct boardStatus *results, int count)
+{
+    const __m128i full = _mm_set1_epi32(FULL_BOARD);
+    const __m128i lineBits = _mm_set1_epi32(EVAL_CLIENT_LINE | EVAL_SERVER_LINE << 16);
+    const __m128i lowHalf = _mm_set1_epi32(0xFFFF);
+    const __m128i fullBit = _mm_set1_epi32(EVAL_FULL);
+    int i;
+    for (i = 0; i + 4 <= count; i += 4)
+    {
+        __m128i masks = _mm_loadu_si128((const __m128i *)&boards[i]);
+        __m128i lines = _mm_setzero_si128();
+        int line;
+        for (line = 0; line < WIN_LINES; line++)
+        {
+            __m128i winLine = _mm_set1_epi16(globWinLines[line]);
+            lines = _mm_or_si128(lines, _mm_cmpeq_epi16(_mm_and_si128(masks, winLine), winLine));
+        }
+
+        //Fold the server's line bit down beside the client's
+        __m128i status = _mm_and_si128(lines, lineBits);
+        status = _mm_and_si128(_mm_or_si128(status, _mm_srli_epi32(status, 16)), lowHalf);
+        __m128i taken = _mm_and_si128(_mm_or_si128(masks, _mm_srli_epi32(masks, 16)), full);
+        status = _mm_or_si128(status, _mm_and_si128(_mm_cmpeq_epi32(taken, full), fullBit));
+        __m128i legal = _mm_xor_si128(taken, full);
+        _mm_storeu_si128((__m128i *)&results[i], _mm_or_si128(status, _mm_slli_epi32(legal, 16)));
+    }
+    evaluateBoardsScalar(boards + i, results + i, count - i);
+}
+
+/**
+ * Batch evaluation eight boards per 256 bit vector, as evaluateBoardsSse2.
+ * @param  boards/results/count: As for evaluateBoards.
+ * @retval None.
+ */
+__attribute__((target("avx2"), optimize("O2"))) void evaluateBoardsAvx2(const struct tttBoard *boards, struct boardStatus *results, int count)
+{
+    const __m256i full = _mm256_set1_epi32(FULL_BOARD);
+    const __m256i lineBits = _mm256_set1_epi32(EVAL_CLIENT_LINE | EVAL_SERVER_LINE << 16);
+    const __m256i lowHalf = _mm256_set1_epi32(0xFFFF);
+    const __m256i fullBit = _mm256_set1_epi32(EVAL_FULL);
+    int i;
+    for (i = 0; i + 8 <= count; i += 8)
+    {
+        __m256i masks = _mm256_loadu_si256((const __m256i *)&boards[i]);
+        __m256i lines = _mm256_setzero_si256();
+        int line;
+        for (line = 0; line < WIN_LINES; line++)
+        {
+            __m256i winLine = _mm256_set1_epi16(globWinLines[line]);
+            lines = _mm256_or_si256(lines, _mm256_cmpeq_epi16(_mm256_and_si256(masks, winLine), winLine));
+        }
+
+        //Fold the server's line bit down beside the client's
+        __m256i status = _mm256_and_si256(lines, lineBits);
+        status = _mm256_and_si256(_mm256_or_si256(status, _mm256_srli_epi32(status, 16)), lowHalf);
+        __m256i taken = _mm256_and_si256(_mm256_or_si256(masks, _mm256_srli_epi32(masks, 16)), full);
+        status = _mm256_or_si256(status, _mm256_and_si256(_mm256_cmpeq_epi32(taken, full), fullBit));
+        __m256i legal = _mm256_xor_si256(taken, full);
+        _mm256_storeu_si256((__m256i *)&results[i], _mm256_or_si256(status, _mm256_slli_epi32(legal, 16)));
+    }
+    evaluateBoardsScalar(boards + i, results + i, count - i);
+}
+#endif
+
+/**
+ * Turn a batch evaluation result into checkWin's answer.
+ * @param  status: The board's result.
+ * @param  player: The last player to place a move.
+ * @retval {win code} if player has won; {draw code} if tie; -1 otherwise.
+ */
+int boardResult(struct boardStatus *status, int player)
+{
+    if ((*status).status & (EVAL_CLIENT_LINE | EVAL_SERVER_LINE))
+        return player == SERVER_PLAYER ? SERVER_WIN : CLIENT_WIN;
+    else if ((*status).status & EVAL_FULL)
+        return DRAW;
+    else
+        return -1;
+}
+
+/**
+ * Places the server's move for a difficulty. Every level is a table lookup or
+ * a random free square, so all levels cost the same per move.
+ * Boards that cannot arise in play (only sent by a reconnect) get the first free square.
+ * @param  board: The board to place a move on.
+ * @param  difficulty: DIFFICULTY_PERFECT, DIFFICULTY_GREEDY or DIFFICULTY_RANDOM.
+ * @param  blunderRate: Percent of moves played at random instead.
+ * @retval The move placed by server.
+ */
+int placeServerMove(struct tttBoard *board, int difficulty, int blunderRate)
+{
+    int choice;
+    if (difficulty == DIFFICULTY_RANDOM || (blunderRate > 0 && (int)(((nextRandom() >> 16) * 100) >> 16) < blunderRate))
+    {
+        choice = randomSquare(~((*board).client | (*board).server) & FULL_BOARD);
+    }
+    else
+    {
+        choice = lookupMove(board, difficulty == DIFFICULTY_GREEDY);
+    }
+    if (choice == 0)
+    {
+        choice = firstFreeSquare(board);
+    }
+    placeMove(board, choice, SERVER_PLAYER);
+    return choice;
+}
+
+/**
+ * Find the lowest numbered free square.
+ * @param  board: The board to search; must not be full.
+ * @retval The square (1-9).
+ */
+int firstFreeSquare(struct tttBoard *board)
+{
+    return __builtin_ctz(~((*board).client | (*board).server) & FULL_BOARD) + 1;
+}
+
+/**
+ * Choose the greedy move: complete a line, else block the opponent's line,
+ * else take the first free square in globGreedyOrder.
+ * @param  mover: Squares of the player to move.
+ * @param  opponent: Squares of the other player; the board must not be full.
+ * @retval The square (1-9).
+ */
+int greedyMove(unsigned short mover, unsigned short opponent)
+{
+    unsigned short empty = ~(mover | opponent) & FULL_BOARD;
+    int i, square;
+    for (i = 0; i < SQUARES; i++)
+    {
+        square = globGreedyOrder[i];
+        if ((empty & (1 << square)) && globWinTable[mover | (1 << square)])
+        {
+            return square + 1;
+        }
+    }
+    for (i = 0; i < SQUARES; i++)
+    {
+        square = globGreedyOrder[i];
+        if ((empty & (1 << square)) && globWinTable[opponent | (1 << square)])
+        {
+            return square + 1;
+        }
+    }
+    for (i = 0; i < SQUARES; i++)
+    {
+        square = globGreedyOrder[i];
+        if (empty & (1 << square))
+        {
+            break;
+        }
+    }
+    return square + 1;
+}
+
+/**
+ * Pick a free square uniformly at random.
+ * @param  empty: Mask of the free squares; must not be 0.
+ * @retval The square (1-9).
+ */
+int randomSquare(unsigned short empty)
+{
+    //Scale the top 16 random bits to the free square count instead of dividing
+    return globFreeSquares[empty][((nextRandom() >> 16) * __builtin_popcount(empty)) >> 16];
+}
+
+/**
+ * Advance this worker's xorshift generator.
+ * @retval The next pseudo random number.
+ */
+unsigned int nextRandom()
+{
+    globRandomState ^= globRandomState << 13;
+    globRandomState ^= globRandomState >> 17;
+    globRandomState ^= globRandomState << 5;
+    return globRandomState;
+}
+
+/**
+ * Fill the mask tables moves are looked up and drawn from, and solve every
+ * position reachable from the empty board, client first, into globPositions,
+ * unless a solution file is mapped (benchmarks always solve).
+ * @retval None.
+ */
+void initPositionTable()
+{
+    int mask, square;
+    for (mask = 0; mask <= FULL_BOARD; mask++)
+    {
+        int count = 0, place = 1;
+        globTernary[mask] = 0;
+        for (square = 0; square < SQUARES; square++)
+        {
+            if (mask & (1 << square))
+            {
+                globFreeSquares[mask][count++] = square + 1;
+                globTernary[mask] += place;
+            }
+            place *= 3;
+        }
+    }
+
+    initTransforms();
+    memset(globPositions, 0, sizeof(globPositions));
+    if (globSolution == NULL || globBenchmark != NULL)
+    {
+        solvePosition(0, 0);
+        indexMoves();
+    }
+}
+
+/**
+ * Fill globMoveIndex from the solved canonical positions. The canonical table
+ * stays the stored solution; the index only saves each move its symmetry
+ * mapping.
+ * @retval None.
+ */
+void indexMoves()
+{
+    unsigned short client, server;
+    for (client = 0; client <= FULL_BOARD; client++)
+    {
+        for (server = 0; server <= FULL_BOARD; server++)
+        {
+            if ((client & server) != 0)
+            {
+                continue;
+            }
+            struct tttBoard board = {client, server};
+            globMoveIndex[globTernary[client] + 2 * globTernary[server]] = canonicalMove(&board, 0) | (canonicalMove(&board, 1) << 4);
+        }
+    }
+}
+
+/**
+ * FNV-1a hash of a solution file's slots.
+ * @param  entries: The slots.
+ * @param  count: Number of slots.
+ * @retval The checksum.
+ */
+unsigned int solutionChecksum(const struct solutionEntry *entries, unsigned long long count)
+{
+    const unsigned char *bytes = (const unsigned char *)entries;
+    unsigned int hash = 2166136261u;
+    size_t i;
+    for (i = 0; i < (size_t)count * sizeof(struct solutionEntry); i++)
+    {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * Solve a variant and write it to a solution file. The classic board's
+ * moves come from globPositions, mapped back from each board's canonical
+ * form; other variants are solved here by solveMnkPosition.
+ * @param  *path: The file to write.
+ * @param  rows/columns/k: A valid variant.
+ * @retval None; exit(-1) if error.
+ */
+void writeSolutionFile(char *path, int rows, int columns, int k)
+{
+    globBuildMask = SOLUTION_INITIAL_SLOTS - 1;
+    globBuildCount = 0;
+    globBuildEntries = calloc(SOLUTION_INITIAL_SLOTS, sizeof(struct solutionEntry));
+    if (globBuildEntries == NULL)
+    {
+        perror("Error allocating solution entries");
+        exit(-1);
+    }
+
+    if (rows == ROWS && columns == COLUMNS && k == ROWS)
+    {
+        unsigned short client, server;
+        for (client = 0; client <= FULL_BOARD; client++)
+        {
+            for (server = 0; server <= FULL_BOARD; server++)
+            {
+                int transform;
+                struct positionEntry *position = findPosition(canonicalPosition(client, server, &transform));
+                if ((client & server) != 0 || !(*position).used)
+                {
+                    continue;
+                }
+                struct tttBoard board = {client, server};
+                storeSolution(globSolutionKeys[0][client] ^ globSolutionKeys[1][server], (*position).score,
+                              SQUARES - __builtin_popcount(client | server), lookupMove(&board, 0), lookupMove(&board, 1));
+            }
+        }
+    }
+    else
+    {
+        struct mnkBoard *board = createMnkBoard(rows, columns, k);
+        if (board == NULL)
+        {
+            perror("Error allocating board");
+            exit(-1);
+        }
+        solveMnkPosition(board, -1);
+        free(board);
+    }
+
+    struct solutionHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SOLUTION_MAGIC, sizeof(header.magic));
+    header.version = SOLUTION_VERSION;
+    header.headerSize = sizeof(struct solutionHeader);
+    header.entrySize = sizeof(struct solutionEntry);
+    header.rows = rows;
+    header.columns = columns;
+    header.k = k;
+    header.slotCount = globBuildMask + 1;
+    header.entryCount = globBuildCount;
+    header.checksum = solutionChecksum(globBuildEntries, header.slotCount);
+
+    FILE *file = fopen(path, "wb");
+    if (file == NULL || fwrite(&header, sizeof(header), 1, file) != 1 ||
+        fwrite(globBuildEntries, sizeof(struct solutionEntry), header.slotCount, file) != header.slotCount || fclose(file) != 0)
+    {
+        perror("Error writing solution file");
+        exit(-1);
+    }
+    printf("Wrote %s: %dx%d k=%d, %llu positions in %llu slots\n", path, rows, columns, k, header.entryCount, header.slotCount);
+    free(globBuildEntries);
+    globBuildEntries = NULL;
+}
+
+/**
+ * Minimax over every position reachable from an m,n,k board, storing each
+ * in the table -G is building, as solvePosition does for the classic board.
+ * @param  board: The board; the player to move is the server if the client has more stones.
+ * @param  lastSquare: Square (0 based) of the latest stone; -1 on an empty board.
+ * @retval Score for the server: 1 + empty squares for a win, the negative for a loss, 0 for a draw.
+ */
+int solveMnkPosition(struct mnkBoard *board, int lastSquare)
+{
+    int squares = (*board).rows * (*board).columns;
+    int empty = squares - (*board).stones;
+    const struct solutionEntry *solved = &globBuildEntries[solutionSlot(globBuildEntries, globBuildMask, (*board).hash)];
+    if ((*solved).key != 0)
+    {
+        return solutionScore(solved, empty);
+    }
+
+    int score;
+    int bestMove = 0, greedy = 0;
+    if (lastSquare >= 0 && mnkWinsAt(board, lastSquare))
+    {
+        score = (*board).cells[lastSquare] == SERVER_PLAYER ? 1 + empty : -(1 + empty);
+    }
+    else if (empty == 0)
+    {
+        score = 0;
+    }
+    else
+    {
+        int serverToMove = (*board).stones % 2 == 1;
+        int player = serverToMove ? SERVER_PLAYER : CLIENT_PLAYER;
+        greedy = mnkGreedyMove(board, player);
+        score = serverToMove ? -squares - 1 : squares + 1;
+        int square;
+        for (square = 0; square < squares; square++)
+        {
+            if ((*board).cells[square] != 0)
+            {
+                continue;
+            }
+            mnkPush(board, square, player);
+            int childScore = solveMnkPosition(board, square);
+            mnkPop(board, square);
+            if (serverToMove ? childScore > score : childScore < score)
+            {
+                score = childScore;
+                bestMove = square + 1;
+            }
+        }
+    }
+
+    //Children may have grown the table, so the position's slot is found again
+    storeSolution((*board).hash, score, empty, bestMove, greedy);
+    return score;
+}
+
+/**
+ * Add a solved position to the table -G is building, growing it first if
+ * that would fill more than three quarters of its slots.
+ * @param  key: The position's hash.
+ * @param  score: Its score, as solvePosition returns it.
+ * @param  empty: Empty squares on its board.
+ * @param  bestMove/greedyMove: Its moves (1 based); 0 if the game is over.
+ * @retval None; exit(-1) if error.
+ */
+void storeSolution(unsigned long long key, int score, int empty, int bestMove, int greedyMove)
+{
+    if (key == 0)
+    {
+        fprintf(stderr, "Error: A position hashes to 0, which marks an empty slot\n");
+        exit(-1);
+    }
+    if ((globBuildCount + 1) * 4 > (globBuildMask + 1) * 3)
+    {
+        growSolution();
+    }
+    struct solutionEntry *entry = &globBuildEntries[solutionSlot(globBuildEntries, globBuildMask, key)];
+    (*entry).key = key;
+    (*entry).bestMove = bestMove;
+    (*entry).greedyMove = greedyMove;
+
+    //A score of 1 + n means the game ends with n squares still empty
+    (*entry).outcome = score > 0 ? SERVER_WIN : score < 0 ? CLIENT_WIN : DRAW;
+    (*entry).depth = score == 0 ? empty : empty - (abs(score) - 1);
+    globBuildCount++;
+}
+
+/**
+ * Turn a stored outcome back into the score solvePosition would give it.
+ * @param  entry: The position.
+ * @param  empty: Empty squares on its board.
+ * @retval The score.
+ */
+int solutionScore(const struct solutionEntry *entry, int empty)
+{
+    if ((*entry).outcome == DRAW)
+    {
+        return 0;
+    }
+    int score = 1 + empty - (*entry).depth;
+    return (*entry).outcome == SERVER_WIN ? score : -score;
+}
+
+/**
+ * Double the slots of the table -G is building and put every position back.
+ * @retval None; exit(-1) if the variant has too many positions for a solution file.
+ */
+void growSolution()
+{
+    unsigned long long slots = (globBuildMask + 1) * 2;
+    struct solutionEntry *entries = slots <= SOLUTION_MAX_SLOTS ? calloc(slots, sizeof(struct solutionEntry)) : NULL;
+    if (entries == NULL)
+    {
+        fprintf(stderr, "Error: Too many positions for a solution file (%llu solved so far)\n", globBuildCount);
+        exit(-1);
+    }
+    unsigned long long slot;
+    for (slot = 0; slot <= globBuildMask; slot++)
+    {
+        if (globBuildEntries[slot].key != 0)
+        {
+            entries[solutionSlot(entries, slots - 1, globBuildEntries[slot].key)] = globBuildEntries[slot];
+        }
+    }
+    free(globBuildEntries);
+    globBuildEntries = entries;
+    globBuildMask = slots - 1;
+}
+
+/**
+ * Find a key's slot in a solution table.
+ * @param  entries: The slots; at least one must be empty.
+ * @param  slotMask: Slot count - 1.
+ * @param  key: The position's hash.
+ * @retval The slot holding the key, or the empty slot where it belongs.
+ */
+unsigned long long solutionSlot(const struct solutionEntry *entries, unsigned long long slotMask, unsigned long long key)
+{
+    unsigned long long slot = key & slotMask;
+    while (entries[slot].key != 0 && entries[slot].key != key)
+    {
+        slot = (slot + 1) & slotMask;
+    }
+    return slot;
+}
+
+/**
+ * Map a solution file read-only, check it before any move is served from it
+ * and register it for its variant.
+ * @param  *path: The file, as written by writeSolutionFile.
+ * @retval None; exit(-1) if the file is missing or damaged, or its variant already has one.
+ */
+void loadSolutionFile(char *path)
+{
+    int fd = open(path, O_RDONLY);
+    struct stat status;
+    if (fd == -1 || fstat(fd, &status) == -1)
+    {
+        perror("Error: Problem opening solution file");
+        exit(-1);
+    }
+    if ((size_t)status.st_size < sizeof(struct solutionHeader))
+    {
+        fprintf(stderr, "Error: Solution file %s is truncated.\n", path);
+        exit(-1);
+    }
+    void *mapping = mmap(NULL, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        perror("Error: Problem mapping solution file");
+        exit(-1);
+    }
+
+    const struct solutionHeader *header = mapping;
+    if (memcmp((*header).magic, SOLUTION_MAGIC, sizeof((*header).magic)) != 0 || (*header).version != SOLUTION_VERSION ||
+        (*header).headerSize != sizeof(struct solutionHeader) || (*header).entrySize != sizeof(struct solutionEntry))
+    {
+        fprintf(stderr, "Error: %s is not a version %d solution file.\n", path, SOLUTION_VERSION);
+        exit(-1);
+    }
+    unsigned long long slots = (*header).slotCount;
+    if (!validMnkVariant((*header).rows, (*header).columns, (*header).k) || slots == 0 || slots > SOLUTION_MAX_SLOTS ||
+        (slots & (slots - 1)) != 0 || (*header).entryCount * 4 > slots * 3 ||
+        (unsigned long long)status.st_size != sizeof(struct solutionHeader) + slots * sizeof(struct solutionEntry))
+    {
+        fprintf(stderr, "Error: Solution file %s is damaged.\n", path);
+        exit(-1);
+    }
+    const struct solutionEntry *entries = (const struct solutionEntry *)(header + 1);
+    unsigned long long used = 0, slot;
+    for (slot = 0; slot < slots; slot++)
+    {
+        used += entries[slot].key != 0;
+    }
+    if (used != (*header).entryCount || solutionChecksum(entries, slots) != (*header).checksum)
+    {
+        fprintf(stderr, "Error: Solution file %s fails its checksum.\n", path);
+        exit(-1);
+    }
+
+    int i;
+    for (i = 0; i < globSolutionTableCount; i++)
+    {
+        if (globSolutionTables[i].rows == (*header).rows && globSolutionTables[i].columns == (*header).columns && globSolutionTables[i].k == (*header).k)
+        {
+            fprintf(stderr, "Error: Solution files %s and %s are both for %dx%d k=%d.\n", globSolutionTables[i].path, path,
+                    (*header).rows, (*header).columns, (*header).k);
+            exit(-1);
+        }
+    }
+    struct solutionTable *table = &globSolutionTables[globSolutionTableCount++];
+    (*table).path = path;
+    (*table).rows = (*header).rows;
+    (*table).columns = (*header).columns;
+    (*table).k = (*header).k;
+    (*table).slotMask = slots - 1;
+    (*table).entries = entries;
+    if ((*table).rows == ROWS && (*table).columns == COLUMNS && (*table).k == ROWS)
+    {
+        globSolution = table;
+    }
+}
+
+/**
+ * Look a position up in a mapped solution file.
+ * @param  table: The file.
+ * @param  key: The position's hash.
+ * @retval The position's entry; NULL if it cannot arise in play.
+ */
+const struct solutionEntry *findSolution(const struct solutionTable *table, unsigned long long key)
+{
+    const struct solutionEntry *entry = &(*table).entries[solutionSlot((*table).entries, (*table).slotMask, key)];
+    return (*entry).key != 0 ? entry : NULL;
+}
+
+/**
+ * Look an m,n,k board up in the solution file mapped for its variant.
+ * @param  board: The board.
+ * @retval The position's entry; NULL if no file is mapped for the variant or the position is not in it.
+ */
+const struct solutionEntry *findMnkSolution(struct mnkBoard *board)
+{
+    int i;
+    for (i = 0; i < globSolutionTableCount; i++)
+    {
+        const struct solutionTable *table = &globSolutionTables[i];
+        if ((*table).rows == (*board).rows && (*table).columns == (*board).columns && (*table).k == (*board).k)
+        {
+            return findSolution(table, (*board).hash);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Fill the symmetry tables: the four rotations, then the four reflections.
+ * @retval None.
+ */
+void initTransforms()
+{
+    int transform, square, other;
+    for (square = 0; square < SQUARES; square++)
+    {
+        int row = square / COLUMNS;
+        int column = square % COLUMNS;
+        int last = ROWS - 1;
+        int rows[SYMMETRIES] = {row, column, last - row, last - column, row, last - row, column, last - column};
+        int columns[SYMMETRIES] = {column, last - row, last - column, row, last - column, column, row, last - row};
+        for (transform = 0; transform < SYMMETRIES; transform++)
+        {
+            globTransformSquare[transform][square] = rows[transform] * COLUMNS + columns[transform];
+        }
+    }
+
+    for (transform = 0; transform < SYMMETRIES; transform++)
+    {
+        int mask;
+        for (mask = 0; mask <= FULL_BOARD; mask++)
+        {
+            unsigned short image = 0;
+            for (square = 0; square < SQUARES; square++)
+            {
+                if (mask & (1 << square))
+                {
+                    image |= 1 << globTransformSquare[transform][square];
+                }
+            }
+            globTransformMask[transform][mask] = image;
+        }
+
+        for (other = 0; other < SYMMETRIES; other++)
+        {
+            for (square = 0; square < SQUARES; square++)
+            {
+                if (globTransformSquare[other][globTransformSquare[transform][square]] != square)
+                {
+                    break;
+                }
+            }
+            if (square == SQUARES)
+            {
+                globInverseTransform[transform] = other;
+            }
+        }
+    }
+}
+
+/**
+ * Map a board to its canonical form: the smallest key among its 8 symmetric images.
+ * @param  client: Squares taken by the client.
+ * @param  server: Squares taken by the server.
+ * @param  *transform: Set to the symmetry that takes the board to its canonical form.
+ * @retval The canonical key, server mask << SQUARES | client mask.
+ */
+unsigned int canonicalPosition(unsigned short client, unsigned short server, int *transform)
+{
+    unsigned int best = ((unsigned int)server << SQUARES) | client;
+    *transform = 0;
+    int i;
+    for (i = 1; i < SYMMETRIES; i++)
+    {
+        unsigned int key = ((unsigned int)globTransformMask[i][server] << SQUARES) | globTransformMask[i][client];
+        if (key < best)
+        {
+            best = key;
+            *transform = i;
+        }
+    }
+    return best;
+}
+
+/**
+ * Find the slot for a canonical position, probing linearly from its hash.
+ * @param  key: The canonical key.
+ * @retval The entry holding the key, or the empty slot where it belongs.
+ */
+struct positionEntry *findPosition(unsigned int key)
+{
+    unsigned int slot = (key * 2654435761u) >> 22 & POSITION_SLOT_MASK;
+    while (globPositions[slot].used && globPositions[slot].key != key)
+    {
+        slot = (slot + 1) & POSITION_SLOT_MASK;
+    }
+    return &globPositions[slot];
+}
+
+/**
+ * Look up the perfect or greedy move for a board in the mapped solution file,
+ * by its key, or in globMoveIndex, by its base 3 encoding.
+ * @param  board: The board.
+ * @param  greedy: 1 for the greedy move; 0 for the perfect move.
+ * @retval The move (1-9); 0 if the board cannot arise in play or the game is over.
+ */
+int lookupMove(struct tttBoard *board, int greedy)
+{
+    if (globSolution != NULL)
+    {
+        const struct solutionEntry *entry = findSolution(globSolution, globSolutionKeys[0][(*board).client] ^ globSolutionKeys[1][(*board).server]);
+        if (entry == NULL)
+        {
+            return 0;
+        }
+        return greedy ? (*entry).greedyMove : (*entry).bestMove;
+    }
+    int index = globTernary[(*board).client] + 2 * globTernary[(*board).server];
+    return greedy ? globMoveIndex[index] >> 4 : globMoveIndex[index] & 0x0F;
+}
+
+/**
+ * Look up the perfect or greedy move for a board through its canonical form.
+ * @param  board: The board.
+ * @param  greedy: 1 for the greedy move; 0 for the perfect move.
+ * @retval The move (1-9); 0 if the board cannot arise in play or the game is over.
+ */
+int canonicalMove(struct tttBoard *board, int greedy)
+{
+    int transform;
+    struct positionEntry *entry = findPosition(canonicalPosition((*board).client, (*board).server, &transform));
+    int move = greedy ? (*entry).greedyMove : (*entry).bestMove;
+    if (!(*entry).used || move == 0)
+    {
+        return 0;
+    }
+    //Map the canonical board's move back onto this board
+    return globTransformSquare[globInverseTransform[transform]][move - 1] + 1;
+}
+
+/**
+ * Minimax with memoisation on the canonical form: score a position and record
+ * the best and greedy moves for the player to move, who is the server if the
+ * client has more squares.
+ * @param  client: Squares taken by the client.
+ * @param  server: Squares taken by the server.
+ * @retval Score for the server: 1 + empty squares for a win, the negative for a loss, 0 for a draw.
+ */
+int solvePosition(unsigned short client, unsigned short server)
+{
+    int transform;
+    unsigned int key = canonicalPosition(client, server, &transform);
+    struct positionEntry *entry = findPosition(key);
+    if ((*entry).used)
+    {
+        return (*entry).score;
+    }
+    if (globSolvedPositions == POSITION_SLOTS - 1)
+    {
+        fprintf(stderr, "Error: Position table full\n");
+        exit(-1);
+    }
+    globSolvedPositions++;
+
+    unsigned short empty = ~(client | server) & FULL_BOARD;
+    int score;
+    int bestMove = 0, greedy = 0;
+    if (globWinTable[client])
+    {
+        score = -(1 + __builtin_popcount(empty));
+    }
+    else if (globWinTable[server])
+    {
+        score = 1 + __builtin_popcount(empty);
+    }
+    else if (empty == 0)
+    {
+        score = 0;
+    }
+    else
+    {
+        int serverToMove = __builtin_popcount(client) > __builtin_popcount(server);
+        greedy = serverToMove ? greedyMove(server, client) : greedyMove(client, server);
+        score = serverToMove ? -SQUARES - 1 : SQUARES + 1;
+        unsigned short remaining = empty;
+        while (remaining)
+        {
+            int square = __builtin_ctz(remaining);
+            remaining &= remaining - 1;
+            int childScore = serverToMove ? solvePosition(client, server | (1 << square)) : solvePosition(client | (1 << square), server);
+            if (serverToMove ? childScore > score : childScore < score)
+            {
+                score = childScore;
+                bestMove = square + 1;
+            }
+        }
+    }
+
+    //Children may have filled slots, so find this position's slot again, and
+    //store moves as they fall on the canonical board
+    entry = findPosition(key);
+    (*entry).key = key;
+    (*entry).used = 1;
+    (*entry).score = score;
+    (*entry).bestMove = bestMove ? globTransformSquare[transform][bestMove - 1] + 1 : 0;
+    (*entry).greedyMove = greedy ? globTransformSquare[transform][greedy - 1] + 1 : 0;
+    return score;
+}
+
+/**
+ * Check that an m,n,k variant fits the board limits.
+ * @param  rows/columns: Board size, MIN_MNK_SIDE to MAX_MNK_SIDE each.
+ * @param  k: Stones in a row to win, at least MIN_MNK_SIDE and at most the longer side.
+ * @retval 1 if valid; 0 otherwise.
+ */
+int validMnkVariant(int rows, int columns, int k)
+{
+    int longestSide = rows > columns ? rows : columns;
+    return rows >= MIN_MNK_SIDE && rows <= MAX_MNK_SIDE && columns >= MIN_MNK_SIDE && columns <= MAX_MNK_SIDE &&
+           k >= MIN_MNK_SIDE && k <= longestSide;
+}
+
+/**
+ * Allocate an empty m,n,k board.
+ * @param  rows/columns/k: A valid variant.
+ * @retval The board; NULL if out of memory.
+ */
+struct mnkBoard *createMnkBoard(int rows, int columns, int k)
+{
+    struct mnkBoard *board = calloc(1, sizeof(struct mnkBoard));
+    if (board == NULL)
+    {
+        return NULL;
+    }
+    (*board).rows = rows;
+    (*board).columns = columns;
+    (*board).k = k;
+    (*board).lastMove = -1;
+    (*board).hash = variantKey(rows, columns, k);
+    return board;
+}
+
+/**
+ * Validate and place a move on an m,n,k board.
+ * @param  board: The board to place move on.
+ * @param  move: The square, 1 to rows * columns, row by row.
+ * @param  player: The player placing the move (client or server).
+ * @retval 1 if move placed successfully; 0 otherwise.
+ */
+int mnkPlace(struct mnkBoard *board, int move, int player)
+{
+    if (move < 1 || move > (*board).rows * (*board).columns || (*board).cells[move - 1] != 0)
+    {
+        return 0;
+    }
+    mnkPush(board, move - 1, player);
+    (*board).lastMove = move - 1;
+    return 1;
+}
+
+/**
+ * Put a stone on an empty square and update the board's hash.
+ * @param  board: The board.
+ * @param  square: The square (0 based).
+ * @param  player: SERVER_PLAYER or CLIENT_PLAYER.
+ * @retval None.
+ */
+void mnkPush(struct mnkBoard *board, int square, int player)
+{
+    (*board).cells[square] = player;
+    (*board).stones++;
+    (*board).hash ^= globZobrist[square][player - 1];
+}
+
+/**
+ * Take a stone back off a square and update the board's hash.
+ * @param  board: The board.
+ * @param  square: The square (0 based) of the stone.
+ * @retval None.
+ */
+void mnkPop(struct mnkBoard *board, int square)
+{
+    (*board).hash ^= globZobrist[square][(*board).cells[square] - 1];
+    (*board).cells[square] = 0;
+    (*board).stones--;
+}
+
+/**
+ * Advance a splitmix64 generator.
+ * @param  *state: The generator state.
+ * @retval The next 64 bit value.
+ */
+unsigned long long splitMix64(unsigned long long *state)
+{
+    unsigned long long value = (*state += 0x9E3779B97F4A7C15ULL);
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+    return value ^ (value >> 31);
+}
+
+/**
+ * Fill the Zobrist keys, the same in every run so solution files keep their
+ * keys, and the classic board's solution keys built from them.
+ * @retval None.
+ */
+void initZobrist()
+{
+    unsigned long long state = ZOBRIST_SEED;
+    int square;
+    for (square = 0; square < MAX_MNK_SQUARES; square++)
+    {
+        globZobrist[square][0] = splitMix64(&state);
+        globZobrist[square][1] = splitMix64(&state);
+    }
+    globZobristSide = splitMix64(&state);
+
+    int mask;
+    for (mask = 0; mask <= FULL_BOARD; mask++)
+    {
+        globSolutionKeys[0][mask] = variantKey(ROWS, COLUMNS, ROWS);
+        globSolutionKeys[1][mask] = 0;
+        for (square = 0; square < SQUARES; square++)
+        {
+            if (mask & (1 << square))
+            {
+                globSolutionKeys[0][mask] ^= globZobrist[square][CLIENT_PLAYER - 1];
+                globSolutionKeys[1][mask] ^= globZobrist[square][SERVER_PLAYER - 1];
+            }
+        }
+    }
+}
+
+/**
+ * Allocate the shared transposition table, the largest power of two number
+ * of entries that fits in globTranspositionMb.
+ * @retval None; exit(-1) if error.
+ */
+void initTransposition()
+{
+    unsigned long long entries = TRANSPOSITION_BUCKET;
+    while (entries * 2 * sizeof(struct transpositionEntry) <= (unsigned long long)globTranspositionMb << 20)
+    {
+        entries *= 2;
+    }
+    //Untouched pages of the zeroed mapping cost nothing until searches reach them
+    globTransposition = mmap(NULL, entries * sizeof(struct transpositionEntry), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (globTransposition == MAP_FAILED)
+    {
+        perror("Error: Problem allocating transposition table");
+        exit(-1);
+    }
+    globTranspositionMask = entries - 1;
+}
+
+/**
+ * Hash of a variant, the starting hash of its boards, so different variants
+ * never share transposition entries.
+ * @param  rows/columns/k: The variant.
+ * @retval The key.
+ */
+unsigned long long variantKey(int rows, int columns, int k)
+{
+    unsigned long long state = ZOBRIST_SEED ^ ((unsigned long long)rows << 16 | columns << 8 | k);
+    return splitMix64(&state);
+}
+
+/**
+ * Look a position up in the transposition table. A stored best move is
+ * returned even when the entry is too shallow to use its score.
+ * @param  key: Board hash, with globZobristSide mixed in when the server is to move.
+ * @param  depth: Depth the caller will search to.
+ * @param  ply: Plies from the root, to turn stored win scores back into this search's.
+ * @param  *alpha, *beta: Search window, narrowed by bound entries.
+ * @param  *score: Set to the stored score when the entry settles the position.
+ * @param  *move: Set to the stored best square (0 based), -1 if none.
+ * @retval 1 if the entry settles the position; 0 otherwise.
+ */
+int probeTransposition(unsigned long long key, int depth, int ply, int *alpha, int *beta, int *score, int *move)
+{
+    struct transpositionEntry *bucket = &globTransposition[key & globTranspositionMask & ~(unsigned long long)(TRANSPOSITION_BUCKET - 1)];
+    *move = -1;
+    globProbes++;
+    int i;
+    for (i = 0; i < TRANSPOSITION_BUCKET; i++)
+    {
+        unsigned long long check = __atomic_load_n(&bucket[i].check, __ATOMIC_RELAXED);
+        unsigned long long data = __atomic_load_n(&bucket[i].data, __ATOMIC_RELAXED);
+        if ((check ^ data) != key || !(data & TRANSPOSITION_VALID))
+        {
+            continue;
+        }
+        globProbeHits++;
+        *move = (int)((data >> 32) & 0xFFFF) - 1;
+        if ((int)((data >> 48) & 0xFF) < depth)
+        {
+            return 0;
+        }
+
+        int stored = (int)(unsigned int)data;
+        if (stored >= MNK_WIN_SCORE - MAX_MNK_SQUARES)
+            stored -= ply;
+        else if (stored <= -(MNK_WIN_SCORE - MAX_MNK_SQUARES))
+            stored += ply;
+        int bound = (data >> 56) & 3;
+        if (bound == TRANSPOSITION_LOWER && stored > *alpha)
+            *alpha = stored;
+        else if (bound == TRANSPOSITION_UPPER && stored < *beta)
+            *beta = stored;
+        if (bound == TRANSPOSITION_EXACT || *alpha >= *beta)
+        {
+            globProbeCutoffs++;
+            *score = stored;
+            return 1;
+        }
+        return 0;
+    }
+    return 0;
+}
+
+/**
+ * Store a search result. The first entry of the bucket keeps the deepest
+ * result of recent searches; everything else goes to the second entry.
+ * @param  key: Board hash, as for probeTransposition.
+ * @param  generation: The storing search's generation.
+ * @param  depth: Depth searched.
+ * @param  ply: Plies from the root; win scores are stored relative to this position.
+ * @param  score: The result.
+ * @param  bound: TRANSPOSITION_EXACT, _LOWER (score >= beta) or _UPPER (score <= alpha).
+ * @param  move: Best square (0 based), -1 if none.
+ * @retval None.
+ */
+void storeTransposition(unsigned long long key, unsigned int generation, int depth, int ply, int score, int bound, int move)
+{
+    if (score >= MNK_WIN_SCORE - MAX_MNK_SQUARES)
+        score += ply;
+    else if (score <= -(MNK_WIN_SCORE - MAX_MNK_SQUARES))
+        score -= ply;
+    unsigned long long data = (unsigned int)score | (unsigned long long)(move + 1) << 32 | (unsigned long long)depth << 48 |
+                              (unsigned long long)bound << 56 | (unsigned long long)(generation % TRANSPOSITION_GENERATIONS) << 58 | TRANSPOSITION_VALID;
+
+    struct transpositionEntry *bucket = &globTransposition[key & globTranspositionMask & ~(unsigned long long)(TRANSPOSITION_BUCKET - 1)];
+    unsigned long long oldCheck = __atomic_load_n(&bucket[0].check, __ATOMIC_RELAXED);
+    unsigned long long oldData = __atomic_load_n(&bucket[0].data, __ATOMIC_RELAXED);
+    struct transpositionEntry *entry = &bucket[1];
+    if ((oldCheck ^ oldData) == key || !(oldData & TRANSPOSITION_VALID) || (int)((oldData >> 48) & 0xFF) <= depth ||
+        ((oldData >> 58) & (TRANSPOSITION_GENERATIONS - 1)) != generation % TRANSPOSITION_GENERATIONS)
+    {
+        entry = &bucket[0];
+    }
+    __atomic_store_n(&(*entry).check, key ^ data, __ATOMIC_RELAXED);
+    __atomic_store_n(&(*entry).data, data, __ATOMIC_RELAXED);
+    globTranspositionStores++;
+}
+
+/**
+ * Add this thread's transposition counters to the process totals.
+ * @retval None.
+ */
+void addTranspositionCounters()
+{
+    __atomic_add_fetch(&globTotalProbes, globProbes, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&globTotalProbeHits, globProbeHits, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&globTotalProbeCutoffs, globProbeCutoffs, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&globTotalTranspositionStores, globTranspositionStores, __ATOMIC_RELAXED);
+    globProbes = globProbeHits = globProbeCutoffs = globTranspositionStores = 0;
+}
+
+/**
+ * Count a finished search and every TRANSPOSITION_REPORT_SEARCHES searches
+ * print the table's totals so it can be sized (-T) for the traffic.
+ * @retval None.
+ */
+void reportTransposition()
+{
+    addTranspositionCounters();
+    long long searches = __atomic_add_fetch(&globTotalSearches, 1, __ATOMIC_RELAXED);
+    if (searches % TRANSPOSITION_REPORT_SEARCHES == 0)
+    {
+        long long probes = __atomic_load_n(&globTotalProbes, __ATOMIC_RELAXED);
+        long long hits = __atomic_load_n(&globTotalProbeHits, __ATOMIC_RELAXED);
+        long long cutoffs = __atomic_load_n(&globTotalProbeCutoffs, __ATOMIC_RELAXED);
+        printf("--- TRANSPOSITION TABLE - %lld searches, %lld probes, %.1f%% hits, %.1f%% cutoffs, %lld stores, %llu entries\n",
+               searches, probes, probes ? 100.0 * hits / probes : 0, probes ? 100.0 * cutoffs / probes : 0,
+               __atomic_load_n(&globTotalTranspositionStores, __ATOMIC_RELAXED), globTranspositionMask + 1);
+    }
+}
+
+/**
+ * Length of the run of stones through a square along one direction, counting both ways.
+ * @param  board: The board.
+ * @param  square: The square (0 based), holding the stone whose run is measured.
+ * @param  rowStep/columnStep: The direction.
+ * @retval The run length, at least 1.
+ */
+int mnkRunLength(struct mnkBoard *board, int square, int rowStep, int columnStep)
+{
+    int player = (*board).cells[square];
+    int row = square / (*board).columns;
+    int column = square % (*board).columns;
+    int length = 1;
+    int side;
+    for (side = -1; side <= 1; side += 2)
+    {
+        int r = row + side * rowStep;
+        int c = column + side * columnStep;
+        while (r >= 0 && r < (*board).rows && c >= 0 && c < (*board).columns &&
+               (*board).cells[r * (*board).columns + c] == player)
+        {
+            length++;
+            r += side * rowStep;
+            c += side * columnStep;
+        }
+    }
+    return length;
+}
+
+/**
+ * Check whether the stone on a square completes k in a row. Only lines
+ * through that square are looked at.
+ * @param  board: The board.
+ * @param  square: The square (0 based) of the stone.
+ * @retval 1 if it wins; 0 otherwise.
+ */
+int mnkWinsAt(struct mnkBoard *board, int square)
+{
+    return mnkRunLength(board, square, 0, 1) >= (*board).k || mnkRunLength(board, square, 1, 0) >= (*board).k ||
+           mnkRunLength(board, square, 1, 1) >= (*board).k || mnkRunLength(board, square, 1, -1) >= (*board).k;
+}
+
+/**
+ * Check if a player has won an m,n,k game with the latest stone.
+ * @param  board: The game board to check.
+ * @param  player: The last player to place a move.
+ * @retval {win code} if player has won; {draw code} if tie; -1 otherwise.
+ */
+int mnkCheckWin(struct mnkBoard *board, int player)
+{
+    if ((*board).lastMove >= 0 && mnkWinsAt(board, (*board).lastMove))
+    {
+        return player == SERVER_PLAYER ? SERVER_WIN : CLIENT_WIN;
+    }
+    if ((*board).stones == (*board).rows * (*board).columns)
+    {
+        return DRAW;
+    }
+    return -1;
+}
+
+/**
+ * Static evaluation: every k long window that only one player has stones in
+ * counts for that player, 4 times more for each extra stone.
+ * @param  board: The board.
+ * @param  player: The player to score for.
+ * @retval The score; positive favours player.
+ */
+int mnkEvaluate(struct mnkBoard *board, int player)
+{
+    static const int directions[4][2] = {{0, 1}, {1, 0}, {1, 1}, {1, -1}};
+    int rows = (*board).rows, columns = (*board).columns, k = (*board).k;
+    int score = 0;
+    int direction, row, column, i;
+    for (direction = 0; direction < 4; direction++)
+    {
+        int rowStep = directions[direction][0];
+        int columnStep = directions[direction][1];
+        for (row = 0; row < rows; row++)
+        {
+            for (column = 0; column < columns; column++)
+            {
+                int lastRow = row + (k - 1) * rowStep;
+                int lastColumn = column + (k - 1) * columnStep;
+                if (lastRow >= rows || lastColumn < 0 || lastColumn >= columns)
+                {
+                    continue;
+                }
+                int mine = 0, theirs = 0;
+                for (i = 0; i < k; i++)
+                {
+                    int cell = (*board).cells[(row + i * rowStep) * columns + column + i * columnStep];
+                    if (cell == player)
+                        mine++;
+                    else if (cell != 0)
+                        theirs++;
+                }
+                if (mine > 0 && theirs == 0)
+                {
+                    score += 1 << (2 * (mine < MNK_MAX_WINDOW_WEIGHT ? mine : MNK_MAX_WINDOW_WEIGHT));
+                }
+                else if (theirs > 0 && mine == 0)
+                {
+                    score -= 1 << (2 * (theirs < MNK_MAX_WINDOW_WEIGHT ? theirs : MNK_MAX_WINDOW_WEIGHT));
+                }
+            }
+        }
+    }
+    return score;
+}
+
+/**
+ * List the moves worth searching, best first: empty squares next to a stone
+ * (the center on an empty board), ordered by the longest runs they would make
+ * for the player or block for the opponent.
+ * @param  board: The board; must not be full.
+ * @param  player: The player to move.
+ * @param  moves[MAX_MNK_SQUARES]: Filled with the squares (0 based).
+ * @retval Number of moves.
+ */
+int mnkCandidates(struct mnkBoard *board, int player, unsigned short moves[MAX_MNK_SQUARES])
+{
+    int rows = (*board).rows, columns = (*board).columns;
+    int other = player == SERVER_PLAYER ? CLIENT_PLAYER : SERVER_PLAYER;
+    int scores[MAX_MNK_SQUARES];
+    int count = 0;
+    int square;
+
+    if ((*board).stones == 0)
+    {
+        moves[0] = (rows / 2) * columns + columns / 2;
+        return 1;
+    }
+
+    for (square = 0; square < rows * columns; square++)
+    {
+        if ((*board).cells[square] != 0)
+        {
+            continue;
+        }
+        int row = square / columns, column = square % columns;
+        int r, c, near = 0;
+        for (r = row - 1; r <= row + 1 && !near; r++)
+        {
+            for (c = column - 1; c <= column + 1; c++)
+            {
+                if (r >= 0 && r < rows && c >= 0 && c < columns && (*board).cells[r * columns + c] != 0)
+                {
+                    near = 1;
+                    break;
+                }
+            }
+        }
+        if (!near)
+        {
+            continue;
+        }
+
+        //Runs the square would extend for either side; finishing or blocking long runs comes first
+        int score = 0, side;
+        for (side = 0; side < 2; side++)
+        {
+            (*board).cells[square] = side == 0 ? player : other;
+            int runs[4] = {mnkRunLength(board, square, 0, 1), mnkRunLength(board, square, 1, 0),
+                           mnkRunLength(board, square, 1, 1), mnkRunLength(board, square, 1, -1)};
+            int direction;
+            for (direction = 0; direction < 4; direction++)
+            {
+                int run = runs[direction] < MNK_MAX_WINDOW_WEIGHT ? runs[direction] : MNK_MAX_WINDOW_WEIGHT;
+                if (runs[direction] >= (*board).k)
+                {
+                    run = MNK_MAX_WINDOW_WEIGHT + 1 - side;
+                }
+                score += 1 << (2 * run);
+            }
+        }
+        (*board).cells[square] = 0;
+
+        //Insertion sort, highest score first
+        int i = count++;
+        while (i > 0 && scores[i - 1] < score)
+        {
+            scores[i] = scores[i - 1];
+            moves[i] = moves[i - 1];
+            i--;
+        }
+        scores[i] = score;
+        moves[i] = square;
+    }
+    return count;
+}
+
+/**
+ * Depth-limited negamax with alpha-beta pruning. Gives up once the search's
+ * deadline passes or it is stopped, setting aborted.
+ * @param  board: The board; stones are placed and taken back during the search.
+ * @param  search: The search's deadline and node count.
+ * @param  depth: Plies left to search.
+ * @param  ply: Plies from the root, so faster wins score higher.
+ * @param  alpha/beta: The search window.
+ * @param  player: The player to move.
+ * @retval Score for player.
+ */
+int mnkNegamax(struct mnkBoard *board, struct mnkSearch *search, int depth, int ply, int alpha, int beta, int player)
+{
+    (*search).nodes++;
+    if (((*search).nodes & (MNK_CLOCK_CHECK_NODES - 1)) == 0 &&
+        (currentTimeMs() >= (*search).deadlineMs || __atomic_load_n((*search).stop, __ATOMIC_RELAXED)))
+    {
+        (*search).aborted = 1;
+    }
+    if ((*search).aborted)
+    {
+        return 0;
+    }
+
+    //Positions reached by other games or move orders are already in the table
+    unsigned long long key = (*board).hash ^ (player == SERVER_PLAYER ? globZobristSide : 0);
+    int score, tableMove;
+    if (probeTransposition(key, depth, ply, &alpha, &beta, &score, &tableMove))
+    {
+        return score;
+    }
+    if (depth == 0)
+    {
+        score = mnkEvaluate(board, player);
+        storeTransposition(key, (*search).generation, 0, ply, score, TRANSPOSITION_EXACT, -1);
+        return score;
+    }
+
+    unsigned short moves[MAX_MNK_SQUARES];
+    int count = mnkCandidates(board, player, moves);
+    int other = player == SERVER_PLAYER ? CLIENT_PLAYER : SERVER_PLAYER;
+    int best = -MNK_INFINITY, bestSquare = -1;
+    int alphaStart = alpha;
+    int i;
+
+    //Try the table's best move first
+    for (i = 1; i < count && tableMove >= 0; i++)
+    {
+        if (moves[i] == tableMove)
+        {
+            moves[i] = moves[0];
+            moves[0] = tableMove;
+            break;
+        }
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        int square = moves[i];
+        mnkPush(board, square, player);
+
+        if (mnkWinsAt(board, square))
+            score = MNK_WIN_SCORE - ply;
+        else if ((*board).stones == (*board).rows * (*board).columns)
+            score = 0;
+        else
+            score = -mnkNegamax(board, search, depth - 1, ply + 1, -beta, -alpha, other);
+
+        mnkPop(board, square);
+        if ((*search).aborted)
+        {
+            return 0;
+        }
+
+        if (score > best)
+        {
+            best = score;
+            bestSquare = square;
+        }
+        if (best > alpha)
+            alpha = best;
+        if (alpha >= beta)
+            break;
+    }
+
+    int bound = best <= alphaStart ? TRANSPOSITION_UPPER : best >= beta ? TRANSPOSITION_LOWER : TRANSPOSITION_EXACT;
+    storeTransposition(key, (*search).generation, depth, ply, best, bound, bestSquare);
+    return best;
+}
+
+/**
+ * Search for the server's move with up to threads threads, stopped by a hard
+ * time budget. The calling thread posts the move for threads - 1 idle
+ * helpers, searches it itself, then stops the helpers and plays its own
+ * result, which their transposition table entries have deepened.
+ * @param  board: The board; must not be full.
+ * @param  budgetMs: Time allowed.
+ * @param  threads: Threads to search with, including the caller.
+ * @param  *depthReached: Set to the deepest depth the caller finished.
+ * @param  *nodes: Set to the nodes searched by every thread.
+ * @retval The move (1 to rows * columns).
+ */
+int mnkSearchMove(struct mnkBoard *board, int budgetMs, int threads, int *depthReached, long long *nodes)
+{
+    struct searchJob job;
+    job.board = *board;
+    job.deadlineMs = currentTimeMs() + budgetMs;
+    job.generation = __atomic_add_fetch(&globTranspositionGeneration, 1, __ATOMIC_RELAXED);
+    job.wanted = threads - 1;
+    job.joined = 0;
+    job.active = 0;
+    job.stop = 0;
+    job.nodes = 0;
+    job.next = NULL;
+    int posted = job.wanted > 0 && globSearchHelpersStarted > 0;
+    if (posted)
+    {
+        pthread_mutex_lock(&globSearchLock);
+        struct searchJob **tail = &globSearchJobs;
+        while (*tail != NULL)
+        {
+            tail = &(**tail).next;
+        }
+        *tail = &job;
+        pthread_cond_broadcast(&globSearchPosted);
+        pthread_mutex_unlock(&globSearchLock);
+    }
+
+    struct mnkSearch search;
+    search.deadlineMs = job.deadlineMs;
+    search.nodes = 0;
+    search.aborted = 0;
+    search.generation = job.generation;
+    search.stop = &job.stop;
+    int move = mnkIterate(board, &search, 0, depthReached);
+
+    //Stop the helpers and wait for them to let go of the job
+    if (posted)
+    {
+        pthread_mutex_lock(&globSearchLock);
+        __atomic_store_n(&job.stop, 1, __ATOMIC_RELAXED);
+        job.wanted = 0;
+        struct searchJob **link = &globSearchJobs;
+        while (*link != &job)
+        {
+            link = &(**link).next;
+        }
+        *link = job.next;
+        while (job.active > 0)
+        {
+            pthread_cond_wait(&globSearchFinished, &globSearchLock);
+        }
+        pthread_mutex_unlock(&globSearchLock);
+    }
+    *nodes = search.nodes + job.nodes;
+    reportTransposition();
+    return move;
+}
+
+/**
+ * Iterative deepening alpha-beta search from the server's turn. Each finished
+ * depth's best move is searched first at the next depth and stored in the
+ * shared transposition table; a depth the search cuts short is thrown away.
+ * Helpers start from a different root move, and odd helpers one depth deeper,
+ * so threads on the same move fill the table with different work.
+ * @param  board: The board; must not be full.
+ * @param  search: The search's deadline, stop flag and node count.
+ * @param  helper: 0 for the thread that owns the move, else the helper's number.
+ * @param  *depthReached: Set to the deepest finished depth.
+ * @retval The move (1 to rows * columns).
+ */
+int mnkIterate(struct mnkBoard *board, struct mnkSearch *search, int helper, int *depthReached)
+{
+    unsigned short moves[MAX_MNK_SQUARES];
+    int count = mnkCandidates(board, SERVER_PLAYER, moves);
+    int emptySquares = (*board).rows * (*board).columns - (*board).stones;
+    int i;
+    if (helper > 0)
+    {
+        unsigned short first = moves[helper % count];
+        for (i = helper % count; i > 0; i--)
+        {
+            moves[i] = moves[i - 1];
+        }
+        moves[0] = first;
+    }
+    int bestMove = moves[0];
+    *depthReached = 0;
+
+    int depth;
+    for (depth = 1 + (helper & 1); depth <= emptySquares; depth++)
+    {
+        int alpha = -MNK_INFINITY;
+        int bestIndex = 0;
+        for (i = 0; i < count; i++)
+        {
+            int square = moves[i];
+            mnkPush(board, square, SERVER_PLAYER);
+
+            int score;
+            if (mnkWinsAt(board, square))
+                score = MNK_WIN_SCORE;
+            else if ((*board).stones == (*board).rows * (*board).columns)
+                score = 0;
+            else
+                score = -mnkNegamax(board, search, depth - 1, 1, -MNK_INFINITY, -alpha, CLIENT_PLAYER);
+
+            mnkPop(board, square);
+            if ((*search).aborted)
+            {
+                break;
+            }
+            if (score > alpha)
+            {
+                alpha = score;
+                bestIndex = i;
+            }
+        }
+        if ((*search).aborted)
+        {
+            break;
+        }
+
+        bestMove = moves[bestIndex];
+        *depthReached = depth;
+        storeTransposition((*board).hash ^ globZobristSide, (*search).generation, depth, 0, alpha, TRANSPOSITION_EXACT, bestMove);
+
+        //Search this depth's best move first next time
+        for (i = bestIndex; i > 0; i--)
+        {
+            moves[i] = moves[i - 1];
+        }
+        moves[0] = bestMove;
+
+        //A forced win or loss found at this depth cannot change
+        if (alpha >= MNK_WIN_SCORE - MAX_MNK_SQUARES || alpha <= -(MNK_WIN_SCORE - MAX_MNK_SQUARES))
+        {
+            break;
+        }
+    }
+    return bestMove + 1;
+}
+
+/**
+ * Start helper threads for m,n,k searches, up to helpers in total.
+ * @param  helpers: Helpers the process should have.
+ * @retval None; exit(-1) if error.
+ */
+void startSearchHelpers(int helpers)
+{
+    while (globSearchHelpersStarted < helpers)
+    {
+        pthread_t helper;
+        errno = pthread_create(&helper, NULL, runSearchHelper, NULL);
+        if (errno != 0)
+        {
+            perror("Error: Problem starting search helper thread");
+            exit(-1);
+        }
+        pthread_detach(helper);
+        globSearchHelpersStarted++;
+    }
+}
+
+/**
+ * Run a search helper: wait for a posted move still wanting help, search a
+ * copy of its board until its owner stops it, and go back for more.
+ * @param *unused: Unused.
+ * @retval Never returns.
+ */
+void *runSearchHelper(void *unused)
+{
+    pthread_mutex_lock(&globSearchLock);
+    while (1)
+    {
+        struct searchJob *job = globSearchJobs;
+        while (job != NULL && (*job).wanted == 0)
+        {
+            job = (*job).next;
+        }
+        if (job == NULL)
+        {
+            pthread_cond_wait(&globSearchPosted, &globSearchLock);
+            continue;
+        }
+        (*job).wanted--;
+        (*job).active++;
+        int helper = ++(*job).joined;
+        pthread_mutex_unlock(&globSearchLock);
+
+        struct mnkBoard board = (*job).board;
+        struct mnkSearch search;
+        search.deadlineMs = (*job).deadlineMs;
+        search.nodes = 0;
+        search.aborted = 0;
+        search.generation = (*job).generation;
+        search.stop = &(*job).stop;
+        int depth;
+        mnkIterate(&board, &search, helper, &depth);
+        addTranspositionCounters();
+
+        pthread_mutex_lock(&globSearchLock);
+        (*job).nodes += search.nodes;
+        (*job).active--;
+        if ((*job).active == 0)
+        {
+            pthread_cond_broadcast(&globSearchFinished);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Choose the greedy move on an m,n,k board: win, else block, else the best
+ * ordered candidate.
+ * @param  board: The board; must not be full.
+ * @param  player: The player to move.
+ * @retval The move (1 to rows * columns).
+ */
+int mnkGreedyMove(struct mnkBoard *board, int player)
+{
+    unsigned short moves[MAX_MNK_SQUARES];
+    int count = mnkCandidates(board, player, moves);
+    int other = player == SERVER_PLAYER ? CLIENT_PLAYER : SERVER_PLAYER;
+    int pass, i;
+    for (pass = 0; pass < 2; pass++)
+    {
+        for (i = 0; i < count; i++)
+        {
+            (*board).cells[moves[i]] = pass == 0 ? player : other;
+            int wins = mnkWinsAt(board, moves[i]);
+            (*board).cells[moves[i]] = 0;
+            if (wins)
+            {
+                return moves[i] + 1;
+            }
+        }
+    }
+    return moves[0] + 1;
+}
+
+/**
+ * Pick an empty square of an m,n,k board uniformly at random.
+ * @param  board: The board; must not be full.
+ * @retval The move (1 to rows * columns).
+ */
+int mnkRandomMove(struct mnkBoard *board)
+{
+    int squares = (*board).rows * (*board).columns;
+    int skip = ((nextRandom() >> 16) * (squares - (*board).stones)) >> 16;
+    int square;
+    for (square = 0; square < squares; square++)
+    {
+        if ((*board).cells[square] == 0 && skip-- == 0)
+        {
+            break;
+        }
+    }
+    return square + 1;
+}
+
+/**
+ * Places the server's move on an m,n,k board for a difficulty. A solution
+ * file mapped for the variant answers first; otherwise perfect play searches
+ * for at most globMoveBudgetMs with globSearchThreads threads.
+ * @param  board: The board to place a move on; must not be full.
+ * @param  difficulty: DIFFICULTY_PERFECT, DIFFICULTY_GREEDY or DIFFICULTY_RANDOM.
+ * @param  blunderRate: Percent of moves played at random instead.
+ * @retval The move placed by server.
+ */
+int placeMnkServerMove(struct mnkBoard *board, int difficulty, int blunderRate)
+{
+    int choice = 0;
+    if (difficulty == DIFFICULTY_RANDOM || (blunderRate > 0 && (int)(((nextRandom() >> 16) * 100) >> 16) < blunderRate))
+    {
+        choice = mnkRandomMove(board);
+    }
+    else
+    {
+        //A solution file for the variant answers without searching
+        const struct solutionEntry *entry = findMnkSolution(board);
+        if (entry != NULL)
+        {
+            choice = difficulty == DIFFICULTY_GREEDY ? (*entry).greedyMove : (*entry).bestMove;
+        }
+    }
+    if (choice == 0 && difficulty == DIFFICULTY_GREEDY)
+    {
+        choice = mnkGreedyMove(board, SERVER_PLAYER);
+    }
+    else if (choice == 0)
+    {
+        int depth;
+        long long nodes;
+        choice = mnkSearchMove(board, globMoveBudgetMs, globSearchThreads, &depth, &nodes);
+    }
+    mnkPlace(board, choice, SERVER_PLAYER);
+    return choice;
+}
+
+/**
+ * Close all open sockets.  
+ * @retval None.
+ */
+void closeSockets()
+{
+    //TODO: Send server shutdown
+    close(globTCPSocket);
+    close(globMulticastSocket);
+    int i;
+    for (i = 0; i < globChunkCount * GAME_CHUNK_SIZE; i++)
+    {
+        if ((*getGame(i)).active)
+        {
+            close((*getGame(i)).connectedSocket);
+        }
+    }
+}
+
+/**
+ * Attempt to start a new game, message client with game number if successful
+ * Message with error if all games are full
+ * Only this worker's games are checked for the address: SO_REUSEPORT picks the
+ * worker by hashing the connection's addresses, so a repeated client address
+ * always lands on the worker holding its earlier game.
+ * @param clientAddress - the client address
+ */
+void allocateGame(int connectedSocket, struct sockaddr_in clientAddress)
+{
+    //Check if client already has open game
+    int activeGame = findGameByAddress(clientAddress);
+
+    //Client has open game, send retry and close
+    if (activeGame != -1)
+    {
+        unsigned char messageStore[MESSAGE_FIELDS];
+        sendMessage(MOVE_COMMAND, 0, GAME_ERROR, ERROR_RETRY, -1, 0, connectedSocket, messageStore);
+        printf("--- RETRY - Client Rejected and Existing Game %d Canceled ---\n", activeGame);
+
+        closeGame(activeGame);
+        close(connectedSocket);
+        return;
+    }
+
+    //Take the next open game from the pool
+    int gameNumber = acquireGameSlot();
+
+    //All game slots were full
+    if (gameNumber == NO_GAME)
+    {
+        unsigned char messageStore[MESSAGE_FIELDS];
+        sendMessage(MOVE_COMMAND, 0, GAME_ERROR, ERROR_OUT_OF_RESOURCES, gameNumber, 0, connectedSocket, messageStore);
+        printf("--- OUT OF RESOURCES - New Client Rejected\n");
+        close(connectedSocket);
+    }
+    else if ((*globBackend).add(connectedSocket, getGame(gameNumber), EDGE_TRIGGERED) != 0)
+    {
+        //Backend could not watch the socket (select is limited to FD_SETSIZE)
+        unsigned char messageStore[MESSAGE_FIELDS];
+        sendMessage(MOVE_COMMAND, 0, GAME_ERROR, ERROR_OUT_OF_RESOURCES, gameNumber, 0, connectedSocket, messageStore);
+        printf("--- OUT OF RESOURCES - Backend rejected new client socket\n");
+        releaseGameSlot(gameNumber);
+        close(connectedSocket);
+    }
+    else
+    {
+        //initialize game and respond to client
+        struct tttGame *clientGame = getGame(gameNumber);
+        (*clientGame).active = 1;
+        (*clientGame).address = clientAddress;
+        (*clientGame).connectedSocket = connectedSocket;
+        (*clientGame).inLength = 0;
+        (*clientGame).outBuffer = NULL;
+        (*clientGame).outStart = 0;
+        (*clientGame).outLength = 0;
+        (*clientGame).outCapacity = 0;
+        (*clientGame).outLegacy = 0;
+        (*clientGame).outFrameSent = 0;
+        (*clientGame).watchingWrites = 0;
+        (*clientGame).closing = 0;
+        (*clientGame).flushQueued = 0;
+        (*clientGame).evaluationQueued = 0;
+        (*clientGame).sequenceSynced = 0;
+        (*clientGame).clientVersion = LEGACY_VERSION;
+        (*clientGame).difficulty = DIFFICULTY_PERFECT;
+        (*clientGame).blunderRate = 0;
+        (*clientGame).mnk = NULL;
+        (*clientGame).sessionIndex = NO_SESSION;
+        (*clientGame).tokenPending = 0;
+        (*clientGame).timerArmed = 0;
+        indexGame(gameNumber);
+        armTimeout(gameNumber);
+        printf("--- NEW CLIENT CONNECTED - Client %d\n", gameNumber);
+    }
+}
+
+/**
+ * Start a new game on a connection.
+ * @param  gameNumber: The game.
+ * @param  clientSequenceNum: Sequence number of the NEW_GAME request.
+ * @param  difficulty: Difficulty level the client asked for (byte 3).
+ * @param  blunderRate: Percent of server moves to play at random (byte 1).
+ * @param  rows/columns/k: The m,n,k variant (bytes 7-9); rows 0 or 3x3x3 for classic tictactoe.
+ * @retval None.
+ */
+void startGame(int gameNumber, unsigned char clientSequenceNum, int difficulty, int blunderRate, int rows, int columns, int k)
+{
+    int classic = rows == 0 || (rows == ROWS && columns == COLUMNS && k == ROWS);
+    if (difficulty < DIFFICULTY_PERFECT || difficulty > DIFFICULTY_RANDOM || blunderRate > MAX_BLUNDER_RATE ||
+        (!classic && !validMnkVariant(rows, columns, k)))
+    {
+        printf("--- ERROR - Client %d - Malformed Request: Invalid difficulty or board, Closing game\n", gameNumber);
+        unsigned char messageStore[MESSAGE_FIELDS];
+        sendMessage(MOVE_COMMAND, 0, GAME_ERROR, ERROR_MALFORMED_REQUEST, gameNumber, clientSequenceNum + 1, (*getGame(gameNumber)).connectedSocket, messageStore);
+        closeGame(gameNumber);
+        return;
+    }
+
+    //Init game space, sequence num and difficulty
+    struct tttGame *clientGame = getGame(gameNumber);
+    free((*clientGame).mnk);
+    (*clientGame).mnk = NULL;
+    if (!classic)
+    {
+        (*clientGame).mnk = createMnkBoard(rows, columns, k);
+        if ((*clientGame).mnk == NULL)
+        {
+            printf("--- ERROR - Client %d - Out of resources for board, Closing game\n", gameNumber);
+            unsigned char messageStore[MESSAGE_FIELDS];
+            sendMessage(MOVE_COMMAND, 0, GAME_ERROR, ERROR_OUT_OF_RESOURCES, gameNumber, clientSequenceNum + 1, (*clientGame).connectedSocket, messageStore);
+            closeGame(gameNumber);
+            return;
+        }
+    }
+    initSharedState(&(*getGame(gameNumber)).board);
+    (*getGame(gameNumber)).sequenceNumber = clientSequenceNum;
+    (*getGame(gameNumber)).sequenceSynced = 1;
+    (*getGame(gameNumber)).difficulty = difficulty;
+    (*getGame(gameNumber)).blunderRate = blunderRate;
+    openSession(clientGame);
+    sendMessage(MOVE_COMMAND, 0, 0, 0, gameNumber, clientSequenceNum + 1, (*getGame(gameNumber)).connectedSocket, (*getGame(gameNumber)).lastMessage);
+    saveSession(clientGame);
+    printf("--- NEW GAME - Client %d\n", gameNumber);
+}
+
+/**
+ * Find active game for client if one exist.  
+ * @param  address: The client address.
+ * @retval The index of the clients active game; -1 if no game exists.
+ */
+int findGameByAddress(struct sockaddr_in address)
+{
+    int gameNumber = globAddressBuckets[hashAddress(&address) & globAddressBucketMask];
+    while (gameNumber != NO_GAME)
+    {
+        struct tttGame *game = getGame(gameNumber);
+        if (sameAddress(&address, &(*game).address))
+        {
+            return gameNumber;
+        }
+        gameNumber = (*game).nextByAddress;
+    }
+    return -1;
+}
+
+/**
+ * Find the active game playing on a socket.
+ * @param  connectedSocket: The client socket.
+ * @retval The index of the game; -1 if no game uses the socket.
+ */
+int findGameBySocket(int connectedSocket)
+{
+    if (connectedSocket < 0 || connectedSocket >= globSocketIndexSize)
+    {
+        return -1;
+    }
+    return globSocketIndex[connectedSocket];
+}
+
+/**
+ * Allocate the socket table and the address hash buckets.
+ * Buckets are sized to the game cap so chains stay short at any load.
+ * @retval None; exit(-1) if error.
+ */
+void initGameIndexes()
+{
+    globSocketIndexSize = INITIAL_SOCKET_INDEX_SIZE;
+    globSocketIndex = malloc(globSocketIndexSize * sizeof(int));
+
+    unsigned int bucketCount = 1;
+    while (bucketCount < (unsigned int)globShardMaxGames)
+    {
+        bucketCount <<= 1;
+    }
+    globAddressBucketMask = bucketCount - 1;
+    globAddressBuckets = malloc(bucketCount * sizeof(int));
+
+    if (globSocketIndex == NULL || globAddressBuckets == NULL)
+    {
+        perror("Error: Problem allocating game indexes");
+        closeSockets();
+        exit(-1);
+    }
+
+    int i;
+    for (i = 0; i < globSocketIndexSize; i++)
+    {
+        globSocketIndex[i] = NO_GAME;
+    }
+    for (i = 0; i <= (int)globAddressBucketMask; i++)
+    {
+        globAddressBuckets[i] = NO_GAME;
+    }
+}
+
+/**
+ * Add a newly active game to the socket table and address hash.
+ * The socket table grows to fit descriptors past its end.
+ * @param  gameNumber: The game to index.
+ * @retval None; exit(-1) if error.
+ */
+void indexGame(int gameNumber)
+{
+    struct tttGame *game = getGame(gameNumber);
+    int connectedSocket = (*game).connectedSocket;
+
+    if (connectedSocket >= globSocketIndexSize)
+    {
+        int newSize = globSocketIndexSize * 2;
+        while (newSize <= connectedSocket)
+        {
+            newSize *= 2;
+        }
+        int *newIndex = realloc(globSocketIndex, newSize * sizeof(int));
+        if (newIndex == NULL)
+        {
+            perror("Error: Problem growing socket index");
+            closeSockets();
+            exit(-1);
+        }
+        int i;
+        for (i = globSocketIndexSize; i < newSize; i++)
+        {
+            newIndex[i] = NO_GAME;
+        }
+        globSocketIndex = newIndex;
+        globSocketIndexSize = newSize;
+    }
+    globSocketIndex[connectedSocket] = gameNumber;
+
+    unsigned int bucket = hashAddress(&(*game).address) & globAddressBucketMask;
+    (*game).nextByAddress = globAddressBuckets[bucket];
+    globAddressBuckets[bucket] = gameNumber;
+}
+
+/**
+ * Remove a game from the socket table and address hash before it is closed.
+ * @param  gameNumber: The game to remove.
+ * @retval None.
+ */
+void unindexGame(int gameNumber)
+{
+    struct tttGame *game = getGame(gameNumber);
+    globSocketIndex[(*game).connectedSocket] = NO_GAME;
+
+    int *link = &globAddressBuckets[hashAddress(&(*game).address) & globAddressBucketMask];
+    while (*link != NO_GAME && *link != gameNumber)
+    {
+        link = &(*getGame(*link)).nextByAddress;
+    }
+    if (*link == gameNumber)
+    {
+        *link = (*game).nextByAddress;
+    }
+}
+
+/**
+ * Hash a client IPv4 address and port.
+ * @param  *address: The client address.
+ * @retval The hash.
+ */
+unsigned int hashAddress(struct sockaddr_in *address)
+{
+    unsigned int hash = ntohl((*address).sin_addr.s_addr) ^ ((unsigned int)ntohs((*address).sin_port) << 16);
+    //Fibonacci hashing spreads nearby addresses and ports across buckets
+    hash *= 2654435761u;
+    return hash ^ (hash >> 15);
+}
+
+/**
+ * Compare two client addresses by family, IP and port.
+ * @retval 1 if equal; 0 otherwise.
+ */
+int sameAddress(struct sockaddr_in *first, struct sockaddr_in *second)
+{
+    return (*first).sin_family == (*second).sin_family &&
+           (*first).sin_addr.s_addr == (*second).sin_addr.s_addr &&
+           (*first).sin_port == (*second).sin_port;
+}
+
+/**
+ * Handle a move command by the client. Sends appropriate response and deactives game if necessary.
+ * @param  activeGame: The index of a clients active game (or -1 if none).
+ * @param  gameNumber: The gameNumber sent by client.
+ * @param  move: The move sent by client.
+ * @param  clientComplete: The complete code sent by client.
+ * @param  clientCompleteDescriptor: The complete descriptor code sent by client.
+ * @param  clientAddress: The client address.
+ * @retval None.
+ */
+void handleMove(int activeGame, int command, int clientGameNum, int move, int clientComplete, int clientCompleteDescriptor, unsigned char clientSequenceNum)
+{
+    //Check that game number matches active game
+    if (protocolGameNumber(activeGame) != clientGameNum)
+    {
+        printf("--- ERROR - Client %d - Malformed Request: Incorrect game number, Closing game\n", activeGame);
+        //Send error
+        unsigned char messageStore[MESSAGE_FIELDS];
+        sendMessage(MOVE_COMMAND, 0, GAME_ERROR, ERROR_MALFORMED_REQUEST, activeGame, clientSequenceNum + 1, (*getGame(activeGame)).connectedSocket, messageStore);
+        closeGame(activeGame);
+        return;
+    }
+
+    //Get client game
+    struct tttGame *clientGame = getGame(activeGame);
+    if (!(*clientGame).sequenceSynced)
+    {
+        //A reconnecting client keeps its own count, so its first move sets the sequence
+        (*clientGame).sequenceNumber = clientSequenceNum;
+        (*clientGame).sequenceSynced = 1;
+    }
+    else if (clientSequenceNum == (*clientGame).sequenceNumber)
+    {
+        //Retransmission: the request was already handled, so resend its reply
+        globRetransmits++;
+        printf("--- RETRANSMIT - Client %d - Resent last reply (%lld retransmits, %lld out of window)\n", activeGame, globRetransmits, globOutOfWindow);
+        resendLastMessage(clientGame);
+        return;
+    }
+    else if (clientSequenceNum != (unsigned char)((*clientGame).sequenceNumber + 2))
+    {
+        //Client sequence number is invalid
+        globOutOfWindow++;
+        unsigned char messageStore[MESSAGE_FIELDS];
+        sendMessage(MOVE_COMMAND, 0, GAME_ERROR, ERROR_MALFORMED_REQUEST, activeGame, clientSequenceNum + 1, (*clientGame).connectedSocket, messageStore);
+        printf("--- ERROR - Client %d - Malformed Request: Invalid sequence number, Closing game (%lld retransmits, %lld out of window)\n",
+               activeGame, globRetransmits, globOutOfWindow);
+        closeGame(activeGame);
+        return;
+    }
+    else
+    {
+        (*clientGame).sequenceNumber = clientSequenceNum;
+    }
+
+    //Check for error message
+    if (clientComplete == GAME_ERROR)
+    {
+        printf("--- ERROR - Client %d reported a general error, ending game\n");
+        closeGame(activeGame);
+        return;
+    }
+
+    //Catch endgame response
+    if (command == END_GAME_COMMAND)
+    {
+        printf("--- HANDSHAKE - Client %d - End Game Response\n", activeGame);
+        endSession(clientGame);
+        closeGame(activeGame);
+        return;
+    }
+
+    //Validate and place client move
+    int placed = (*clientGame).mnk != NULL ? mnkPlace((*clientGame).mnk, move, CLIENT_PLAYER) : placeMove(&(*clientGame).board, move, CLIENT_PLAYER);
+    if (placed == 0)
+    {
+        //Invalid move -- Send error and end game
+        sendMessage(MOVE_COMMAND, 0, GAME_ERROR, ERROR_MALFORMED_REQUEST, activeGame, clientSequenceNum + 1, (*clientGame).connectedSocket, (*clientGame).lastMessage);
+        printf("--- ERROR - Client %d - Malformed Request: Invalid move, Closing game\n", activeGame);
+        closeGame(activeGame);
+        return;
+    }
+
+    printf("--- MOVE - Client %d\n", activeGame);
+
+    //Classic boards are answered with the rest of the batch
+    if ((*clientGame).mnk == NULL)
+    {
+        queueEvaluation(activeGame, clientComplete, clientCompleteDescriptor, clientSequenceNum);
+        return;
+    }
+    handleMoveAfterPlaced(clientGame, clientComplete, activeGame, clientCompleteDescriptor, clientSequenceNum, clientGameNum);
+}
+
+void handleMoveAfterPlaced(struct tttGame *clientGame, int clientComplete, int activeGame, int clientCompleteDescriptor, unsigned char clientSequenceNum, int clientGameNum)
+{
+    //Check for game complete and winner
+    struct mnkBoard *mnk = (*clientGame).mnk;
+    int win = mnk != NULL ? mnkCheckWin(mnk, CLIENT_PLAYER) : checkWin(&(*clientGame).board, CLIENT_PLAYER);
+    if (!answerClientMove(clientGame, win, clientComplete, activeGame, clientCompleteDescriptor, clientSequenceNum))
+    {
+        return;
+    }
+
+    //Get and place valid server move
+    int serverMove;
+    if (mnk != NULL)
+    {
+        serverMove = placeMnkServerMove(mnk, (*clientGame).difficulty, (*clientGame).blunderRate);
+        win = mnkCheckWin(mnk, SERVER_PLAYER);
+    }
+    else
+    {
+        serverMove = placeServerMove(&(*clientGame).board, (*clientGame).difficulty, (*clientGame).blunderRate);
+        win = checkWin(&(*clientGame).board, SERVER_PLAYER);
+    }
+    sendServerMove(clientGame, activeGame, serverMove, win, clientSequenceNum);
+}
+
+/**
+ * Handle the end of a game after the client's move, or an error if the client
+ * got it wrong.
+ * @param  clientGame: The game.
+ * @param  win: checkWin's answer for the board after the client's move.
+ * @param  clientComplete/clientCompleteDescriptor: What the client claimed.
+ * @param  activeGame: The game number.
+ * @param  clientSequenceNum: The client's sequence number.
+ * @retval 1 if the game goes on and the server should move; 0 otherwise.
+ */
+int answerClientMove(struct tttGame *clientGame, int win, int clientComplete, int activeGame, int clientCompleteDescriptor, unsigned char clientSequenceNum)
+{
+    int complete = GAME_IN_PROGRESS;
+    if (win != -1)
+    {
+        complete = GAME_COMPLETE;
+    }
+
+    //Check if client claims game complete
+    if (clientComplete == GAME_COMPLETE)
+    {
+        //Handle endgame handshake
+        handleEndgame(activeGame, win, complete, clientComplete, clientCompleteDescriptor, clientSequenceNum);
+        return 0;
+    }
+    else if (complete == GAME_COMPLETE)
+    {
+        //Game is complete but client did not claim appropiately
+        //Malformed request
+        sendMessage(MOVE_COMMAND, 0, GAME_ERROR, ERROR_MALFORMED_REQUEST, activeGame, clientSequenceNum + 1, (*clientGame).connectedSocket, (*clientGame).lastMessage);
+        printf("--- ERROR - Client %d - Malformed Request: Expected game complete, Clsoing game\n", activeGame);
+        closeGame(activeGame);
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * Send the server's move, ending the game if it won or filled the board.
+ * @param  clientGame: The game.
+ * @param  activeGame: The game number.
+ * @param  serverMove: The move placed.
+ * @param  win: checkWin's answer for the board after the server's move.
+ * @param  clientSequenceNum: The client's sequence number.
+ * @retval None.
+ */
+void sendServerMove(struct tttGame *clientGame, int activeGame, int serverMove, int win, unsigned char clientSequenceNum)
+{
+    //Check game complete
+    int complete = GAME_IN_PROGRESS;
+    if (win != -1)
+    {
+        complete = GAME_COMPLETE;
+        printf("--- GAME OVER - Client %d\n", activeGame);
+    }
+
+    //Send move to client
+    sendMessage(MOVE_COMMAND, serverMove, complete, win, activeGame, clientSequenceNum + 1, (*clientGame).connectedSocket, (*clientGame).lastMessage);
+    saveSession(clientGame);
+}
+
+/**
+ * Hold a classic game's placed move until the end of the loop iteration, so
+ * every board moved on in the iteration is evaluated in one batch.
+ * @param  activeGame: The game.
+ * @param  clientComplete/clientCompleteDescriptor: What the client claimed.
+ * @param  clientSequenceNum: The client's sequence number.
+ * @retval None; exit(-1) if error.
+ */
+void queueEvaluation(int activeGame, int clientComplete, int clientCompleteDescriptor, unsigned char clientSequenceNum)
+{
+    if (globPendingMoveCount == globPendingMoveSize)
+    {
+        int newSize = globPendingMoveSize > 0 ? globPendingMoveSize * 2 : INITIAL_PENDING_MOVES_SIZE;
+        struct pendingMove *newMoves = realloc(globPendingMoves, newSize * sizeof(struct pendingMove));
+        struct tttBoard *newBoards = realloc(globPendingBoards, newSize * sizeof(struct tttBoard));
+        struct boardStatus *newStatus = realloc(globPendingStatus, newSize * sizeof(struct boardStatus));
+        if (newMoves == NULL || newBoards == NULL || newStatus == NULL)
+        {
+            perror("Error: Problem growing pending move list");
+            closeSockets();
+            exit(-1);
+        }
+        globPendingMoves = newMoves;
+        globPendingBoards = newBoards;
+        globPendingStatus = newStatus;
+        globPendingMoveSize = newSize;
+    }
+    struct pendingMove *pending = &globPendingMoves[globPendingMoveCount++];
+    (*pending).gameNumber = activeGame;
+    (*pending).clientComplete = clientComplete;
+    (*pending).clientCompleteDescriptor = clientCompleteDescriptor;
+    (*pending).clientSequenceNum = clientSequenceNum;
+    (*getGame(activeGame)).evaluationQueued = 1;
+}
+
+/**
+ * Answer every move held by queueEvaluation: evaluate the boards after the
+ * clients' moves together, place the server's moves, and evaluate those
+ * boards together before replying. A game with a held move is answered first
+ * if another message from it arrives, or it closes, in the same iteration.
+ * @retval None.
+ */
+void evaluatePendingMoves()
+{
+    int count = globPendingMoveCount;
+    globPendingMoveCount = 0;
+    if (count == 0)
+    {
+        return;
+    }
+    int i;
+    for (i = 0; i < count; i++)
+    {
+        struct tttGame *clientGame = getGame(globPendingMoves[i].gameNumber);
+        (*clientGame).evaluationQueued = 0;
+        globPendingBoards[i] = (*clientGame).board;
+    }
+    evaluateBoards(globPendingBoards, globPendingStatus, count);
+
+    //Games that go on are packed to the front for the second batch
+    int moving = 0;
+    for (i = 0; i < count; i++)
+    {
+        struct pendingMove pending = globPendingMoves[i];
+        struct tttGame *clientGame = getGame(pending.gameNumber);
+        int win = boardResult(&globPendingStatus[i], CLIENT_PLAYER);
+        if (!answerClientMove(clientGame, win, pending.clientComplete, pending.gameNumber, pending.clientCompleteDescriptor, pending.clientSequenceNum))
+        {
+            continue;
+        }
+        pending.serverMove = placeServerMove(&(*clientGame).board, (*clientGame).difficulty, (*clientGame).blunderRate);
+        globPendingMoves[moving] = pending;
+        globPendingBoards[moving] = (*clientGame).board;
+        moving++;
+    }
+    evaluateBoards(globPendingBoards, globPendingStatus, moving);
+
+    for (i = 0; i < moving; i++)
+    {
+        struct pendingMove *pending = &globPendingMoves[i];
+        int win = boardResult(&globPendingStatus[i], SERVER_PLAYER);
+        sendServerMove(getGame((*pending).gameNumber), (*pending).gameNumber, (*pending).serverMove, win, (*pending).clientSequenceNum);
+    }
+}
+
+/**
+ * Initalizes the game pool with enough chunks for the reserved games.
+ * Chunk pointers for the whole capacity are allocated up front so chunks never move.
+ * @retval None; exit(-1) if error.
+ */
+void initGamePool()
+{
+    globMaxChunks = (globShardMaxGames + GAME_CHUNK_SIZE - 1) >> GAME_CHUNK_SHIFT;
+    globReservedChunks = (globShardReservedGames + GAME_CHUNK_SIZE - 1) >> GAME_CHUNK_SHIFT;
+    if (globReservedChunks > globMaxChunks)
+    {
+        globReservedChunks = globMaxChunks;
+    }
+
+    globGameChunks = calloc(globMaxChunks, sizeof(struct gameChunk *));
+    if (globGameChunks == NULL)
+    {
+        perror("Error: Problem allocating game pool");
+        closeSockets();
+        exit(-1);
+    }
+
+    while (globChunkCount < globReservedChunks)
+    {
+        if (growGamePool() != 0)
+        {
+            perror("Error: Problem allocating reserved games");
+            closeSockets();
+            exit(-1);
+        }
+    }
+}
+
+/**
+ * Get a game by number.
+ * @param  gameNumber: The game number.
+ * @retval Pointer to the game; NULL if the number is outside the pool.
+ */
+struct tttGame *getGame(int gameNumber)
+{
+    if (gameNumber < 0 || gameNumber >= globChunkCount * GAME_CHUNK_SIZE)
+    {
+        return NULL;
+    }
+    return &(*globGameChunks[gameNumber >> GAME_CHUNK_SHIFT]).games[gameNumber & (GAME_CHUNK_SIZE - 1)];
+}
+
+/**
+ * Take an inactive game from the head of the free list, growing the pool if empty.
+ * @retval The game number; NO_GAME if the pool is at capacity.
+ */
+int acquireGameSlot()
+{
+    if (globActiveGames >= globShardMaxGames)
+    {
+        return NO_GAME;
+    }
+    if (globFreeHead == NO_GAME && growGamePool() != 0)
+    {
+        return NO_GAME;
+    }
+
+    int gameNumber = globFreeHead;
+    unlinkFreeGame(gameNumber);
+    (*globGameChunks[gameNumber >> GAME_CHUNK_SHIFT]).liveCount++;
+    globActiveGames++;
+    return gameNumber;
+}
+
+/**
+ * Return a game to the free list. Games in the top chunk go to the tail so new
+ * games fill lower chunks first, letting the top chunk drain after a load spike.
+ * @param  gameNumber: The game to release.
+ * @retval None.
+ */
+void releaseGameSlot(int gameNumber)
+{
+    int chunk = gameNumber >> GAME_CHUNK_SHIFT;
+    (*getGame(gameNumber)).active = 0;
+    (*globGameChunks[chunk]).liveCount--;
+    globActiveGames--;
+    pushFreeGame(gameNumber, chunk == globChunkCount - 1 && chunk >= globReservedChunks);
+}
+
+/**
+ * Add one chunk of inactive games to the pool.
+ * @retval 0 on success; -1 if at capacity or out of memory.
+ */
+int growGamePool()
+{
+    if (globChunkCount >= globMaxChunks)
+    {
+        return -1;
+    }
+
+    struct gameChunk *chunk = malloc(sizeof(struct gameChunk));
+    if (chunk == NULL)
+    {
+        return -1;
+    }
+    (*chunk).liveCount = 0;
+    globGameChunks[globChunkCount] = chunk;
+    globChunkCount++;
+
+    //Push in reverse so the lowest game number is handed out first
+    int i;
+    for (i = GAME_CHUNK_SIZE - 1; i >= 0; i--)
+    {
+        struct tttGame *game = &(*chunk).games[i];
+        (*game).active = 0;
+        (*game).gameNumber = ((globChunkCount - 1) << GAME_CHUNK_SHIFT) + i;
+        pushFreeGame((*game).gameNumber, 0);
+    }
+    return 0;
+}
+
+/**
+ * Free empty chunks from the top of the pool, keeping the reserved chunks.
+ * Only called between event batches, since ready events may still point into a chunk.
+ * @retval None.
+ */
+void shrinkGamePool()
+{
+    while (globChunkCount > globReservedChunks && (*globGameChunks[globChunkCount - 1]).liveCount == 0)
+    {
+        int base = (globChunkCount - 1) << GAME_CHUNK_SHIFT;
+        int i;
+        for (i = 0; i < GAME_CHUNK_SIZE; i++)
+        {
+            unlinkFreeGame(base + i);
+        }
+        free(globGameChunks[globChunkCount - 1]);
+        globGameChunks[globChunkCount - 1] = NULL;
+        globChunkCount--;
+    }
+}
+
+/**
+ * Add an inactive game to the free list.
+ * @param  gameNumber: The game to add.
+ * @param  atTail: 1 to add at the tail (used last); 0 to add at the head (used next).
+ * @retval None.
+ */
+void pushFreeGame(int gameNumber, int atTail)
+{
+    struct tttGame *game = getGame(gameNumber);
+    if (atTail)
+    {
+        (*game).prevFree = globFreeTail;
+        (*game).nextFree = NO_GAME;
+        if (globFreeTail != NO_GAME)
+        {
+            (*getGame(globFreeTail)).nextFree = gameNumber;
+        }
+        else
+        {
+            globFreeHead = gameNumber;
+        }
+        globFreeTail = gameNumber;
+    }
+    else
+    {
+        (*game).prevFree = NO_GAME;
+        (*game).nextFree = globFreeHead;
+        if (globFreeHead != NO_GAME)
+        {
+            (*getGame(globFreeHead)).prevFree = gameNumber;
+        }
+        else
+        {
+            globFreeTail = gameNumber;
+        }
+        globFreeHead = gameNumber;
+    }
+}
+
+/**
+ * Remove an inactive game from the free list.
+ * @param  gameNumber: The game to remove.
+ * @retval None.
+ */
+void unlinkFreeGame(int gameNumber)
+{
+    struct tttGame *game = getGame(gameNumber);
+    if ((*game).prevFree != NO_GAME)
+    {
+        (*getGame((*game).prevFree)).nextFree = (*game).nextFree;
+    }
+    else
+    {
+        globFreeHead = (*game).nextFree;
+    }
+    if ((*game).nextFree != NO_GAME)
+    {
+        (*getGame((*game).nextFree)).prevFree = (*game).prevFree;
+    }
+    else
+    {
+        globFreeTail = (*game).prevFree;
+    }
+}
+
+void handleEndgame(int gameNumber, int win, int complete, int clientComplete, int clientCompleteDescriptor, unsigned char clientSequenceNum)
+{
+    //Get client game
+    struct tttGame *clientGame = getGame(gameNumber);
+
+    //Check that game is actually over
+    if (complete != GAME_COMPLETE)
+    {
+        //Game not complete or client didn't set game complete byte
+        sendMessage(MOVE_COMMAND, 0, GAME_ERROR, ERROR_MALFORMED_REQUEST, gameNumber, clientSequenceNum + 1, (*clientGame).connectedSocket, (*clientGame).lastMessage);
+        printf("--- ERROR - Client %d - Malformed Request: Invalid game complete recieved, Closing game\n", gameNumber);
+        closeGame(gameNumber);
+        return;
+    }
+
+    //Check that winners match
+    if (win != clientCompleteDescriptor)
+    {
+        //Game winners do not match
+        sendMessage(MOVE_COMMAND, 0, GAME_ERROR, ERROR_MALFORMED_REQUEST, gameNumber, clientSequenceNum + 1, (*clientGame).connectedSocket, (*clientGame).lastMessage);
+        printf("--- ERROR - Client %d - Malformed Request: Mismatch endgame results, Closing game\n", gameNumber);
+        closeGame(gameNumber);
+        return;
+    }
+
+    //Endgame response
+    sendMessage(END_GAME_COMMAND, 0, complete, win, gameNumber, clientSequenceNum + 1, (*clientGame).connectedSocket, (*clientGame).lastMessage);
+    printf("--- HANDSHAKE - Client %d - End Game Sent\n", gameNumber);
+    endSession(clientGame);
+    closeGame(gameNumber);
+}
+
+/**
+ * Milliseconds on the monotonic clock.
+ * @retval The current time in milliseconds.
+ */
+long long currentTimeMs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/**
+ * Microseconds on the monotonic clock.
+ * @retval The current time in microseconds.
+ */
+long long currentTimeUs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/**
+ * Empty this worker's timing wheel and start it at the current tick.
+ * The wheel is hashed by deadline tick; TIMEOUT_TICKS is shorter than the
+ * wheel, so a game is always in the slot that fires at its deadline.
+ * @retval None.
+ */
+void initTimerWheel()
+{
+    int i;
+    for (i = 0; i < TIMER_WHEEL_SLOTS; i++)
+    {
+        globTimerSlots[i] = NO_GAME;
+    }
+    memset(globTimerOccupied, 0, sizeof(globTimerOccupied));
+    globTimerTick = currentTimeMs() / TIMER_TICK_MS;
+    globTimedGames = 0;
+}
+
+/**
+ * (Re)start a game's idle timeout, TIMEOUT seconds from now. O(1).
+ * @param  gameNumber: The game to arm.
+ * @retval None.
+ */
+void armTimeout(int gameNumber)
+{
+    struct tttGame *clientGame = getGame(gameNumber);
+    disarmTimeout(gameNumber);
+
+    (*clientGame).timerDeadline = currentTimeMs() / TIMER_TICK_MS + TIMEOUT_TICKS;
+    int slot = (*clientGame).timerDeadline & TIMER_WHEEL_MASK;
+    (*clientGame).prevTimer = NO_GAME;
+    (*clientGame).nextTimer = globTimerSlots[slot];
+    if (globTimerSlots[slot] != NO_GAME)
+    {
+        (*getGame(globTimerSlots[slot])).prevTimer = gameNumber;
+    }
+    globTimerSlots[slot] = gameNumber;
+    globTimerOccupied[slot / 64] |= (uint64_t)1 << (slot % 64);
+    (*clientGame).timerArmed = 1;
+    globTimedGames++;
+}
+
+/**
+ * Remove a game from the timing wheel if it is on it. O(1).
+ * @param  gameNumber: The game to disarm.
+ * @retval None.
+ */
+void disarmTimeout(int gameNumber)
+{
+    struct tttGame *clientGame = getGame(gameNumber);
+    if (!(*clientGame).timerArmed)
+    {
+        return;
+    }
+
+    int slot = (*clientGame).timerDeadline & TIMER_WHEEL_MASK;
+    if ((*clientGame).prevTimer != NO_GAME)
+    {
+        (*getGame((*clientGame).prevTimer)).nextTimer = (*clientGame).nextTimer;
+    }
+    else
+    {
+        globTimerSlots[slot] = (*clientGame).nextTimer;
+    }
+    if ((*clientGame).nextTimer != NO_GAME)
+    {
+        (*getGame((*clientGame).nextTimer)).prevTimer = (*clientGame).prevTimer;
+    }
+    if (globTimerSlots[slot] == NO_GAME)
+    {
+        globTimerOccupied[slot / 64] &= ~((uint64_t)1 << (slot % 64));
+    }
+    (*clientGame).timerArmed = 0;
+    globTimedGames--;
+}
+
+/**
+ * Check whether a game's idle timeout has passed.
+ * @param  *clientGame: The game to check.
+ * @retval 1 if the game has timed out; 0 otherwise.
+ */
+int checkTimeout(struct tttGame *clientGame)
+{
+    return (*clientGame).timerArmed && (*clientGame).timerDeadline <= globTimerTick;
+}
+
+/**
+ * Advance the timing wheel to the current tick. Games that timed out are sent
+ * ERROR_TIMEOUT and closed; games that were already closing are dropped.
+ * @retval None.
+ */
+void timeoutGames()
+{
+    long long nowTick = currentTimeMs() / TIMER_TICK_MS;
+
+    //After a long stall one turn of the wheel visits every slot
+    if (nowTick - globTimerTick > TIMER_WHEEL_SLOTS)
+    {
+        globTimerTick = nowTick - TIMER_WHEEL_SLOTS;
+    }
+
+    while (globTimerTick < nowTick)
+    {
+        globTimerTick++;
+        int gameNumber = globTimerSlots[globTimerTick & TIMER_WHEEL_MASK];
+        while (gameNumber != NO_GAME)
+        {
+            struct tttGame *clientGame = getGame(gameNumber);
+            int nextGame = (*clientGame).nextTimer;
+            if (checkTimeout(clientGame))
+            {
+                if ((*clientGame).closing)
+                {
+                    printf("--- TIMEOUT - Client %d - Output never drained, Closing game\n", gameNumber);
+                    closeGameNow(gameNumber);
+                }
+                else
+                {
+                    printf("--- TIMEOUT - Client %d - No message in %d seconds, Closing game\n", gameNumber, TIMEOUT);
+                    sendMessage(MOVE_COMMAND, 0, GAME_ERROR, ERROR_TIMEOUT, gameNumber, (*clientGame).sequenceNumber + 1, (*clientGame).connectedSocket, (*clientGame).lastMessage);
+                    closeGame(gameNumber);
+                }
+            }
+            gameNumber = nextGame;
+        }
+    }
+}
+
+/**
+ * Milliseconds until the earliest armed timeout, for the event loop's wait.
+ * Finds the next non-empty wheel slot from the occupancy bits.
+ * @retval Milliseconds to wait; -1 if no game is armed.
+ */
+int nextTimeoutMs()
+{
+    if (globTimedGames == 0)
+    {
+        return -1;
+    }
+
+    int start = (globTimerTick + 1) & TIMER_WHEEL_MASK;
+    int i;
+    for (i = 0; i <= TIMER_SLOT_WORDS; i++)
+    {
+        int word = ((start / 64) + i) % TIMER_SLOT_WORDS;
+        uint64_t bits = globTimerOccupied[word];
+        if (i == 0)
+        {
+            bits &= ~(uint64_t)0 << (start % 64);
+        }
+        else if (i == TIMER_SLOT_WORDS)
+        {
+            bits &= ~(~(uint64_t)0 << (start % 64));
+        }
+        if (bits != 0)
+        {
+            int slot = word * 64 + __builtin_ctzll(bits);
+            long long deadlineTick = globTimerTick + 1 + ((slot - start) & TIMER_WHEEL_MASK);
+            long long waitMs = deadlineTick * TIMER_TICK_MS - currentTimeMs();
+            return waitMs > 0 ? (int)waitMs : 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Milliseconds the event loop may wait: until the next timeout, or on worker 0
+ * until the next announcement if that comes first.
+ * @retval Milliseconds to wait, or -1 to wait for events only.
+ */
+int nextWaitMs()
+{
+    int waitMs = nextTimeoutMs();
+    if (globShardId == 0 && globAnnounceSeconds > 0)
+    {
+        long long announceMs = globNextAnnounceMs - currentTimeMs();
+        if (announceMs < 0)
+        {
+            announceMs = 0;
+        }
+        if (waitMs < 0 || announceMs < waitMs)
+        {
+            waitMs = (int)announceMs;
+        }
+    }
+    return waitMs;
+}
+
+/**
+ * Close a game once its queued replies have been written. Input from the
+ * client is ignored from now on. Safe to call with -1 or an already closed game.
+ * @param  gameNumber: The game to close.
+ * @retval None.
+ */
+void closeGame(int gameNumber)
+{
+    struct tttGame *clientGame = getGame(gameNumber);
+    if (clientGame == NULL || !(*clientGame).active)
+    {
+        return;
+    }
+    if ((*clientGame).evaluationQueued)
+    {
+        evaluatePendingMoves();
+    }
+    (*clientGame).closing = 1;
+    queueFlush(clientGame);
+
+    //Give a client that stops reading one more timeout to take its output
+    armTimeout(gameNumber);
+}
+
+/**
+ * Close a game whose output cannot be written, dropping that output. The slot
+ * is freed by flushPendingOutput at the end of the batch, not here, since the
+ * handler that queued the output may still be using the game.
+ * @param  *clientGame: The game.
+ * @retval None.
+ */
+void abortGame(struct tttGame *clientGame)
+{
+    (*clientGame).outStart = 0;
+    (*clientGame).outLength = 0;
+    (*clientGame).outFrameSent = 0;
+    (*clientGame).closing = 1;
+    queueFlush(clientGame);
+}
+
+/**
+ * Stop watching a game's socket, close it and free the game slot, dropping
+ * any unsent output. Safe to call with -1 or an already closed game.
+ * @param  gameNumber: The game to close.
+ * @retval None.
+ */
+void closeGameNow(int gameNumber)
+{
+    struct tttGame *clientGame = getGame(gameNumber);
+    if (clientGame == NULL || !(*clientGame).active)
+    {
+        return;
+    }
+    if ((*clientGame).evaluationQueued)
+    {
+        evaluatePendingMoves();
+    }
+    unindexGame(gameNumber);
+    disarmTimeout(gameNumber);
+    (*globBackend).remove((*clientGame).connectedSocket);
+    close((*clientGame).connectedSocket);
+    free((*clientGame).outBuffer);
+    (*clientGame).outBuffer = NULL;
+    free((*clientGame).mnk);
+    (*clientGame).mnk = NULL;
+    (*clientGame).flushQueued = 0;
+    releaseGameSlot(gameNumber);
+}
+
+/**
+ * Dispatch the sockets reported ready by the event backend.
+ * @param  *events: The ready sockets.
+ * @param  eventCount: Number of ready sockets.
+ * @retval None.
+ */
+void onReady(struct readyEvent *events, int eventCount)
+{
+    int i;
+    for (i = 0; i < eventCount; i++)
+    {
+        void *data = events[i].data;
+        unsigned char flags = events[i].flags;
+
+        if (data == &globTCPSocket)
+        {
+            if (flags & READY_ERROR)
+            {
+                perror("Error: Exception thrown on TCP Socket");
+                closeSockets();
+                exit(-1);
+            }
+            if (flags & READY_ACCEPT)
+            {
+                admitClient(events[i].acceptedSocket);
+                continue;
+            }
+            acceptClient();
+        }
+        else if (data == &globMulticastSocket)
+        {
+            if (flags & READY_ERROR)
+            {
+                perror("Error: Exception thrown on Multicast Socket");
+                closeSockets();
+                exit(-1);
+            }
+            handleMulticast();
+        }
+        else if (data == &globHandoffEvent)
+        {
+            //Hand off once this batch's replies are written
+            globHandoffRequested = 1;
+        }
+        else
+        {
+            struct tttGame *clientGame = data;
+            int gameNumber = (*clientGame).gameNumber;
+
+            //Game may have been closed earlier in this batch
+            if (!(*clientGame).active)
+            {
+                continue;
+            }
+            if (flags & READY_ERROR)
+            {
+                printf("--- ERROR - Client %d - Socket exception thrown, Closing game\n", gameNumber);
+                closeGameNow(gameNumber);
+                continue;
+            }
+            if ((flags & READY_WRITE) && flushOutput(clientGame) != 0)
+            {
+                continue;
+            }
+            if (flags & READY_DATA)
+            {
+                handleClientData(gameNumber, events[i].bytes, events[i].length);
+            }
+            if (flags & READY_READ)
+            {
+                handleClientReadable(gameNumber);
+            }
+        }
+    }
+}
+
+/**
+ * Read everything waiting on a game socket and handle each complete frame.
+ * Game sockets are non-blocking and edge-triggered. A frame that has only
+ * partly arrived is kept in the game until the rest comes in.
+ * @param  gameNumber: The game whose socket is readable.
+ * @retval None.
+ */
+void handleClientReadable(int gameNumber)
+{
+    struct tttGame *clientGame = getGame(gameNumber);
+    while ((*clientGame).active && !(*clientGame).closing)
+    {
+        //Start from the partial frame left by the last read
+        int length = (*clientGame).inLength;
+        memcpy(globReadBuffer, (*clientGame).inBuffer, length);
+
+        int requested = READ_BUFFER_SIZE - length;
+        int bytesRead = recv((*clientGame).connectedSocket, globReadBuffer + length, requested, TCP_FLAGS);
+        if (bytesRead < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            //Nothing left to read until the next edge
+            return;
+        }
+        if (bytesRead < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (bytesRead < 0)
+        {
+            printf("--- ERROR - Client %d - Socket exception thrown, Closing game. Error: ", gameNumber);
+            perror("");
+            closeGameNow(gameNumber);
+            return;
+        }
+        if (bytesRead == 0)
+        {
+            printf("--- ERROR - Client %d - Client socket closed unexpectedly, Closing game\n", gameNumber);
+            closeGameNow(gameNumber);
+            return;
+        }
+        if (handleClientBytes(gameNumber, length + bytesRead) != 0)
+        {
+            return;
+        }
+
+        //A short read means the socket is drained
+        if (bytesRead < requested)
+        {
+            return;
+        }
+    }
+}
+
+/**
+ * Handle bytes a completion backend has already received for a game.
+ * @param  gameNumber: The game the bytes arrived on.
+ * @param  *bytes: The bytes received.
+ * @param  length: Number of bytes; 0 if the client closed the connection.
+ * @retval None.
+ */
+void handleClientData(int gameNumber, unsigned char *bytes, int length)
+{
+    struct tttGame *clientGame = getGame(gameNumber);
+    if ((*clientGame).closing)
+    {
+        return;
+    }
+    if (length == 0)
+    {
+        printf("--- ERROR - Client %d - Client socket closed unexpectedly, Closing game\n", gameNumber);
+        closeGameNow(gameNumber);
+        return;
+    }
+
+    //Start from the partial frame left by the last delivery
+    int buffered = (*clientGame).inLength;
+    memcpy(globReadBuffer, (*clientGame).inBuffer, buffered);
+    memcpy(globReadBuffer + buffered, bytes, length);
+    handleClientBytes(gameNumber, buffered + length);
+}
+
+/**
+ * Handle every complete frame at the start of globReadBuffer in order, and
+ * keep the partial frame left at the end for the next read.
+ * @param  gameNumber: The game the bytes arrived on.
+ * @param  length: Bytes in globReadBuffer.
+ * @retval 0 if the game still takes input; -1 if it was closed or is closing.
+ */
+int handleClientBytes(int gameNumber, int length)
+{
+    struct tttGame *clientGame = getGame(gameNumber);
+
+    //Handle every complete frame in order
+    int offset = 0;
+    int frameSize = frameLength(globReadBuffer, length);
+    while (frameSize > 0 && length - offset >= frameSize)
+    {
+        handleMessage(gameNumber, globReadBuffer + offset, frameSize);
+        offset += frameSize;
+        if (!(*clientGame).active || (*clientGame).closing)
+        {
+            return -1;
+        }
+        frameSize = frameLength(globReadBuffer + offset, length - offset);
+    }
+    if (frameSize == MALFORMED_FRAME)
+    {
+        printf("--- ERROR - Client %d - Malformed Request: Invalid frame length, Closing game\n", gameNumber);
+        (*clientGame).clientVersion = COMPACT_VERSION;
+        unsigned char messageStore[MESSAGE_FIELDS];
+        sendMessage(MOVE_COMMAND, 0, GAME_ERROR, ERROR_MALFORMED_REQUEST, -1, 0, (*clientGame).connectedSocket, messageStore);
+        closeGame(gameNumber);
+        return -1;
+    }
+
+    //Keep the partial frame for the next read
+    (*clientGame).inLength = length - offset;
+    memcpy((*clientGame).inBuffer, globReadBuffer + offset, (*clientGame).inLength);
+    return 0;
+}
+
+/**
+ * Validate and handle one complete frame from a client.
+ * @param  gameNumber: The game the frame arrived on.
+ * @param  *frame: The frame.
+ * @param  length: Size of the frame.
+ * @retval None.
+ */
+void handleMessage(int gameNumber, unsigned char *frame, int length)
+{
+    //Answer a move this game sent earlier in the batch before reading the next
+    if ((*getGame(gameNumber)).evaluationQueued)
+    {
+        evaluatePendingMoves();
+    }
+
+    unsigned char messageBuffer[MESSAGE_FIELDS];
+    decodeFrame(frame, length, messageBuffer);
+
+    if (!(messageBuffer[0] >= EARLIEST_VERSION))
+    {
+        printf("--- ERROR - Client %d - Client using incompatible protocol version\n", gameNumber);
+        unsigned char messageStore[MESSAGE_FIELDS];
+        sendMessage(MOVE_COMMAND, 0, GAME_ERROR, ERROR_MALFORMED_REQUEST, -1, 0, (*getGame(gameNumber)).connectedSocket, messageStore);
+        closeGame(gameNumber);
+        return;
+    }
+
+    //Any frame counts as activity
+    armTimeout(gameNumber);
+
+    //Answer in the client's framing from now on
+    (*getGame(gameNumber)).clientVersion = messageBuffer[0];
+
+    //Debug
+    debugPacket(messageBuffer, RECEIVED, ORIGINAL);
+
+    //Find active game
+    int activeGame = gameNumber;
+
+    //Parse message from client
+    int clientVersion = messageBuffer[0];
+    int clientMove = messageBuffer[1];
+    int clientComplete = messageBuffer[2];
+    //If version 4+ get clientCompleteInfo byte
+    int clientCompleteInfo = -1;
+    if (messageBuffer[0] >= 4)
+    {
+        clientCompleteInfo = messageBuffer[3];
+    }
+    //If version 5+ get command and game bytes
+    int clientCommand = -1;
+    int clientGameNum = -1;
+    if (messageBuffer[0] >= 5)
+    {
+        clientCommand = messageBuffer[4];
+        clientGameNum = messageBuffer[5];
+    }
+    //If version 6+ get sequence number byte
+    unsigned char clientSequenceNum = 0;
+    if (clientVersion >= 6)
+    {
+        clientSequenceNum = messageBuffer[6];
+    }
+
+    //Moves past square 255 of an m,n,k board carry their high byte after the sequence number;
+    //classic clients may leave stale bytes there, so it is only read for m,n,k games
+    if (clientCommand == MOVE_COMMAND && (*getGame(gameNumber)).mnk != NULL)
+    {
+        clientMove |= messageBuffer[MOVE_HIGH_FIELD] << 8;
+    }
+
+    //Handle Command
+    if (clientCommand == NEW_GAME_COMMAND)
+    {
+        //NEW_GAME carries the difficulty in the modifier byte, the blunder rate
+        //in the move byte and an optional m,n,k variant after the sequence number
+        startGame(activeGame, clientSequenceNum, clientCompleteInfo, clientMove,
+                  messageBuffer[MNK_ROWS_FIELD], messageBuffer[MNK_COLUMNS_FIELD], messageBuffer[MNK_K_FIELD]);
+    }
+    else if (clientCommand == RECONNECT_COMMAND && (clientCompleteInfo & RECONNECT_RESUME_TOKEN) &&
+             resumeGame(activeGame, messageBuffer, clientCompleteInfo))
+    {
+        //Resumed from the session store
+    }
+    else if (clientCommand == RECONNECT_COMMAND && (clientCompleteInfo & RECONNECT_WIDE_BOARD))
+    {
+        reconnectMnkGame(activeGame, messageBuffer);
+    }
+    else if (clientCommand == RECONNECT_COMMAND)
+    {
+        unsigned char boardBytes[9];
+        int i = 0;
+        for (i = 0; i < 9; i++)
+        {
+            boardBytes[i] = messageBuffer[i + RECONNECT_BOARD_FIELD];
+        }
+
+        reconnectGame(activeGame, boardBytes);
+    }
+    else if (clientCommand == MOVE_COMMAND || clientCommand == END_GAME_COMMAND)
+    {
+        handleMove(activeGame, clientCommand, clientGameNum, clientMove, clientComplete, clientCompleteInfo, clientSequenceNum);
+    }
+    else
+    {
+        printf("--- ERROR - Client %d - Malformed Request: Incorrect game number, Closing game\n", activeGame);
+        //Send error
+        unsigned char messageStore[MESSAGE_FIELDS];
+        sendMessage(MOVE_COMMAND, 0, GAME_ERROR, ERROR_MALFORMED_REQUEST, activeGame, clientSequenceNum + 1, (*getGame(activeGame)).connectedSocket, messageStore);
+        closeGame(activeGame);
+        return;
+    }
+}
+
+/**
+ * Accept queued connections until the queue is empty, at most
+ * MAX_ACCEPTS_PER_WAKEUP per call so a connection storm cannot starve live
+ * games. The listening socket is level-triggered, so any left over are
+ * reported again on the next wait.
+ * @retval None.
+ */
+void acceptClient()
+{
+    int accepted;
+    for (accepted = 0; accepted < MAX_ACCEPTS_PER_WAKEUP; accepted++)
+    {
+        //Declare client socket
+        struct sockaddr_in clientAddress;
+        socklen_t clientAddressLength;
+        //Initialize clientAddressLength
+        clientAddressLength = sizeof(clientAddress);
+
+        //Game sockets never block the event loop
+        int connectedSocket = accept4(globTCPSocket, (struct sockaddr *)&clientAddress, &clientAddressLength, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+        if (connectedSocket == -1)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                return;
+            }
+            if (errno == EINTR || errno == ECONNABORTED)
+            {
+                continue;
+            }
+            perror("--- ERROR - Problem accepting client: ");
+            return;
+        }
+
+        //Allocate resources and start game
+        allocateGame(connectedSocket, clientAddress);
+    }
+}
+
+/**
+ * Start a game for a connection a completion backend has already accepted.
+ * @param  connectedSocket: The accepted connection.
+ * @retval None.
+ */
+void admitClient(int connectedSocket)
+{
+    struct sockaddr_in clientAddress;
+    socklen_t clientAddressLength = sizeof(clientAddress);
+    if (getpeername(connectedSocket, (struct sockaddr *)&clientAddress, &clientAddressLength) != 0)
+    {
+        perror("--- ERROR - Problem reading client address: ");
+        close(connectedSocket);
+        return;
+    }
+    allocateGame(connectedSocket, clientAddress);
+}
+
+void debugPacket(unsigned char buf[MESSAGE_FIELDS], int sentOrReceived, int repeatOrNot)
+{
+    if (DEBUG_MODE)
+    {
+        if (sentOrReceived == SENT)
+        {
+            printf("\nSENT - ");
+        }
+        else
+        {
+            printf("\nRECEIVED - ");
+        }
+        if (repeatOrNot == ORIGINAL)
+        {
+            printf("ORIGINAL\n");
+        }
+        else
+        {
+            printf("REPEAT\n");
+        }
+
+        printf("[Byte 1] Version = %d\n", buf[0]);
+        printf("[Byte 2] Position = %d\n", buf[1]);
+
+        printf("[Byte 3] Game State = %d ", buf[2]);
+        switch (buf[2])
+        {
+        case 0:
+            printf("(Game in Progress)\n");
+            switch (buf[3])
+            {
+            case 0:
+                printf("[Byte 4] Modifier = %d ", buf[3]);
+                printf("(Game in progress)\n");
+                break;
+            default:
+                printf("Unknown\n");
+            }
+            break;
+        case 1:
+            printf("(Game Complete)\n");
+            switch (buf[3])
+            {
+            case 1:
+                printf("[Byte 4] Modifier = %d ", buf[3]);
+                printf("(Draw)\n");
+                break;
+            case 2:
+                printf("[Byte 4] Modifier = %d ", buf[3]);
+                printf("(Client Win)\n");
+                break;
+            case 3:
+                printf("[Byte 4] Modifier = %d ", buf[3]);
+                printf("(Server Win)\n");
+                break;
+            default:
+                printf("Unknown\n");
+            }
+            break;
+        case 2:
+            printf("(Game Error)\n");
+            switch (buf[3])
+            {
+            case 1:
+                printf("[Byte 4] Modifier = %d ", buf[3]);
+                printf("(Out of resources)\n");
+                break;
+            case 2:
+                printf("[Byte 4] Modifier = %d ", buf[3]);
+                printf("(Malformed Request)\n");
+                break;
+            case 3:
+                printf("[Byte 4] Modifier = %d ", buf[3]);
+                printf("(Server Shutdown)\n");
+                break;
+            case 4:
+                printf("[Byte 4] Modifier = %d ", buf[3]);
+                printf("(Client game timeout)\n");
+                break;
+            case 5:
+                printf("[Byte 4] Modifier = %d ", buf[3]);
+                printf("(Try again)\n");
+                break;
+            default:
+                printf("Unknown\n");
+            }
+            break;
+        default:
+            printf("Unknown Byte\n");
+        }
+
+        printf("[Byte 5] Command = %d ", buf[4]);
+        switch (buf[4])
+        {
+        case 0:
+            printf("(New Game)\n");
+            break;
+        case 1:
+            printf("(Move)\n");
+            break;
+        case 2:
+            printf("(End Game)\n");
+            break;
+        default:
+            printf("Unknown\n");
+        }
+        printf("[Byte 6] Game Num = %d\n", buf[5]);
+        printf("[Byte 7] Sequence = %d\n", buf[6]);
+    }
+}
+
+/**
+ * Answer every discovery probe waiting on the multicast socket, without
+ * blocking. The answer carries the free game slots, active games and load
+ * next to the port, so clients can pick the least busy server. A server with
+ * no free slot stays silent, so clients taking the first answer skip it.
+ * Announcements and answers from servers on the group are ignored.
+ * @retval None; exit(-1) if error.
+ */
+void handleMulticast()
+{
+    int datagram;
+    for (datagram = 0; datagram < MAX_DATAGRAMS_PER_WAKEUP; datagram++)
+    {
+        unsigned char messageBuffer[MESSAGE_SIZE];
+        struct sockaddr_in clientAddress;
+        socklen_t clientAddressLength = sizeof(clientAddress);
+
+        int bytesRead = recvfrom(globMulticastSocket, messageBuffer, MESSAGE_SIZE, DATAGRAM_FLAGS | MSG_DONTWAIT, (struct sockaddr *)&clientAddress, &clientAddressLength);
+        if (bytesRead < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                //Drained
+                return;
+            }
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            perror("Error: Problem reading from socket");
+            closeSockets();
+            exit(-1);
+        }
+
+        if (bytesRead < 2 || messageBuffer[0] < EARLIEST_VERSION)
+        {
+            printf("--- ERROR - Multicast received using incompatible protocol version\n");
+            continue;
+        }
+
+        if (messageBuffer[1] == MULTICAST_RESPONSE || messageBuffer[1] == MULTICAST_ANNOUNCE)
+        {
+            continue;
+        }
+
+        if (messageBuffer[1] != MULTICAST_DISCOVER)
+        {
+            printf("--- ERROR - Multicast received with invalid command\n");
+            continue;
+        }
+
+        printf("--- MULTICAST - Multicast request received\n");
+
+        //Answer in the client's frame version, legacy clients read only the port
+        unsigned char responseBuffer[DISCOVERY_MESSAGE_SIZE];
+        unsigned char version = messageBuffer[0] >= COMPACT_VERSION ? COMPACT_VERSION : LEGACY_VERSION;
+        if (buildDiscovery(responseBuffer, version, MULTICAST_RESPONSE) == 0)
+        {
+            printf("--- MULTICAST - No free games, request ignored\n");
+            continue;
+        }
+
+        //Send datagram
+        if (sendto(globMulticastSocket, responseBuffer, DISCOVERY_MESSAGE_SIZE, DATAGRAM_FLAGS | MSG_DONTWAIT, (struct sockaddr *)&clientAddress, sizeof(clientAddress)) <= 0)
+        {
+            perror("Error: Problem sending multicast response");
+            continue;
+        }
+
+        printf("--- MULTICAST - Multicast response sent\n");
+    }
+}
+
+/**
+ * Fill in a discovery message: [version][command][port, 2 bytes][free game
+ * slots, 4 bytes][active games, 4 bytes][load percent], multi-byte fields in
+ * network order. Totals are summed from what every worker last published.
+ * @param  message: Buffer for the DISCOVERY_MESSAGE_SIZE bytes.
+ * @param  version: Version byte of the message.
+ * @param  command: MULTICAST_RESPONSE or MULTICAST_ANNOUNCE.
+ * @retval Free game slots in the message.
+ */
+unsigned int buildDiscovery(unsigned char message[DISCOVERY_MESSAGE_SIZE], unsigned char version, unsigned char command)
+{
+    int shardMaxGames = (globMaxActiveGames + globWorkerCount - 1) / globWorkerCount;
+    long long now = currentTimeUs();
+    unsigned int freeSlots = 0;
+    unsigned int activeGames = 0;
+    int load = 0;
+    int shard;
+    for (shard = 0; shard < globWorkerCount; shard++)
+    {
+        int games = __atomic_load_n(&globShardGames[shard], __ATOMIC_RELAXED);
+        long long idleSince = __atomic_load_n(&globShardIdleSince[shard], __ATOMIC_RELAXED);
+        activeGames += games;
+        if (games < shardMaxGames)
+        {
+            freeSlots += shardMaxGames - games;
+        }
+        if (idleSince == 0 || now - idleSince < LOAD_WINDOW_US)
+        {
+            load += __atomic_load_n(&globShardLoad[shard], __ATOMIC_RELAXED);
+        }
+    }
+
+    unsigned short port = htons(globServerPort);
+    unsigned int networkFree = htonl(freeSlots);
+    unsigned int networkActive = htonl(activeGames);
+    message[0] = version;
+    message[1] = command;
+    memcpy(&message[2], &port, 2);
+    memcpy(&message[DISCOVERY_FREE_FIELD], &networkFree, 4);
+    memcpy(&message[DISCOVERY_ACTIVE_FIELD], &networkActive, 4);
+    message[DISCOVERY_LOAD_FIELD] = load / globWorkerCount;
+    return freeSlots;
+}
+
+/**
+ * Send this server's discovery message to the whole multicast group, so
+ * clients listening there know it before they need to fail over. Called by
+ * worker 0 every globAnnounceSeconds; an announcement the socket cannot take
+ * right away is dropped.
+ * @retval None.
+ */
+void announceServer()
+{
+    struct sockaddr_in groupAddress;
+    memset(&groupAddress, 0, sizeof(groupAddress));
+    groupAddress.sin_family = AF_INET;
+    groupAddress.sin_port = htons(MULTICAST_PORT);
+    groupAddress.sin_addr.s_addr = inet_addr(MULTICAST_IP);
+
+    unsigned char announcement[DISCOVERY_MESSAGE_SIZE];
+    buildDiscovery(announcement, VERSION, MULTICAST_ANNOUNCE);
+    if (sendto(globMulticastSocket, announcement, DISCOVERY_MESSAGE_SIZE, DATAGRAM_FLAGS | MSG_DONTWAIT, (struct sockaddr *)&groupAddress, sizeof(groupAddress)) <= 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+    {
+        perror("Error: Problem sending multicast announcement");
+    }
+
+    globNextAnnounceMs = currentTimeMs() + globAnnounceSeconds * 1000LL;
+}
+
+/**
+ * Account one wait of the event loop as idle time, and publish this worker's
+ * load once LOAD_WINDOW_US has passed since the last time.
+ * @param  idleStart: Microseconds when the wait started.
+ * @param  idleEnd: Microseconds when it returned.
+ * @retval None.
+ */
+void recordLoad(long long idleStart, long long idleEnd)
+{
+    __atomic_store_n(&globShardIdleSince[globShardId], 0, __ATOMIC_RELAXED);
+    globLoadIdleUs += idleEnd - idleStart;
+
+    long long window = idleEnd - globLoadWindowStart;
+    if (window >= LOAD_WINDOW_US)
+    {
+        int load = 100 - (int)(globLoadIdleUs * 100 / window);
+        __atomic_store_n(&globShardLoad[globShardId], load < 0 ? 0 : load, __ATOMIC_RELAXED);
+        globLoadWindowStart = idleEnd;
+        globLoadIdleUs = 0;
+    }
+}
+
+void reconnectGame(int activeGame, unsigned char boardBytes[9])
+{
+    //Get tttGame
+    struct tttGame *clientGame = getGame(activeGame);
+
+    //Init game space and sequence num; a reconnect carries no difficulty, so play perfectly
+    initSharedState(&(*clientGame).board);
+    (*clientGame).sequenceNumber = 0;
+    (*clientGame).sequenceSynced = 0;
+    (*clientGame).difficulty = DIFFICULTY_PERFECT;
+    (*clientGame).blunderRate = 0;
+    free((*clientGame).mnk);
+    (*clientGame).mnk = NULL;
+    int i;
+    for (i = 0; i < 9; i++)
+    {
+        if (boardBytes[i] == 1)
+        {
+            placeMove(&(*clientGame).board, i + 1, CLIENT_PLAYER);
+        }
+        else if (boardBytes[i] == 2)
+        {
+            placeMove(&(*clientGame).board, i + 1, SERVER_PLAYER);
+        }
+        else if (boardBytes[i] != 0)
+        {
+            //Invalid board state
+            sendMessage(MOVE_COMMAND, 0, GAME_ERROR, ERROR_MALFORMED_REQUEST, activeGame, (*clientGame).sequenceNumber + 2, (*clientGame).connectedSocket, (*clientGame).lastMessage);
+            printf("--- ERROR - Client %d - Malformed Request: Invalid reconnect board state, Closing game\n", activeGame);
+            closeGame(activeGame);
+            return;
+        }
+    }
+    printf("--- NEW GAME FROM RECONNECT - Client %d\n", activeGame);
+
+    if (DEBUG_MODE)
+    {
+        print_board(&(*clientGame).board);
+    }
+    openSession(clientGame);
+
+    //Make move
+    handleMoveAfterPlaced(clientGame, GAME_IN_PROGRESS, activeGame, 0, (*getGame(activeGame)).sequenceNumber + 2, activeGame);
+
+    //Pretty sure there will be errors thown here if they try to recconnect with a final move
+}
+
+/**
+ * Resume an m,n,k game from a RECONNECT whose modifier byte is RECONNECT_WIDE_BOARD.
+ * Bytes 7-9 give the variant and the board follows from byte 10, four squares
+ * per byte, two bits each (0 empty, 1 client, 2 server), lowest bits first.
+ * @param  activeGame: The game.
+ * @param  fields[MESSAGE_FIELDS]: The decoded RECONNECT.
+ * @retval None.
+ */
+void reconnectMnkGame(int activeGame, unsigned char fields[MESSAGE_FIELDS])
+{
+    struct tttGame *clientGame = getGame(activeGame);
+    int rows = fields[MNK_ROWS_FIELD], columns = fields[MNK_COLUMNS_FIELD], k = fields[MNK_K_FIELD];
+
+    (*clientGame).sequenceNumber = 0;
+    (*clientGame).sequenceSynced = 0;
+    (*clientGame).difficulty = DIFFICULTY_PERFECT;
+    (*clientGame).blunderRate = 0;
+    free((*clientGame).mnk);
+    (*clientGame).mnk = NULL;
+    struct mnkBoard *board = validMnkVariant(rows, columns, k) ? createMnkBoard(rows, columns, k) : NULL;
+
+    int square, winning = -1;
+    for (square = 0; board != NULL && square < rows * columns; square++)
+    {
+        int cell = (fields[MNK_BOARD_FIELD + square / 4] >> (2 * (square % 4))) & 3;
+        if (cell == 1)
+        {
+            mnkPlace(board, square + 1, CLIENT_PLAYER);
+        }
+        else if (cell == 2)
+        {
+            mnkPlace(board, square + 1, SERVER_PLAYER);
+        }
+        else if (cell != 0)
+        {
+            free(board);
+            board = NULL;
+        }
+    }
+    if (board == NULL)
+    {
+        //Invalid variant or board state
+        sendMessage(MOVE_COMMAND, 0, GAME_ERROR, ERROR_MALFORMED_REQUEST, activeGame, (*clientGame).sequenceNumber + 2, (*clientGame).connectedSocket, (*clientGame).lastMessage);
+        printf("--- ERROR - Client %d - Malformed Request: Invalid reconnect board state, Closing game\n", activeGame);
+        closeGame(activeGame);
+        return;
+    }
+
+    //Wins are checked through the latest stone, so point it at any finished line
+    for (square = 0; square < rows * columns && winning == -1; square++)
+    {
+        if ((*board).cells[square] != 0 && mnkWinsAt(board, square))
+        {
+            winning = square;
+        }
+    }
+    if (winning != -1)
+    {
+        (*board).lastMove = winning;
+    }
+    (*clientGame).mnk = board;
+    printf("--- NEW %dx%d k=%d GAME FROM RECONNECT - Client %d\n", rows, columns, k, activeGame);
+    openSession(clientGame);
+
+    //Make move
+    handleMoveAfterPlaced(clientGame, GAME_IN_PROGRESS, activeGame, 0, (*clientGame).sequenceNumber + 2, activeGame);
+}
+
+/**
+ * Resume a game from a RECONNECT whose modifier has RECONNECT_RESUME_TOKEN:
+ * the token follows the board (bytes 16-23, or right after a wide board).
+ * The session store's state is authoritative; the client's board may differ
+ * from it only by the move the client was waiting on an answer for. If the
+ * server had answered it, that reply is sent again; otherwise the move is
+ * played and answered.
+ * @param  activeGame: The game.
+ * @param  fields[MESSAGE_FIELDS]: The decoded RECONNECT.
+ * @param  modifier: Its modifier byte.
+ * @retval 1 if handled; 0 if the token is unknown or expired, so the game
+ * should be rebuilt from the client's board instead.
+ */
+int resumeGame(int activeGame, unsigned char fields[MESSAGE_FIELDS], int modifier)
+{
+    struct tttGame *clientGame = getGame(activeGame);
+    int wide = modifier & RECONNECT_WIDE_BOARD;
+    int rows = wide ? fields[MNK_ROWS_FIELD] : ROWS;
+    int columns = wide ? fields[MNK_COLUMNS_FIELD] : COLUMNS;
+    int k = wide ? fields[MNK_K_FIELD] : ROWS;
+    if (wide && !validMnkVariant(rows, columns, k))
+    {
+        return 0;
+    }
+
+    int tokenField = wide ? MNK_BOARD_FIELD + (rows * columns + 3) / 4 : RECONNECT_FIELDS;
+    unsigned int index = 0, nonce = 0;
+    int i;
+    for (i = 0; i < 4; i++)
+    {
+        index = index << 8 | fields[tokenField + i];
+        nonce = nonce << 8 | fields[tokenField + 4 + i];
+    }
+    if (!restoreSession(clientGame, index, nonce))
+    {
+        printf("--- RESUME - Client %d - Unknown or expired token, using the client's board\n", activeGame);
+        return 0;
+    }
+
+    //Compare the client's board with the stored one
+    struct mnkBoard *mnk = (*clientGame).mnk;
+    int mismatched = (mnk != NULL) != (wide != 0);
+    if (mnk != NULL && ((*mnk).rows != rows || (*mnk).columns != columns || (*mnk).k != k))
+    {
+        mismatched = 1;
+    }
+    int square, clientMove = 0, answered = 0;
+    for (square = 0; !mismatched && square < rows * columns; square++)
+    {
+        int claimed = wide ? (fields[MNK_BOARD_FIELD + square / 4] >> (2 * (square % 4))) & 3 : fields[RECONNECT_BOARD_FIELD + square];
+        int held = sessionCell(clientGame, square);
+        if (claimed == 1 && held == 0 && clientMove == 0)
+        {
+            clientMove = square + 1;
+        }
+        else if (claimed == 0 && held == 2 && !answered)
+        {
+            answered = 1;
+        }
+        else if (claimed != held)
+        {
+            mismatched = 1;
+        }
+    }
+    if (mismatched || (clientMove != 0 && answered))
+    {
+        endSession(clientGame);
+        sendMessage(MOVE_COMMAND, 0, GAME_ERROR, ERROR_MALFORMED_REQUEST, activeGame, (*clientGame).sequenceNumber + 2, (*clientGame).connectedSocket, (*clientGame).lastMessage);
+        printf("--- ERROR - Client %d - Malformed Request: Board does not match resumed session, Closing game\n", activeGame);
+        closeGame(activeGame);
+        return 1;
+    }
+
+    if (clientMove == 0)
+    {
+        //The server had answered, or the client had not moved: repeat the last reply under the new game number
+        unsigned char *last = (*clientGame).lastMessage;
+        int move = last[1] | (mnk != NULL ? last[MOVE_HIGH_FIELD] << 8 : 0);
+        printf("--- RESUMED GAME - Client %d - Resent last reply\n", activeGame);
+        sendMessage(MOVE_COMMAND, move, last[2], last[3], activeGame, last[6], (*clientGame).connectedSocket, last);
+        saveSession(clientGame);
+        return 1;
+    }
+
+    //The client's move never reached the server, so play it with the sequence number it was sent with
+    unsigned char clientSequenceNum = (*clientGame).sequenceNumber + 2;
+    if ((*clientGame).sequenceSynced)
+    {
+        (*clientGame).sequenceNumber = clientSequenceNum;
+    }
+    if (mnk != NULL)
+    {
+        mnkPlace(mnk, clientMove, CLIENT_PLAYER);
+    }
+    else
+    {
+        placeMove(&(*clientGame).board, clientMove, CLIENT_PLAYER);
+    }
+    printf("--- RESUMED GAME - Client %d - Answering move %d\n", activeGame, clientMove);
+    handleMoveAfterPlaced(clientGame, GAME_IN_PROGRESS, activeGame, 0, clientSequenceNum, activeGame);
+    return 1;
+}
+
+/**
+ * Map the session store shared by every server process on the host,
+ * creating it if this is the first. Without it the server still runs, but
+ * games get no tokens and reconnects use the client's board.
+ * @retval None.
+ */
+void initSessionStore()
+{
+    size_t size = sizeof(struct sessionHeader) + (size_t)SESSION_SLOTS * sizeof(struct sessionRecord);
+    int fd = globSessionFile != NULL ? open(globSessionFile, O_RDWR | O_CREAT | O_CLOEXEC, 0600) : shm_open(globSessionName, O_RDWR | O_CREAT, 0600);
+
+    //Every process holds a shared lock on the store while it runs. One that
+    //gets it exclusively is alone, so no record can be in the middle of a write
+    int alone = fd != -1 && flock(fd, LOCK_EX | LOCK_NB) == 0;
+    struct stat status;
+    if (fd == -1 || (!alone && flock(fd, LOCK_SH) != 0) || fstat(fd, &status) == -1 ||
+        ((size_t)status.st_size < size && ftruncate(fd, size) == -1))
+    {
+        perror("Warning: Problem opening session store, reconnects will not resume sessions");
+        if (fd != -1)
+        {
+            close(fd);
+        }
+        return;
+    }
+    void *mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED)
+    {
+        perror("Warning: Problem mapping session store, reconnects will not resume sessions");
+        close(fd);
+        return;
+    }
+
+    //The first process to open the store fills in the header; the rest wait on the lock meanwhile.
+    //A process alone on a store from another version or layout, or on a file that is not a store,
+    //clears it and starts it over, since no one else can be using it
+    struct sessionHeader *header = mapping;
+    int matches = (*header).state == SESSION_STORE_READY && memcmp((*header).magic, SESSION_MAGIC, sizeof((*header).magic)) == 0 &&
+                  (*header).version == SESSION_VERSION && (*header).slotCount == SESSION_SLOTS && (*header).slotSize == sizeof(struct sessionRecord);
+    if (alone && !matches)
+    {
+        if ((*header).state != 0 || (*header).magic[0] != 0)
+        {
+            fprintf(stderr, "Warning: Session store %s is not a version %d store, clearing it.\n",
+                    globSessionFile != NULL ? globSessionFile : globSessionName, SESSION_VERSION);
+        }
+        if (ftruncate(fd, 0) == -1 || ftruncate(fd, size) == -1)
+        {
+            perror("Warning: Problem clearing session store, reconnects will not resume sessions");
+            munmap(mapping, size);
+            close(fd);
+            return;
+        }
+        memcpy((*header).magic, SESSION_MAGIC, sizeof((*header).magic));
+        (*header).version = SESSION_VERSION;
+        (*header).slotCount = SESSION_SLOTS;
+        (*header).slotSize = sizeof(struct sessionRecord);
+        (*header).state = SESSION_STORE_READY;
+    }
+    if ((*header).state != SESSION_STORE_READY || memcmp((*header).magic, SESSION_MAGIC, sizeof((*header).magic)) != 0 ||
+        (*header).version != SESSION_VERSION || (*header).slotCount != SESSION_SLOTS || (*header).slotSize != sizeof(struct sessionRecord))
+    {
+        fprintf(stderr, "Warning: Session store %s is not a version %d store, reconnects will not resume sessions.\n",
+                globSessionFile != NULL ? globSessionFile : globSessionName, SESSION_VERSION);
+        munmap(mapping, size);
+        close(fd);
+        return;
+    }
+    globSessions = (struct sessionRecord *)(header + 1);
+
+    if (alone)
+    {
+        recoverSessions(fd, globSessions);
+        flock(fd, LOCK_SH);
+    }
+    //fd stays open, holding the shared lock, until the process exits
+}
+
+/**
+ * Check every record of a store no other process has open, in one pass over
+ * the file: a record left locked was being written when its process died, so
+ * its contents cannot be trusted and it is freed. The file is read rather than
+ * the mapping so pages no session ever used are not allocated.
+ * @param  fd: The store, locked exclusively.
+ * @param  *records: The mapped records.
+ * @retval None.
+ */
+void recoverSessions(int fd, struct sessionRecord *records)
+{
+    struct sessionRecord *batch = malloc(SESSION_RECOVER_RECORDS * sizeof(struct sessionRecord));
+    if (batch == NULL)
+    {
+        perror("Warning: Problem recovering session store");
+        return;
+    }
+    long long now = sessionTimeMs();
+    globSessionsRecovered = 0;
+    globSessionsTorn = 0;
+
+    int first;
+    for (first = 0; first < SESSION_SLOTS; first += SESSION_RECOVER_RECORDS)
+    {
+        size_t length = SESSION_RECOVER_RECORDS * sizeof(struct sessionRecord);
+        off_t offset = sizeof(struct sessionHeader) + (off_t)first * sizeof(struct sessionRecord);
+        if (pread(fd, batch, length, offset) != (ssize_t)length)
+        {
+            //Fall back to reading the mapping
+            memcpy(batch, records + first, length);
+        }
+        int i;
+        for (i = 0; i < SESSION_RECOVER_RECORDS; i++)
+        {
+            if (batch[i].lock & 1)
+            {
+                records[first + i].nonce = 0;
+                records[first + i].lock = (unsigned int)(batch[i].lock + 1);
+                globSessionsTorn++;
+            }
+            else if (batch[i].nonce != 0 && batch[i].updatedMs + SESSION_EXPIRY_MS > now)
+            {
+                globSessionsRecovered++;
+            }
+        }
+    }
+    free(batch);
+}
+
+/**
+ * Milliseconds on the wall clock, for session times, which must compare
+ * across processes and across restarts of the host.
+ * @retval The current time in milliseconds.
+ */
+long long sessionTimeMs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/**
+ * Take a session record's lock, spinning briefly if another process or
+ * thread holds it. A lock still held after the spins by a process that no
+ * longer exists is taken over, and the record, which that process may have
+ * left half written, is freed. A holder's pid reused by another process
+ * keeps the record busy until a server is alone on the store and recovers it.
+ * @param  *record: The record.
+ * @retval 1 if locked; 0 if it stayed busy.
+ */
+int lockSession(struct sessionRecord *record)
+{
+    unsigned long long owner = (unsigned long long)getpid() << 32;
+    unsigned long long lock = 0;
+    int spins;
+    for (spins = 0; spins < SESSION_LOCK_SPINS; spins++)
+    {
+        lock = __atomic_load_n(&(*record).lock, __ATOMIC_RELAXED);
+        if (!(lock & 1) && __atomic_compare_exchange_n(&(*record).lock, &lock, owner | (unsigned int)(lock + 1), 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        {
+            return 1;
+        }
+        sched_yield();
+    }
+
+    //The pid is set by the same exchange that makes the lock odd, so it is always the holder's
+    pid_t holder = (pid_t)(lock >> 32);
+    if ((lock & 1) && holder > 0 && kill(holder, 0) == -1 && errno == ESRCH &&
+        __atomic_compare_exchange_n(&(*record).lock, &lock, owner | (unsigned int)(lock + 2), 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+    {
+        (*record).nonce = 0;
+        printf("--- SESSION - Took over a record lock held by process %d, which has exited; its session is lost\n", (int)holder);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Release a session record locked by lockSession, clearing the holder's pid.
+ * @param  *record: The record.
+ * @retval None.
+ */
+void unlockSession(struct sessionRecord *record)
+{
+    unsigned long long lock = __atomic_load_n(&(*record).lock, __ATOMIC_RELAXED);
+    __atomic_store_n(&(*record).lock, (unsigned int)(lock + 1), __ATOMIC_RELEASE);
+}
+
+/**
+ * Draw a nonce for a resume token from the kernel, so tokens cannot be guessed
+ * from the server's move randomness.
+ * @retval A nonzero nonce.
+ */
+unsigned int sessionNonce()
+{
+    unsigned int nonce = 0;
+    while (nonce == 0)
+    {
+        if (getrandom(&nonce, sizeof(nonce), 0) != sizeof(nonce))
+        {
+            nonce = nextRandom();
+        }
+    }
+    return nonce;
+}
+
+/**
+ * Who holds a square of a game's board, in the RECONNECT encoding.
+ * @param  *clientGame: The game.
+ * @param  square: The square, 0 based.
+ * @retval 0 empty, 1 client, 2 server.
+ */
+int sessionCell(struct tttGame *clientGame, int square)
+{
+    int player;
+    if ((*clientGame).mnk != NULL)
+    {
+        player = (*(*clientGame).mnk).cells[square];
+    }
+    else
+    {
+        player = ((*clientGame).board.client >> square) & 1 ? CLIENT_PLAYER : ((*clientGame).board.server >> square) & 1 ? SERVER_PLAYER : 0;
+    }
+    return player == CLIENT_PLAYER ? 1 : player == SERVER_PLAYER ? 2 : 0;
+}
+
+/**
+ * Copy a game's state into its session record. The caller holds the lock.
+ * @param  *record: The record.
+ * @param  *clientGame: The game.
+ * @retval None.
+ */
+void writeSession(struct sessionRecord *record, struct tttGame *clientGame)
+{
+    struct mnkBoard *mnk = (*clientGame).mnk;
+    (*record).rows = mnk != NULL ? (*mnk).rows : 0;
+    (*record).columns = mnk != NULL ? (*mnk).columns : 0;
+    (*record).k = mnk != NULL ? (*mnk).k : 0;
+    (*record).lastMove = mnk != NULL ? (*mnk).lastMove : -1;
+    (*record).sequenceNumber = (*clientGame).sequenceNumber;
+    (*record).sequenceSynced = (*clientGame).sequenceSynced;
+    (*record).difficulty = (*clientGame).difficulty;
+    (*record).blunderRate = (*clientGame).blunderRate;
+    memcpy((*record).lastMessage, (*clientGame).lastMessage, WIDE_REPLY_FIELDS);
+
+    int squares = mnk != NULL ? (*mnk).rows * (*mnk).columns : SQUARES;
+    int square;
+    memset((*record).cells, 0, (squares + 3) / 4);
+    for (square = 0; square < squares; square++)
+    {
+        (*record).cells[square / 4] |= sessionCell(clientGame, square) << (2 * (square % 4));
+    }
+    (*record).updatedMs = sessionTimeMs();
+}
+
+/**
+ * Give a game a record in the session store, from a free or expired one near
+ * a random slot, and write its state there. The token goes out with the
+ * game's next reply. A game that finds no record just has no token.
+ * @param  *clientGame: The game.
+ * @retval None.
+ */
+void openSession(struct tttGame *clientGame)
+{
+    endSession(clientGame);
+    if (globSessions == NULL)
+    {
+        return;
+    }
+    long long now = sessionTimeMs();
+    unsigned int start = nextRandom() % SESSION_SLOTS;
+    int probe;
+    for (probe = 0; probe < SESSION_PROBES; probe++)
+    {
+        int index = (start + probe) % SESSION_SLOTS;
+        struct sessionRecord *record = &globSessions[index];
+        //Checked without the lock first so busy records are skipped cheaply, then again under it
+        if (__atomic_load_n(&(*record).nonce, __ATOMIC_RELAXED) != 0 && __atomic_load_n(&(*record).updatedMs, __ATOMIC_RELAXED) + SESSION_EXPIRY_MS > now)
+        {
+            continue;
+        }
+        if (!lockSession(record))
+        {
+            continue;
+        }
+        if ((*record).nonce == 0 || (*record).updatedMs + SESSION_EXPIRY_MS <= now)
+        {
+            (*record).nonce = sessionNonce();
+            (*record).createdMs = now;
+            writeSession(record, clientGame);
+            (*clientGame).sessionIndex = index;
+            (*clientGame).sessionNonce = (*record).nonce;
+            (*clientGame).tokenPending = 1;
+            unlockSession(record);
+            return;
+        }
+        unlockSession(record);
+    }
+    printf("--- SESSION - Client %d - No free session record, game cannot be resumed\n", (*clientGame).gameNumber);
+}
+
+/**
+ * Write a game's state to its session record after a reply. If the session
+ * was resumed by another connection since, that connection owns it now and
+ * this game lets it go.
+ * @param  *clientGame: The game.
+ * @retval None.
+ */
+void saveSession(struct tttGame *clientGame)
+{
+    if ((*clientGame).sessionIndex == NO_SESSION)
+    {
+        return;
+    }
+    struct sessionRecord *record = &globSessions[(*clientGame).sessionIndex];
+    if (!lockSession(record))
+    {
+        return;
+    }
+    if ((*record).nonce == (*clientGame).sessionNonce)
+    {
+        writeSession(record, clientGame);
+    }
+    else
+    {
+        (*clientGame).sessionIndex = NO_SESSION;
+    }
+    unlockSession(record);
+}
+
+/**
+ * Free a game's session record once the game is over, unless another
+ * connection has resumed it.
+ * @param  *clientGame: The game.
+ * @retval None.
+ */
+void endSession(struct tttGame *clientGame)
+{
+    if ((*clientGame).sessionIndex == NO_SESSION)
+    {
+        return;
+    }
+    struct sessionRecord *record = &globSessions[(*clientGame).sessionIndex];
+    if (lockSession(record))
+    {
+        if ((*record).nonce == (*clientGame).sessionNonce)
+        {
+            (*record).nonce = 0;
+        }
+        unlockSession(record);
+    }
+    (*clientGame).sessionIndex = NO_SESSION;
+    (*clientGame).tokenPending = 0;
+}
+
+/**
+ * Take over the session a token names: check its nonce, give it a new one so
+ * the old token and any connection still holding it lose it, and load its
+ * state into the game. The new token goes out with the game's next reply.
+ * @param  *clientGame: The game, fresh from a RECONNECT.
+ * @param  index: Record index from the token.
+ * @param  nonce: Nonce from the token.
+ * @retval 1 if the game now holds the session; 0 if the token is unknown or expired.
+ */
+int restoreSession(struct tttGame *clientGame, unsigned int index, unsigned int nonce)
+{
+    if (globSessions == NULL || index >= SESSION_SLOTS || nonce == 0)
+    {
+        return 0;
+    }
+    if ((*clientGame).sessionIndex != (int)index)
+    {
+        endSession(clientGame);
+    }
+    struct sessionRecord *record = &globSessions[index];
+    if (!lockSession(record))
+    {
+        return 0;
+    }
+    long long now = sessionTimeMs();
+    if ((*record).nonce != nonce || (*record).updatedMs + SESSION_EXPIRY_MS <= now)
+    {
+        unlockSession(record);
+        return 0;
+    }
+    struct mnkBoard *board = NULL;
+    if ((*record).rows != 0)
+    {
+        board = createMnkBoard((*record).rows, (*record).columns, (*record).k);
+        if (board == NULL)
+        {
+            unlockSession(record);
+            return 0;
+        }
+    }
+    struct sessionRecord saved = *record;
+    (*record).nonce = sessionNonce();
+    (*record).updatedMs = now;
+    (*clientGame).sessionIndex = index;
+    (*clientGame).sessionNonce = (*record).nonce;
+    (*clientGame).tokenPending = 1;
+    unlockSession(record);
+
+    free((*clientGame).mnk);
+    (*clientGame).mnk = board;
+    initSharedState(&(*clientGame).board);
+    int squares = board != NULL ? saved.rows * saved.columns : SQUARES;
+    int square;
+    for (square = 0; square < squares; square++)
+    {
+        int cell = (saved.cells[square / 4] >> (2 * (square % 4))) & 3;
+        int player = cell == 1 ? CLIENT_PLAYER : SERVER_PLAYER;
+        if (cell == 0)
+        {
+            continue;
+        }
+        if (board != NULL)
+        {
+            mnkPlace(board, square + 1, player);
+        }
+        else
+        {
+            placeMove(&(*clientGame).board, square + 1, player);
+        }
+    }
+    if (board != NULL)
+    {
+        (*board).lastMove = saved.lastMove;
+    }
+    (*clientGame).sequenceNumber = saved.sequenceNumber;
+    (*clientGame).sequenceSynced = saved.sequenceSynced;
+    (*clientGame).difficulty = saved.difficulty;
+    (*clientGame).blunderRate = saved.blunderRate;
+    memcpy((*clientGame).lastMessage, saved.lastMessage, WIDE_REPLY_FIELDS);
+    return 1;
+}
+
+//For debug
+/**
+ * Visually print the ASCII board to the screen
+ * */
+void print_board(struct tttBoard *board)
+{
+    /*****************************************************************/
+    /* brute force print out the board and all the squares/values    */
+    /*****************************************************************/
+    char marks[SQUARES];
+    int i;
+    for (i = 0; i < SQUARES; i++)
+    {
+        if ((*board).server & (1 << i))
+            marks[i] = 'O';
+        else if ((*board).client & (1 << i))
+            marks[i] = 'X';
+        else
+            marks[i] = i + '1';
+    }
+
+    printf("\n\n\n\tCurrent TicTacToe Game\n\n");
+
+    printf("Player 1 (O)  -  Player 2 (X)\n\n\n");
+
+    printf("     |     |     \n");
+    printf("  %c  |  %c  |  %c \n", marks[0], marks[1], marks[2]);
+
+    printf("_____|_____|_____\n");
+    printf("     |     |     \n");
+
+    printf("  %c  |  %c  |  %c \n", marks[3], marks[4], marks[5]);
+
+    printf("_____|_____|_____\n");
+    printf("     |     |     \n");
+
+    printf("  %c  |  %c  |  %c \n", marks[6], marks[7], marks[8]);
+
+    printf("     |     |     \n\n");
+}
+
+/**
+ * Select the configured event backend and register the listening sockets.
+ * Listening sockets are level-triggered; game sockets are edge-triggered.
+ * @retval None; exit(-1) if error.
+ */
+void initEventBackend()
+{
+    if (globBackendType == BACKEND_SELECT)
+    {
+        globBackend = &selectBackend;
+    }
+    else if (globBackendType == BACKEND_URING)
+    {
+        globBackend = &uringBackend;
+    }
+    else
+    {
+        globBackend = &epollBackend;
+    }
+
+    int initResult = (*globBackend).init();
+
+    //io_uring depends on the running kernel, so fall back when it is missing
+    if (initResult != 0 && globBackend == &uringBackend)
+    {
+        perror("io_uring unavailable, falling back to epoll");
+        globBackend = &epollBackend;
+        initResult = (*globBackend).init();
+    }
+    if (initResult != 0)
+    {
+        perror("Error: Problem initializing event backend");
+        closeSockets();
+        exit(-1);
+    }
+
+    if ((*globBackend).add(globTCPSocket, &globTCPSocket, LEVEL_TRIGGERED) != 0 ||
+        (globShardId == 0 && (*globBackend).add(globMulticastSocket, &globMulticastSocket, LEVEL_TRIGGERED) != 0))
+    {
+        perror("Error: Problem registering listening sockets");
+        closeSockets();
+        exit(-1);
+    }
+
+    //Every worker watches for a hot restart; io_uring workers refuse them
+    if (globHandoffEvent != -1 && globBackend != &uringBackend &&
+        (*globBackend).add(globHandoffEvent, &globHandoffEvent, LEVEL_TRIGGERED) != 0)
+    {
+        perror("Error: Problem registering hot restart event");
+        closeSockets();
+        exit(-1);
+    }
+}
+
+/**
+ * Create the epoll instance.
+ * @retval 0 on success; -1 on error.
+ */
+int epollInit()
+{
+    globEpollFd = epoll_create1(EPOLL_CLOEXEC);
+    return globEpollFd == -1 ? -1 : 0;
+}
+
+/**
+ * Watch a socket for reads with epoll.
+ * @param  fd: The socket to watch.
+ * @param  data: Pointer handed back in each ready event.
+ * @param  edgeTriggered: EDGE_TRIGGERED or LEVEL_TRIGGERED.
+ * @retval 0 on success; -1 on error.
+ */
+int epollAdd(int fd, void *data, int edgeTriggered)
+{
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLRDHUP;
+    if (edgeTriggered)
+    {
+        event.events |= EPOLLET;
+    }
+    event.data.ptr = data;
+    return epoll_ctl(globEpollFd, EPOLL_CTL_ADD, fd, &event);
+}
+
+/**
+ * Stop watching a socket with epoll.
+ * @param  fd: The socket to forget.
+ * @retval 0 on success; -1 on error.
+ */
+int epollRemove(int fd)
+{
+    return epoll_ctl(globEpollFd, EPOLL_CTL_DEL, fd, NULL);
+}
+
+/**
+ * Turn write readiness reports on or off for an edge-triggered game socket.
+ * @param  fd: The game socket.
+ * @param  data: The game, handed back in ready events.
+ * @param  wantWrite: 1 while output is queued; 0 otherwise.
+ * @retval 0 on success; -1 on error.
+ */
+int epollWatchWrites(int fd, void *data, int wantWrite)
+{
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+    if (wantWrite)
+    {
+        event.events |= EPOLLOUT;
+    }
+    event.data.ptr = data;
+    return epoll_ctl(globEpollFd, EPOLL_CTL_MOD, fd, &event);
+}
+
+/**
+ * Wait for ready sockets with epoll. Cost is proportional to the ready sockets only.
+ * @param  *events: Filled with the ready sockets.
+ * @param  maxEvents: Capacity of events.
+ * @param  timeoutMs: Longest time to block.
+ * @retval Number of ready sockets; -1 on error.
+ */
+int epollWait(struct readyEvent *events, int maxEvents, int timeoutMs)
+{
+    struct epoll_event epollEvents[MAX_READY_EVENTS];
+    if (maxEvents > MAX_READY_EVENTS)
+    {
+        maxEvents = MAX_READY_EVENTS;
+    }
+
+    int readyCount = epoll_wait(globEpollFd, epollEvents, maxEvents, timeoutMs);
+    int i;
+    for (i = 0; i < readyCount; i++)
+    {
+        events[i].data = epollEvents[i].data.ptr;
+        events[i].flags = 0;
+        //Hangups are reported as reads so recv() sees the close
+        if (epollEvents[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP))
+        {
+            events[i].flags |= READY_READ;
+        }
+        if (epollEvents[i].events & EPOLLOUT)
+        {
+            events[i].flags |= READY_WRITE;
+        }
+        if (epollEvents[i].events & EPOLLERR)
+        {
+            events[i].flags |= READY_ERROR;
+        }
+    }
+    return readyCount;
+}
+
+/**
+ * Reset the select backend's watched sets.
+ * @retval 0.
+ */
+int selectInit()
+{
+    FD_ZERO(&globSelectReadSet);
+    FD_ZERO(&globSelectExceptSet);
+    FD_ZERO(&globSelectWriteSet);
+    globSelectMaxFd = -1;
+    return 0;
+}
+
+/**
+ * Watch a socket for reads and exceptions with select.
+ * select() is level-triggered only, so edgeTriggered is ignored.
+ * @param  fd: The socket to watch.
+ * @param  data: Pointer handed back in each ready event.
+ * @param  edgeTriggered: Ignored.
+ * @retval 0 on success; -1 if fd does not fit in an fd_set.
+ */
+int selectAdd(int fd, void *data, int edgeTriggered)
+{
+    if (fd < 0 || fd >= FD_SETSIZE)
+    {
+        errno = EMFILE;
+        return -1;
+    }
+    FD_SET(fd, &globSelectReadSet);
+    FD_SET(fd, &globSelectExceptSet);
+    globSelectData[fd] = data;
+    if (fd > globSelectMaxFd)
+    {
+        globSelectMaxFd = fd;
+    }
+    return 0;
+}
+
+/**
+ * Stop watching a socket with select.
+ * @param  fd: The socket to forget.
+ * @retval 0 on success; -1 if fd was never watched.
+ */
+int selectRemove(int fd)
+{
+    if (fd < 0 || fd >= FD_SETSIZE)
+    {
+        return -1;
+    }
+    FD_CLR(fd, &globSelectReadSet);
+    FD_CLR(fd, &globSelectExceptSet);
+    FD_CLR(fd, &globSelectWriteSet);
+    globSelectData[fd] = NULL;
+    while (globSelectMaxFd >= 0 && !FD_ISSET(globSelectMaxFd, &globSelectReadSet))
+    {
+        globSelectMaxFd--;
+    }
+    return 0;
+}
+
+/**
+ * Turn write readiness reports on or off for a socket watched by select.
+ * @param  fd: The socket.
+ * @param  data: Unused; the data given to selectAdd is kept.
+ * @param  wantWrite: 1 while output is queued; 0 otherwise.
+ * @retval 0 on success; -1 if fd does not fit in an fd_set.
+ */
+int selectWatchWrites(int fd, void *data, int wantWrite)
+{
+    if (fd < 0 || fd >= FD_SETSIZE)
+    {
+        return -1;
+    }
+    if (wantWrite)
+    {
+        FD_SET(fd, &globSelectWriteSet);
+    }
+    else
+    {
+        FD_CLR(fd, &globSelectWriteSet);
+    }
+    return 0;
+}
+
+/**
+ * Wait for ready sockets with select. Scans every descriptor up to the highest watched one.
+ * @param  *events: Filled with the ready sockets.
+ * @param  maxEvents: Capacity of events.
+ * @param  timeoutMs: Longest time to block.
+ * @retval Number of ready sockets; -1 on error.
+ */
+int selectWait(struct readyEvent *events, int maxEvents, int timeoutMs)
+{
+    //select() overwrites the sets it is given
+    fd_set readSet = globSelectReadSet;
+    fd_set exceptSet = globSelectExceptSet;
+    fd_set writeSet = globSelectWriteSet;
+
+    //Negative timeout blocks until something is ready
+    struct timeval tv;
+    tv.tv_sec = timeoutMs / 1000;
+    tv.tv_usec = (timeoutMs % 1000) * 1000;
+
+    int selectResult = select(globSelectMaxFd + 1, &readSet, &writeSet, &exceptSet, timeoutMs < 0 ? NULL : &tv);
+    if (selectResult <= 0)
+    {
+        return selectResult;
+    }
+
+    int readyCount = 0;
+    int fd;
+    for (fd = 0; fd <= globSelectMaxFd && readyCount < maxEvents; fd++)
+    {
+        unsigned char flags = 0;
+        if (FD_ISSET(fd, &readSet))
+        {
+            flags |= READY_READ;
+        }
+        if (FD_ISSET(fd, &writeSet))
+        {
+            flags |= READY_WRITE;
+        }
+        if (FD_ISSET(fd, &exceptSet))
+        {
+            flags |= READY_ERROR;
+        }
+        if (flags)
+        {
+            events[readyCount].data = globSelectData[fd];
+            events[readyCount].flags = flags;
+            readyCount++;
+        }
+    }
+    return readyCount;
+}
+
+/**
+ * Write game output straight to the socket, for the readiness backends.
+ * @param  fd: The game socket.
+ * @param  data: The game (unused).
+ * @param  *bytes: The output.
+ * @param  length: Number of bytes.
+ * @retval Bytes written; -1 on error.
+ */
+int directSend(int fd, void *data, unsigned char *bytes, int length)
+{
+    return send(fd, bytes, length, TCP_FLAGS | MSG_NOSIGNAL);
+}
+
+/**
+ * Set up an io_uring instance with raw syscalls and register a ring of
+ * provided buffers that multishot receives fill.
+ * @retval 0 on success; -1 if the kernel lacks a needed io_uring feature.
+ */
+int uringInit()
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = URING_CQ_ENTRIES;
+
+    globUringFd = syscall(__NR_io_uring_setup, URING_SQ_ENTRIES, &params);
+    if (globUringFd < 0)
+    {
+        return -1;
+    }
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_EXT_ARG) || !(params.features & IORING_FEAT_NODROP))
+    {
+        close(globUringFd);
+        errno = ENOSYS;
+        return -1;
+    }
+
+    //Map the submission and completion rings (one mapping) and the SQE array
+    size_t sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    size_t cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    size_t ringSize = sqRingSize > cqRingSize ? sqRingSize : cqRingSize;
+    unsigned char *ring = mmap(NULL, ringSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, globUringFd, IORING_OFF_SQ_RING);
+    globUringSqes = mmap(NULL, params.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, globUringFd, IORING_OFF_SQES);
+    if (ring == MAP_FAILED || globUringSqes == MAP_FAILED)
+    {
+        close(globUringFd);
+        return -1;
+    }
+    globUringSqHead = (unsigned int *)(ring + params.sq_off.head);
+    globUringSqTail = (unsigned int *)(ring + params.sq_off.tail);
+    globUringSqMask = *(unsigned int *)(ring + params.sq_off.ring_mask);
+    globUringSqEntries = params.sq_entries;
+    globUringSqLocalTail = *globUringSqTail;
+    globUringCqHead = (unsigned int *)(ring + params.cq_off.head);
+    globUringCqTail = (unsigned int *)(ring + params.cq_off.tail);
+    globUringCqMask = *(unsigned int *)(ring + params.cq_off.ring_mask);
+    globUringCqes = (struct io_uring_cqe *)(ring + params.cq_off.cqes);
+
+    //SQE slots are used in order, so the index array never changes
+    unsigned int *sqArray = (unsigned int *)(ring + params.sq_off.array);
+    unsigned int i;
+    for (i = 0; i < params.sq_entries; i++)
+    {
+        sqArray[i] = i;
+    }
+
+    //Receive buffers the kernel picks from, returned after each batch is handled
+    globUringBufferRing = mmap(NULL, URING_BUFFER_COUNT * sizeof(struct io_uring_buf), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    globUringBuffers = malloc(URING_BUFFER_COUNT * URING_BUFFER_SIZE);
+    if (globUringBufferRing == MAP_FAILED || globUringBuffers == NULL)
+    {
+        close(globUringFd);
+        return -1;
+    }
+    struct io_uring_buf_reg bufferRegistration;
+    memset(&bufferRegistration, 0, sizeof(bufferRegistration));
+    bufferRegistration.ring_addr = (uint64_t)(uintptr_t)globUringBufferRing;
+    bufferRegistration.ring_entries = URING_BUFFER_COUNT;
+    bufferRegistration.bgid = URING_BUFFER_GROUP;
+    if (syscall(__NR_io_uring_register, globUringFd, IORING_REGISTER_PBUF_RING, &bufferRegistration, 1) != 0)
+    {
+        close(globUringFd);
+        return -1;
+    }
+    globUringBufferTail = 0;
+    int bufferId;
+    for (bufferId = 0; bufferId < URING_BUFFER_COUNT; bufferId++)
+    {
+        uringProvideBuffer(bufferId);
+    }
+    __atomic_store_n(&(*globUringBufferRing).tail, globUringBufferTail, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/**
+ * Keep a request armed on a socket: multishot accept for the listening
+ * socket, multishot receive into provided buffers for game sockets, and a
+ * one-shot poll, re-armed after each report, for any other socket.
+ * @param  fd: The socket to watch.
+ * @param  data: Pointer handed back in ready events.
+ * @param  edgeTriggered: EDGE_TRIGGERED for game sockets.
+ * @retval 0 on success; -1 on error.
+ */
+int uringAdd(int fd, void *data, int edgeTriggered)
+{
+    struct uringSocket *entry = uringSocketFor(fd);
+    if (entry == NULL)
+    {
+        return -1;
+    }
+    (*entry).data = data;
+    (*entry).sending = 0;
+    (*entry).wantWrite = 0;
+    if (data == &globTCPSocket)
+    {
+        (*entry).op = URING_OP_ACCEPT;
+    }
+    else if (edgeTriggered)
+    {
+        (*entry).op = URING_OP_RECV;
+    }
+    else
+    {
+        (*entry).op = URING_OP_POLL;
+    }
+    uringArm(fd);
+    return 0;
+}
+
+/**
+ * Cancel the request armed on a socket. Completions still in flight for it
+ * carry the old generation and are dropped; a final send still completes,
+ * since the kernel holds the socket open until it does.
+ * @param  fd: The socket to forget.
+ * @retval 0 on success; -1 on error.
+ */
+int uringRemove(int fd)
+{
+    struct uringSocket *entry = uringSocketFor(fd);
+    if (entry == NULL)
+    {
+        return -1;
+    }
+    struct io_uring_sqe *sqe = uringGetSqe();
+    (*sqe).opcode = IORING_OP_ASYNC_CANCEL;
+    (*sqe).fd = -1;
+    (*sqe).addr = ((uint64_t)(*entry).op << URING_OP_SHIFT) | ((uint64_t)((*entry).generation & URING_GENERATION_MASK) << URING_GENERATION_SHIFT) | (uint32_t)fd;
+    (*sqe).user_data = (uint64_t)URING_OP_CANCEL << URING_OP_SHIFT;
+
+    (*entry).generation++;
+    (*entry).data = NULL;
+    (*entry).sending = 0;
+    (*entry).wantWrite = 0;
+
+    //Requests name the fd, so they must reach the kernel before the caller closes it
+    return uringSubmit() < 0 ? -1 : 0;
+}
+
+/**
+ * Ask for a READY_WRITE report once the send in flight on a game socket completes.
+ * @param  fd: The game socket.
+ * @param  data: The game (unused).
+ * @param  wantWrite: 1 while output is queued; 0 otherwise.
+ * @retval 0 on success; -1 on error.
+ */
+int uringWatchWrites(int fd, void *data, int wantWrite)
+{
+    struct uringSocket *entry = uringSocketFor(fd);
+    if (entry == NULL)
+    {
+        return -1;
+    }
+    (*entry).wantWrite = wantWrite;
+    return 0;
+}
+
+/**
+ * Queue a send of game output. The bytes are copied, so all of them are taken
+ * at once; they are submitted with the next wait. One send is in flight per
+ * socket, so further output waits for READY_WRITE.
+ * @param  fd: The game socket.
+ * @param  data: The game (unused).
+ * @param  *bytes: The output.
+ * @param  length: Number of bytes.
+ * @retval length; -1 with errno EAGAIN while a send is in flight, or ENOMEM.
+ */
+int uringSend(int fd, void *data, unsigned char *bytes, int length)
+{
+    struct uringSocket *entry = uringSocketFor(fd);
+    if (entry == NULL)
+    {
+        return -1;
+    }
+    if ((*entry).sending)
+    {
+        errno = EAGAIN;
+        return -1;
+    }
+
+    //Take a send record, growing the table when all are in flight
+    if (globUringFreeSend == NO_SEND)
+    {
+        int newSize = globUringSendsSize > 0 ? globUringSendsSize * 2 : INITIAL_PENDING_FLUSH_SIZE;
+        struct uringSend *newSends = realloc(globUringSends, newSize * sizeof(struct uringSend));
+        if (newSends == NULL)
+        {
+            errno = ENOMEM;
+            return -1;
+        }
+        int i;
+        for (i = globUringSendsSize; i < newSize; i++)
+        {
+            newSends[i].bytes = NULL;
+            newSends[i].capacity = 0;
+            newSends[i].nextFree = i + 1 < newSize ? i + 1 : NO_SEND;
+        }
+        globUringSends = newSends;
+        globUringFreeSend = globUringSendsSize;
+        globUringSendsSize = newSize;
+    }
+    int sendIndex = globUringFreeSend;
+    struct uringSend *record = &globUringSends[sendIndex];
+    if ((*record).capacity < length)
+    {
+        unsigned char *newBytes = realloc((*record).bytes, length);
+        if (newBytes == NULL)
+        {
+            errno = ENOMEM;
+            return -1;
+        }
+        (*record).bytes = newBytes;
+        (*record).capacity = length;
+    }
+    globUringFreeSend = (*record).nextFree;
+    memcpy((*record).bytes, bytes, length);
+    (*record).length = length;
+    (*record).fd = fd;
+    (*record).generation = (*entry).generation;
+
+    //MSG_WAITALL makes the kernel finish short sends itself
+    struct io_uring_sqe *sqe = uringGetSqe();
+    (*sqe).opcode = IORING_OP_SEND;
+    (*sqe).fd = fd;
+    (*sqe).addr = (uint64_t)(uintptr_t)(*record).bytes;
+    (*sqe).len = length;
+    (*sqe).msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+    (*sqe).user_data = ((uint64_t)URING_OP_SEND << URING_OP_SHIFT) | (uint32_t)sendIndex;
+    (*entry).sending = 1;
+    return length;
+}
+
+/**
+ * Submit queued requests and wait for completions in a single io_uring_enter,
+ * then turn completions into ready events. Receive buffers handed out by the
+ * previous call are returned to the kernel first.
+ * @param  *events: Filled with the ready sockets.
+ * @param  maxEvents: Capacity of events.
+ * @param  timeoutMs: Longest time to block; negative to block until a completion.
+ * @retval Number of ready events; -1 on error.
+ */
+int uringWait(struct readyEvent *events, int maxEvents, int timeoutMs)
+{
+    //Give back the buffers the last batch was handled from
+    int i;
+    for (i = 0; i < globUringRecycleCount; i++)
+    {
+        uringProvideBuffer(globUringRecycle[i]);
+    }
+    if (globUringRecycleCount > 0)
+    {
+        __atomic_store_n(&(*globUringBufferRing).tail, globUringBufferTail, __ATOMIC_RELEASE);
+        globUringRecycleCount = 0;
+    }
+
+    unsigned int head = *globUringCqHead;
+    if (head == __atomic_load_n(globUringCqTail, __ATOMIC_ACQUIRE))
+    {
+        //Nothing completed yet, so submit and block in one call
+        struct __kernel_timespec timeout;
+        struct io_uring_getevents_arg waitArg;
+        memset(&waitArg, 0, sizeof(waitArg));
+        if (timeoutMs >= 0)
+        {
+            timeout.tv_sec = timeoutMs / 1000;
+            timeout.tv_nsec = (long long)(timeoutMs % 1000) * 1000000;
+            waitArg.ts = (uint64_t)(uintptr_t)&timeout;
+        }
+        __atomic_store_n(globUringSqTail, globUringSqLocalTail, __ATOMIC_RELEASE);
+        unsigned int toSubmit = globUringSqLocalTail - __atomic_load_n(globUringSqHead, __ATOMIC_ACQUIRE);
+        if (uringEnter(toSubmit, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &waitArg, sizeof(waitArg)) < 0 && errno != ETIME)
+        {
+            return -1;
+        }
+    }
+    else if (uringSubmit() < 0)
+    {
+        return -1;
+    }
+
+    //Turn completions into ready events; any left over wait for the next call
+    int readyCount = 0;
+    unsigned int tail = __atomic_load_n(globUringCqTail, __ATOMIC_ACQUIRE);
+    while (head != tail && readyCount < maxEvents)
+    {
+        readyCount += uringComplete(&globUringCqes[head & globUringCqMask], &events[readyCount]);
+        head++;
+    }
+    __atomic_store_n(globUringCqHead, head, __ATOMIC_RELEASE);
+    return readyCount;
+}
+
+/**
+ * Call io_uring_enter on this worker's ring.
+ * @retval Result of io_uring_enter; -1 with errno on error.
+ */
+int uringEnter(unsigned int toSubmit, unsigned int minComplete, unsigned int flags, void *arg, size_t argSize)
+{
+    return syscall(__NR_io_uring_enter, globUringFd, toSubmit, minComplete, flags, arg, argSize);
+}
+
+/**
+ * Take the next free submission queue entry, submitting first if the queue is full.
+ * @retval A zeroed SQE, submitted with the next wait.
+ */
+struct io_uring_sqe *uringGetSqe()
+{
+    if (globUringSqLocalTail - __atomic_load_n(globUringSqHead, __ATOMIC_ACQUIRE) >= globUringSqEntries)
+    {
+        uringSubmit();
+    }
+    struct io_uring_sqe *sqe = &globUringSqes[globUringSqLocalTail & globUringSqMask];
+    memset(sqe, 0, sizeof(*sqe));
+    globUringSqLocalTail++;
+    return sqe;
+}
+
+/**
+ * Submit queued requests without waiting.
+ * @retval Number submitted; -1 on error.
+ */
+int uringSubmit()
+{
+    __atomic_store_n(globUringSqTail, globUringSqLocalTail, __ATOMIC_RELEASE);
+    unsigned int toSubmit = globUringSqLocalTail - __atomic_load_n(globUringSqHead, __ATOMIC_ACQUIRE);
+    if (toSubmit == 0)
+    {
+        return 0;
+    }
+    int submitted;
+    do
+    {
+        submitted = uringEnter(toSubmit, 0, 0, NULL, 0);
+    } while (submitted < 0 && errno == EINTR);
+    return submitted;
+}
+
+/**
+ * Backend state for a socket, growing the table to fit fd.
+ * @param  fd: The socket.
+ * @retval The state; NULL if out of memory.
+ */
+struct uringSocket *uringSocketFor(int fd)
+{
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    if (fd >= globUringSocketsSize)
+    {
+        int newSize = globUringSocketsSize > 0 ? globUringSocketsSize * 2 : INITIAL_SOCKET_INDEX_SIZE;
+        while (newSize <= fd)
+        {
+            newSize *= 2;
+        }
+        struct uringSocket *newSockets = realloc(globUringSockets, newSize * sizeof(struct uringSocket));
+        if (newSockets == NULL)
+        {
+            return NULL;
+        }
+        memset(newSockets + globUringSocketsSize, 0, (newSize - globUringSocketsSize) * sizeof(struct uringSocket));
+        globUringSockets = newSockets;
+        globUringSocketsSize = newSize;
+    }
+    return &globUringSockets[fd];
+}
+
+/**
+ * Queue the request kept armed on a socket. user_data carries the request
+ * type, the socket's generation and the fd.
+ * @param  fd: The socket.
+ * @retval None.
+ */
+void uringArm(int fd)
+{
+    struct uringSocket *entry = &globUringSockets[fd];
+    struct io_uring_sqe *sqe = uringGetSqe();
+    (*sqe).fd = fd;
+    (*sqe).user_data = ((uint64_t)(*entry).op << URING_OP_SHIFT) | ((uint64_t)((*entry).generation & URING_GENERATION_MASK) << URING_GENERATION_SHIFT) | (uint32_t)fd;
+    if ((*entry).op == URING_OP_ACCEPT)
+    {
+        (*sqe).opcode = IORING_OP_ACCEPT;
+        (*sqe).ioprio = IORING_ACCEPT_MULTISHOT;
+        (*sqe).accept_flags = SOCK_CLOEXEC;
+    }
+    else if ((*entry).op == URING_OP_RECV)
+    {
+        (*sqe).opcode = IORING_OP_RECV;
+        (*sqe).ioprio = IORING_RECV_MULTISHOT;
+        (*sqe).flags = IOSQE_BUFFER_SELECT;
+        (*sqe).buf_group = URING_BUFFER_GROUP;
+    }
+    else
+    {
+        (*sqe).opcode = IORING_OP_POLL_ADD;
+        (*sqe).poll32_events = POLLIN;
+    }
+}
+
+/**
+ * Put a receive buffer back on the provided buffer ring. The new tail is
+ * published by the caller.
+ * @param  bufferId: The buffer.
+ * @retval None.
+ */
+void uringProvideBuffer(int bufferId)
+{
+    struct io_uring_buf *buffer = &(*globUringBufferRing).bufs[globUringBufferTail & (URING_BUFFER_COUNT - 1)];
+    (*buffer).addr = (uint64_t)(uintptr_t)(globUringBuffers + bufferId * URING_BUFFER_SIZE);
+    (*buffer).len = URING_BUFFER_SIZE;
+    (*buffer).bid = bufferId;
+    globUringBufferTail++;
+}
+
+/**
+ * Turn one completion into a ready event and re-arm requests that stopped.
+ * @param  *cqe: The completion.
+ * @param  *event: Filled if the completion is reported.
+ * @retval 1 if event was filled; 0 otherwise.
+ */
+int uringComplete(struct io_uring_cqe *cqe, struct readyEvent *event)
+{
+    int op = (*cqe).user_data >> URING_OP_SHIFT;
+    int generation = ((*cqe).user_data >> URING_GENERATION_SHIFT) & URING_GENERATION_MASK;
+    int index = (uint32_t)(*cqe).user_data;
+    int result = (*cqe).res;
+    int more = (*cqe).flags & IORING_CQE_F_MORE;
+
+    if (op == URING_OP_CANCEL)
+    {
+        return 0;
+    }
+
+    if (op == URING_OP_SEND)
+    {
+        struct uringSend *record = &globUringSends[index];
+        int fd = (*record).fd;
+        int length = (*record).length;
+        generation = (*record).generation;
+        (*record).nextFree = globUringFreeSend;
+        globUringFreeSend = index;
+
+        struct uringSocket *entry = &globUringSockets[fd];
+        if ((*entry).generation != generation)
+        {
+            return 0;
+        }
+        (*entry).sending = 0;
+        (*event).data = (*entry).data;
+        if (result < length)
+        {
+            (*event).flags = READY_ERROR;
+            return 1;
+        }
+        if ((*entry).wantWrite)
+        {
+            (*event).flags = READY_WRITE;
+            return 1;
+        }
+        return 0;
+    }
+
+    //Receives on a socket that has since been removed still used a buffer
+    struct uringSocket *entry = &globUringSockets[index];
+    int bufferId = ((*cqe).flags & IORING_CQE_F_BUFFER) ? (int)((*cqe).flags >> IORING_CQE_BUFFER_SHIFT) : -1;
+    if (bufferId >= 0)
+    {
+        globUringRecycle[globUringRecycleCount++] = bufferId;
+    }
+    if (((*entry).generation & URING_GENERATION_MASK) != generation)
+    {
+        return 0;
+    }
+
+    (*event).data = (*entry).data;
+    if (op == URING_OP_ACCEPT)
+    {
+        if (!more)
+        {
+            uringArm(index);
+        }
+        if (result < 0)
+        {
+            return 0;
+        }
+        (*event).flags = READY_ACCEPT;
+        (*event).acceptedSocket = result;
+        return 1;
+    }
+    if (op == URING_OP_POLL)
+    {
+        uringArm(index);
+        if (result < 0)
+        {
+            return 0;
+        }
+        (*event).flags = (result & POLLERR) ? READY_ERROR : READY_READ;
+        return 1;
+    }
+
+    //Multishot receive
+    if (result > 0)
+    {
+        if (!more)
+        {
+            uringArm(index);
+        }
+        (*event).flags = READY_DATA;
+        (*event).bytes = globUringBuffers + bufferId * URING_BUFFER_SIZE;
+        (*event).length = result;
+        return 1;
+    }
+    if (result == 0)
+    {
+        (*event).flags = READY_DATA;
+        (*event).bytes = NULL;
+        (*event).length = 0;
+        return 1;
+    }
+    if (result == -ENOBUFS)
+    {
+        //Every buffer is out; they come back at the next wait
+        uringArm(index);
+        return 0;
+    }
+    if (result == -ECANCELED)
+    {
+        return 0;
+    }
+    (*event).flags = READY_ERROR;
+    return 1;
+}
+
+/**
+ * Run the named benchmark and print its results.
+ * backends: The same game load against a server on each event backend.
+ * storm: BENCH_STORM_CLIENTS clients reconnecting at once, as after a server failover.
+ * moves: Server move selection at each difficulty against the first free square scan.
+ * symmetry: Memory and lookup time of the canonical position table against a table of every position.
+ * parallel: Nodes per second of a large-board search at 1 to BENCH_SEARCH_THREADS threads.
+ * evaluate: Boards per second through each batch evaluation kernel the CPU supports.
+ * replies: Cost of queueing and sending a reply, rebuilt per reply against written in place.
+ * @param  *name: The benchmark.
+ * @retval None; exit(-1) if error.
+ */
+void runBenchmark(char *name)
+{
+    if (strcmp(name, "backends") == 0)
+    {
+        benchBackends();
+    }
+    else if (strcmp(name, "storm") == 0)
+    {
+        benchStorm();
+    }
+    else if (strcmp(name, "moves") == 0)
+    {
+        benchMoves();
+    }
+    else if (strcmp(name, "symmetry") == 0)
+    {
+        benchSymmetry();
+    }
+    else if (strcmp(name, "parallel") == 0)
+    {
+        benchParallel();
+    }
+    else if (strcmp(name, "evaluate") == 0)
+    {
+        benchEvaluate();
+    }
+    else if (strcmp(name, "replies") == 0)
+    {
+        benchReplies();
+    }
+    else
+    {
+        fprintf(stderr, "Error: Unknown benchmark %s. Consult readme for usage.\n", name);
+        exit(-1);
+    }
+}
+
+/**
+ * Play BENCH_GAMES games, BENCH_CONNECTIONS at a time, against a server on
+ * each backend and compare wall time and the server's CPU time per game.
+ * @retval None.
+ */
+void benchBackends()
+{
+    int backends[] = {BACKEND_SELECT, BACKEND_EPOLL, BACKEND_URING};
+    printf("%-9s %8s %9s %11s %14s %14s\n", "backend", "games", "seconds", "games/s", "user us/game", "sys us/game");
+    int i;
+    for (i = 0; i < 3; i++)
+    {
+        double seconds;
+        struct rusage usage;
+        int games = benchServer(backends[i], BENCH_GAMES, BENCH_CONNECTIONS, &seconds, &usage);
+        double userUs = usage.ru_utime.tv_sec * 1e6 + usage.ru_utime.tv_usec;
+        double systemUs = usage.ru_stime.tv_sec * 1e6 + usage.ru_stime.tv_usec;
+        printf("%-9s %8d %9.2f %11.0f %14.1f %14.1f\n", globBackendNames[backends[i]], games, seconds,
+               games / seconds, games > 0 ? userUs / games : 0, games > 0 ? systemUs / games : 0);
+    }
+}
+
+/**
+ * Start a server on a backend, play games against it and stop it.
+ * @param  backendType: The backend the server uses.
+ * @param  games: Games to play.
+ * @param  connections: Games in progress at once.
+ * @param  *seconds: Set to the wall time taken.
+ * @param  *usage: Set to the server's resource usage.
+ * @retval Games completed without error.
+ */
+int benchServer(int backendType, int games, int connections, double *seconds, struct rusage *usage)
+{
+    pid_t server = benchStartServer(backendType);
+
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    struct benchClient *clients = malloc(connections * sizeof(struct benchClient));
+    if (epollFd == -1 || clients == NULL)
+    {
+        perror("Error: Problem starting benchmark clients");
+        benchStopServer(server, usage);
+        exit(-1);
+    }
+
+    long long startMs = currentTimeMs();
+    int started = 0;
+    int finished = 0;
+    int completed = 0;
+    int i;
+    for (i = 0; i < connections && started < games; i++, started++)
+    {
+        if (benchConnect(&clients[i], epollFd, 0) != 0)
+        {
+            close(clients[i].connectedSocket);
+            finished++;
+        }
+    }
+
+    struct epoll_event events[MAX_READY_EVENTS];
+    while (finished < started)
+    {
+        int readyCount = epoll_wait(epollFd, events, MAX_READY_EVENTS, BENCH_IDLE_MS);
+        if (readyCount == 0)
+        {
+            fprintf(stderr, "Benchmark stalled with %d games unfinished\n", started - finished);
+            break;
+        }
+        for (i = 0; i < readyCount; i++)
+        {
+            struct benchClient *client = events[i].data.ptr;
+            int result = benchReadable(client);
+            if (result == 0)
+            {
+                continue;
+            }
+
+            //Game over: reuse the slot for the next game
+            finished++;
+            completed += result > 0;
+            close((*client).connectedSocket);
+            if (started < games)
+            {
+                started++;
+                if (benchConnect(client, epollFd, 0) != 0)
+                {
+                    close((*client).connectedSocket);
+                    finished++;
+                }
+            }
+        }
+    }
+    *seconds = (currentTimeMs() - startMs) / 1000.0;
+
+    close(epollFd);
+    free(clients);
+    benchStopServer(server, usage);
+    return completed;
+}
+
+/**
+ * Reconnect BENCH_STORM_CLIENTS clients at once to a server on each backend
+ * that scales past FD_SETSIZE, and time how long the server takes to resume
+ * every game.
+ * @retval None.
+ */
+void benchStorm()
+{
+    int backends[] = {BACKEND_EPOLL, BACKEND_URING};
+    printf("%-9s %8s %8s %9s %9s %11s\n", "backend", "backlog", "clients", "resumed", "seconds", "slowest ms");
+    int i;
+    for (i = 0; i < 2; i++)
+    {
+        double seconds;
+        double slowestMs;
+        int resumed = benchStormServer(backends[i], BENCH_STORM_CLIENTS, &seconds, &slowestMs);
+        printf("%-9s %8d %8d %9d %9.2f %11.0f\n", globBackendNames[backends[i]], globListenBacklog, BENCH_STORM_CLIENTS, resumed, seconds, slowestMs);
+    }
+}
+
+/**
+ * Time choosing and placing the server's move in every reachable position
+ * where it is the server's turn, BENCH_MOVE_ROUNDS times over, at each
+ * difficulty and with the first free square scan the tables replaced.
+ * @retval None.
+ */
+void benchMoves()
+{
+    //Collect the positions the server can be asked to move in
+    struct tttBoard *positions = malloc(POSITIONS * sizeof(struct tttBoard));
+    if (positions == NULL)
+    {
+        perror("Error allocating benchmark positions");
+        exit(-1);
+    }
+    int count = 0;
+    unsigned short client, server;
+    for (client = 0; client <= FULL_BOARD; client++)
+    {
+        for (server = 0; server <= FULL_BOARD; server++)
+        {
+            positions[count].client = client;
+            positions[count].server = server;
+            if ((client & server) == 0 && __builtin_popcount(client) > __builtin_popcount(server) &&
+                lookupMove(&positions[count], 0) != 0)
+            {
+                count++;
+            }
+        }
+    }
+
+    printf("%d positions solved up to symmetry, %d with the server to move\n", globSolvedPositions, count);
+    const char *methods[] = {"scan", "perfect", "greedy", "random", "blunder"};
+    int difficulties[] = {0, DIFFICULTY_PERFECT, DIFFICULTY_GREEDY, DIFFICULTY_RANDOM, DIFFICULTY_PERFECT};
+    int blunderRates[] = {0, 0, 0, 0, 10};
+    printf("%-8s %12s %10s\n", "method", "moves", "ns/move");
+    int method;
+    for (method = 0; method < 5; method++)
+    {
+        volatile int sink = 0;
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        int round, i;
+        for (round = 0; round < BENCH_MOVE_ROUNDS; round++)
+        {
+            for (i = 0; i < count; i++)
+            {
+                struct tttBoard board = positions[i];
+                if (method == 0)
+                {
+                    sink += placeMove(&board, firstFreeSquare(&board), SERVER_PLAYER);
+                }
+                else
+                {
+                    sink += placeServerMove(&board, difficulties[method], blunderRates[method]);
+                }
+            }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+        long long moves = (long long)BENCH_MOVE_ROUNDS * count;
+        printf("%-8s %12lld %10.2f\n", methods[method], moves, ns / moves);
+    }
+    free(positions);
+}
+
+/**
+ * Compare the canonical position table with the table of every board
+ * encoding it replaced, and with the move index served from: memory, and time
+ * to find the perfect move in every position where it is the server's turn,
+ * BENCH_SYMMETRY_ROUNDS times over. The index is counted on top of the
+ * canonical table it is built from.
+ * @retval None.
+ */
+void benchSymmetry()
+{
+    //Rebuild the full table: a base 3 index per board and a move per index
+    unsigned short ternary[1 << SQUARES];
+    unsigned char *fullMoves = calloc(POSITIONS, 1);
+    struct tttBoard *positions = malloc(POSITIONS * sizeof(struct tttBoard));
+    if (fullMoves == NULL || positions == NULL)
+    {
+        perror("Error allocating benchmark positions");
+        exit(-1);
+    }
+    int mask, square;
+    for (mask = 0; mask <= FULL_BOARD; mask++)
+    {
+        int place = 1;
+        ternary[mask] = 0;
+        for (square = 0; square < SQUARES; square++)
+        {
+            if (mask & (1 << square))
+            {
+                ternary[mask] += place;
+            }
+            place *= 3;
+        }
+    }
+    int count = 0;
+    unsigned short client, server;
+    for (client = 0; client <= FULL_BOARD; client++)
+    {
+        for (server = 0; server <= FULL_BOARD; server++)
+        {
+            positions[count].client = client;
+            positions[count].server = server;
+            int move = (client & server) == 0 ? canonicalMove(&positions[count], 0) : 0;
+            if (move != 0)
+            {
+                fullMoves[ternary[client] + 2 * ternary[server]] = move;
+                if (__builtin_popcount(client) > __builtin_popcount(server))
+                {
+                    count++;
+                }
+            }
+        }
+    }
+
+    //The full table held a score, a perfect move and a greedy move per encoding
+    size_t fullBytes = sizeof(ternary) + 3 * POSITIONS;
+    size_t canonicalBytes = sizeof(globPositions) + sizeof(globTransformSquare) + sizeof(globTransformMask) + sizeof(globInverseTransform);
+    size_t indexBytes = canonicalBytes + sizeof(globTernary) + sizeof(globMoveIndex);
+    const char *tables[] = {"full", "canonical", "index"};
+    size_t tableBytes[] = {fullBytes, canonicalBytes, indexBytes};
+    printf("%d positions solved up to symmetry in %d slots, %d with the server to move\n", globSolvedPositions, POSITION_SLOTS, count);
+    printf("%-10s %12s %12s %10s\n", "table", "bytes", "lookups", "ns/lookup");
+    int method;
+    for (method = 0; method < 3; method++)
+    {
+        volatile int sink = 0;
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        int round, i;
+        for (round = 0; round < BENCH_SYMMETRY_ROUNDS; round++)
+        {
+            for (i = 0; i < count; i++)
+            {
+                if (method == 0)
+                {
+                    sink += fullMoves[ternary[positions[i].client] + 2 * ternary[positions[i].server]];
+                }
+                else if (method == 1)
+                {
+                    sink += canonicalMove(&positions[i], 0);
+                }
+                else
+                {
+                    sink += lookupMove(&positions[i], 0);
+                }
+            }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+        long long lookups = (long long)BENCH_SYMMETRY_ROUNDS * count;
+        printf("%-10s %12zu %12lld %10.2f\n", tables[method], tableBytes[method], lookups, ns / lookups);
+    }
+    free(fullMoves);
+    free(positions);
+}
+
+/**
+ * Search the same 19x19 k=5 position for BENCH_SEARCH_MS at 1, 2, 4, 8 and 16
+ * threads, each from an empty transposition table, and compare nodes per
+ * second and the depth finished with the single thread search.
+ * @retval None.
+ */
+void benchParallel()
+{
+    //A few stones from an opening, client to server alternately
+    int opening[] = {181, 182, 162, 200, 163, 143, 201, 161};
+    struct mnkBoard *board = createMnkBoard(MAX_MNK_SIDE, MAX_MNK_SIDE, 5);
+    if (board == NULL)
+    {
+        perror("Error allocating benchmark board");
+        exit(-1);
+    }
+    int i;
+    for (i = 0; i < (int)(sizeof(opening) / sizeof(opening[0])); i++)
+    {
+        mnkPlace(board, opening[i], i % 2 == 0 ? CLIENT_PLAYER : SERVER_PLAYER);
+    }
+    startSearchHelpers(BENCH_SEARCH_THREADS - 1);
+
+    printf("%-8s %12s %12s %8s %6s\n", "threads", "nodes", "nodes/s", "speedup", "depth");
+    double singleRate = 0;
+    int threads;
+    for (threads = 1; threads <= BENCH_SEARCH_THREADS; threads *= 2)
+    {
+        memset(globTransposition, 0, (globTranspositionMask + 1) * sizeof(struct transpositionEntry));
+        long long startMs = currentTimeMs();
+        int depth;
+        long long nodes;
+        int move = mnkSearchMove(board, BENCH_SEARCH_MS, threads, &depth, &nodes);
+        double rate = nodes * 1000.0 / (currentTimeMs() - startMs);
+        if (threads == 1)
+        {
+            singleRate = rate;
+        }
+        printf("%-8d %12lld %12.0f %7.2fx %6d   move %d\n", threads, nodes, rate, rate / singleRate, depth, move);
+    }
+    free(board);
+}
+
+/**
+ * Evaluate BENCH_EVALUATE_BOARDS random boards BENCH_EVALUATE_ROUNDS times
+ * with checkWin one board at a time and with each batch kernel the CPU
+ * supports, checking every kernel agrees with the scalar one.
+ * @retval None.
+ */
+void benchEvaluate()
+{
+    struct tttBoard *boards = malloc(BENCH_EVALUATE_BOARDS * sizeof(struct tttBoard));
+    struct boardStatus *results = malloc(BENCH_EVALUATE_BOARDS * sizeof(struct boardStatus));
+    struct boardStatus *expected = malloc(BENCH_EVALUATE_BOARDS * sizeof(struct boardStatus));
+    if (boards == NULL || results == NULL || expected == NULL)
+    {
+        perror("Error allocating benchmark boards");
+        exit(-1);
+    }
+    globRandomState = (unsigned int)currentTimeMs() | 1;
+    int i;
+    for (i = 0; i < BENCH_EVALUATE_BOARDS; i++)
+    {
+        boards[i].client = nextRandom() & FULL_BOARD;
+        boards[i].server = nextRandom() & FULL_BOARD & ~boards[i].client;
+    }
+    evaluateBoardsScalar(boards, expected, BENCH_EVALUATE_BOARDS);
+
+    const char *names[] = {"checkWin", "scalar", "sse2", "avx2"};
+    void (*kernels[])(const struct tttBoard *, struct boardStatus *, int) = {
+        NULL, evaluateBoardsScalar,
+#if defined(__x86_64__) || defined(__i386__)
+        evaluateBoardsSse2, evaluateBoardsAvx2
+#else
+        NULL, NULL
+#endif
+    };
+    int supported[] = {1, 1, 0, 0};
+#if defined(__x86_64__) || defined(__i386__)
+    supported[2] = __builtin_cpu_supports("sse2");
+    supported[3] = __builtin_cpu_supports("avx2");
+#endif
+
+    printf("Batch evaluation chosen at startup: %s\n", globEvaluateKernel);
+    printf("%-9s %12s %10s %14s %10s\n", "kernel", "boards", "ns/board", "boards/s", "mismatches");
+    int kernel;
+    for (kernel = 0; kernel < 4; kernel++)
+    {
+        if (!supported[kernel])
+        {
+            printf("%-9s unsupported by this CPU\n", names[kernel]);
+            continue;
+        }
+        volatile int sink = 0;
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        int round;
+        for (round = 0; round < BENCH_EVALUATE_ROUNDS; round++)
+        {
+            if (kernel == 0)
+            {
+                for (i = 0; i < BENCH_EVALUATE_BOARDS; i++)
+                {
+                    sink += checkWin(&boards[i], CLIENT_PLAYER);
+                }
+            }
+            else
+            {
+                (*kernels[kernel])(boards, results, BENCH_EVALUATE_BOARDS);
+                sink += results[round % BENCH_EVALUATE_BOARDS].status;
+            }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        int mismatches = 0;
+        for (i = 0; kernel > 0 && i < BENCH_EVALUATE_BOARDS; i++)
+        {
+            if (results[i].status != expected[i].status || results[i].legal != expected[i].legal)
+            {
+                mismatches++;
+            }
+        }
+        double ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+        long long evaluated = (long long)BENCH_EVALUATE_ROUNDS * BENCH_EVALUATE_BOARDS;
+        printf("%-9s %12lld %10.2f %14.0f %10d\n", names[kernel], evaluated, ns / evaluated, evaluated / ns * 1e9, mismatches);
+    }
+    free(boards);
+    free(results);
+    free(expected);
+}
+
+/**
+ * Queue BENCH_REPLY_BATCH replies to a game on one end of a loopback
+ * connection, flush them and read them off the other end, BENCH_REPLY_ROUNDS
+ * times, for compact and legacy clients. Queueing is also timed on its own. "rebuild" is the old reply path: clear the
+ * message fields, build the frame in a scratch buffer (a legacy one zero
+ * padded to MESSAGE_SIZE) and copy it into the output, sent with one send.
+ * "fields" writes the fields into the output with queueReply, as m,n,k and
+ * token replies still are, and "template" copies the reply's template with
+ * queueTemplate. "live" is sendMessage, which looks the game up, stores the
+ * fields for retransmission and queues the template. Legacy records are
+ * patched into already padded frames by flushOutput.
+ * @retval None.
+ */
+void benchReplies()
+{
+    //A loopback TCP connection, so sends take the path they take for real clients
+    struct sockaddr_in address;
+    socklen_t addressLength = sizeof(address);
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    int sockets[2];
+    sockets[1] = socket(AF_INET, SOCK_STREAM, 0);
+    if (listener == -1 || sockets[1] == -1 || bind(listener, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(listener, 1) != 0 ||
+        getsockname(listener, (struct sockaddr *)&address, &addressLength) != 0 || connect(sockets[1], (struct sockaddr *)&address, sizeof(address)) != 0 ||
+        (sockets[0] = accept(listener, NULL, NULL)) == -1)
+    {
+        perror("Error connecting benchmark sockets");
+        exit(-1);
+    }
+    close(listener);
+    globBackend = &epollBackend;
+    globShardMaxGames = 1;
+    initGamePool();
+    initGameIndexes();
+    int gameNumber = acquireGameSlot();
+    struct tttGame *clientGame = getGame(gameNumber);
+    (*clientGame).gameNumber = gameNumber;
+    (*clientGame).connectedSocket = sockets[0];
+    (*clientGame).active = 1;
+    indexGame(gameNumber);
+    unsigned char drain[BENCH_REPLY_BATCH * MESSAGE_SIZE];
+
+    printf("%-8s %-9s %12s %12s %12s %12s\n", "client", "path", "replies", "queue ns", "total ns", "bytes/reply");
+    int version, method;
+    for (version = LEGACY_VERSION; version <= COMPACT_VERSION; version++)
+    {
+        for (method = 0; method < 4; method++)
+        {
+            (*clientGame).clientVersion = version;
+            long long bytes = 0;
+            double queueNs = 0;
+            struct timespec start, end, queueStart, queueEnd;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            int round, i;
+            for (round = 0; round < BENCH_REPLY_ROUNDS; round++)
+            {
+                int expected = 0;
+                clock_gettime(CLOCK_MONOTONIC, &queueStart);
+                for (i = 0; i < BENCH_REPLY_BATCH; i++)
+                {
+                    if (method == 0)
+                    {
+                        expected += benchRebuildReply(clientGame, i % SQUARES + 1, round * 2 + 1);
+                    }
+                    else if (method == 1)
+                    {
+                        expected += benchFieldsReply(clientGame, i % SQUARES + 1, round * 2 + 1);
+                    }
+                    else if (method == 2)
+                    {
+                        queueTemplate(clientGame, version < COMPACT_VERSION, i % SQUARES + 1, GAME_IN_PROGRESS, 0, protocolGameNumber(gameNumber), round * 2 + 1);
+                        expected += version < COMPACT_VERSION ? MESSAGE_SIZE : COMPACT_REPLY_SIZE;
+                    }
+                    else
+                    {
+                        sendMessage(MOVE_COMMAND, i % SQUARES + 1, GAME_IN_PROGRESS, 0, gameNumber, round * 2 + 1, sockets[0], (*clientGame).lastMessage);
+                        expected += version < COMPACT_VERSION ? MESSAGE_SIZE : COMPACT_REPLY_SIZE;
+                    }
+                }
+                clock_gettime(CLOCK_MONOTONIC, &queueEnd);
+                queueNs += (queueEnd.tv_sec - queueStart.tv_sec) * 1e9 + (queueEnd.tv_nsec - queueStart.tv_nsec);
+                (*clientGame).flushQueued = 0;
+                flushOutput(clientGame);
+                while (expected > 0)
+                {
+                    int got = recv(sockets[1], drain, expected, 0);
+                    if (got <= 0)
+                    {
+                        perror("Error reading benchmark replies");
+                        exit(-1);
+                    }
+                    expected -= got;
+                    bytes += got;
+                }
+            }
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            double ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+            long long replies = (long long)BENCH_REPLY_ROUNDS * BENCH_REPLY_BATCH;
+            printf("%-8s %-9s %12lld %12.1f %12.1f %12lld\n", version < COMPACT_VERSION ? "legacy" : "compact", method == 0 ? "rebuild" : method == 1 ? "fields" : method == 2 ? "template" : "live",
+                   replies, queueNs / replies, ns / replies, bytes / replies);
+        }
+    }
+    close(sockets[0]);
+    close(sockets[1]);
+    globPendingFlushCount = 0;
+}
+
+/**
+ * Queue a reply the way sendMessage did before replies were written in place.
+ * @param  *clientGame: The game; its socket is looked up as the old path did.
+ * @param  move: The move to send.
+ * @param  sequenceNumber: The sequence number to send.
+ * @retval Bytes queued.
+ */
+int benchRebuildReply(struct tttGame *clientGame, int move, unsigned char sequenceNumber)
+{
+    unsigned char *messageStore = (*clientGame).lastMessage;
+    findGameBySocket((*clientGame).connectedSocket);
+    memset(messageStore, 0, MESSAGE_FIELDS);
+    messageStore[0] = (*clientGame).clientVersion >= COMPACT_VERSION ? COMPACT_VERSION : LEGACY_VERSION;
+    messageStore[1] = move;
+    messageStore[2] = GAME_IN_PROGRESS;
+    messageStore[3] = 0;
+    messageStore[4] = MOVE_COMMAND;
+    messageStore[5] = protocolGameNumber((*clientGame).gameNumber);
+    messageStore[6] = sequenceNumber;
+
+    unsigned char wire[MESSAGE_SIZE];
+    int wireLength = encodeFrame(messageStore, REPLY_FIELDS, wire);
+    (*clientGame).outLegacy = 0;
+    unsigned char *space = reserveOutput(clientGame, wireLength);
+    if (space != NULL)
+    {
+        memcpy(space, wire, wireLength);
+    }
+    return wireLength;
+}
+
+/**
+ * Queue a reply the way sendMessage did before classic replies had templates.
+ * @param  *clientGame: The game.
+ * @param  move: The move to send.
+ * @param  sequenceNumber: The sequence number to send.
+ * @retval Bytes the reply takes on the wire.
+ */
+int benchFieldsReply(struct tttGame *clientGame, int move, unsigned char sequenceNumber)
+{
+    unsigned char *messageStore = (*clientGame).lastMessage;
+    int compact = (*clientGame).clientVersion >= COMPACT_VERSION;
+    messageStore[0] = compact ? COMPACT_VERSION : LEGACY_VERSION;
+    messageStore[1] = move;
+    messageStore[2] = GAME_IN_PROGRESS;
+    messageStore[3] = 0;
+    messageStore[4] = MOVE_COMMAND;
+    messageStore[5] = protocolGameNumber((*clientGame).gameNumber);
+    messageStore[6] = sequenceNumber;
+    messageStore[MOVE_HIGH_FIELD] = 0;
+    queueReply(clientGame, messageStore, REPLY_FIELDS);
+    return compact ? COMPACT_REPLY_SIZE : MESSAGE_SIZE;
+}
+
+/**
+ * Start a server on a backend, open every client's connection at once and
+ * wait for each reconnected game's first reply.
+ * @param  backendType: The backend the server uses.
+ * @param  clients: Clients reconnecting.
+ * @param  *seconds: Set to the time until the last game resumed.
+ * @param  *slowestMs: Set to the longest time one client waited.
+ * @retval Games resumed without error.
+ */
+int benchStormServer(int backendType, int clients, double *seconds, double *slowestMs)
+{
+    struct rusage usage;
+    pid_t server = benchStartServer(backendType);
+
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    struct benchClient *storm = malloc(clients * sizeof(struct benchClient));
+    if (epollFd == -1 || storm == NULL)
+    {
+        perror("Error: Problem starting benchmark clients");
+        benchStopServer(server, &usage);
+        exit(-1);
+    }
+
+    long long startMs = currentTimeMs();
+    int finished = 0;
+    int resumed = 0;
+    int i;
+    for (i = 0; i < clients; i++)
+    {
+        if (benchConnect(&storm[i], epollFd, 1) != 0)
+        {
+            close(storm[i].connectedSocket);
+            storm[i].connectedSocket = -1;
+            finished++;
+        }
+    }
+
+    *slowestMs = 0;
+    struct epoll_event events[MAX_READY_EVENTS];
+    while (finished < clients)
+    {
+        int readyCount = epoll_wait(epollFd, events, MAX_READY_EVENTS, BENCH_IDLE_MS);
+        if (readyCount == 0)
+        {
+            fprintf(stderr, "Benchmark stalled with %d clients waiting\n", clients - finished);
+            break;
+        }
+        for (i = 0; i < readyCount; i++)
+        {
+            struct benchClient *client = events[i].data.ptr;
+            int result = benchReadable(client);
+            if (result == 0)
+            {
+                continue;
+            }
+            finished++;
+            resumed += result > 0;
+            close((*client).connectedSocket);
+            (*client).connectedSocket = -1;
+            if (currentTimeMs() - (*client).startMs > *slowestMs)
+            {
+                *slowestMs = currentTimeMs() - (*client).startMs;
+            }
+        }
+    }
+    *seconds = (currentTimeMs() - startMs) / 1000.0;
+
+    //Close whatever is left before the next server starts
+    for (i = 0; i < clients; i++)
+    {
+        if (storm[i].connectedSocket >= 0)
+        {
+            close(storm[i].connectedSocket);
+        }
+    }
+    close(epollFd);
+    free(storm);
+    benchStopServer(server, &usage);
+    return resumed;
+}
+
+/**
+ * Fork a single worker server on globServerPort with its output discarded.
+ * @param  backendType: The backend the server uses.
+ * @retval The server's process id; exit(-1) if error.
+ */
+pid_t benchStartServer(int backendType)
+{
+    fflush(stdout);
+    pid_t server = fork();
+    if (server == -1)
+    {
+        perror("Error: Problem starting benchmark server");
+        exit(-1);
+    }
+    if (server == 0)
+    {
+        if (freopen("/dev/null", "w", stdout) == NULL)
+        {
+            exit(-1);
+        }
+        globBackendType = backendType;
+        globWorkerCount = 1;
+        runWorker((void *)0);
+    }
+
+    //Wait until the server accepts connections
+    struct sockaddr_in serverAddress;
+    serverAddress.sin_family = AF_INET;
+    serverAddress.sin_port = htons(globServerPort);
+    serverAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int connected = -1;
+    while (connected != 0)
+    {
+        usleep(10000);
+        int status;
+        if (waitpid(server, &status, WNOHANG) == server)
+        {
+            fprintf(stderr, "Error: Benchmark server exited\n");
+            exit(-1);
+        }
+        int probe = socket(AF_INET, SOCK_STREAM, 0);
+        connected = connect(probe, (struct sockaddr *)&serverAddress, sizeof(serverAddress));
+        close(probe);
+    }
+    return server;
+}
+
+/**
+ * Stop a benchmark server and collect its resource usage.
+ * @param  server: The server's process id.
+ * @param  *usage: Set to the server's resource usage.
+ * @retval None.
+ */
+void benchStopServer(pid_t server, struct rusage *usage)
+{
+    int status;
+    kill(server, SIGKILL);
+    wait4(server, &status, 0, usage);
+}
+
+/**
+ * Open a non-blocking connection for a new game and watch it.
+ * @param  *client: The client to reset.
+ * @param  epollFd: The load generator's epoll instance.
+ * @param  reconnect: 1 to open with a RECONNECT instead of a NEW_GAME.
+ * @retval 0 on success; -1 on error.
+ */
+int benchConnect(struct benchClient *client, int epollFd, int reconnect)
+{
+    struct sockaddr_in serverAddress;
+    serverAddress.sin_family = AF_INET;
+    serverAddress.sin_port = htons(globServerPort);
+    serverAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    (*client).connectedSocket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    initSharedState(&(*client).board);
+    (*client).sequenceNumber = 1;
+    (*client).state = BENCH_CONNECTING;
+    (*client).reconnect = reconnect;
+    (*client).startMs = currentTimeMs();
+    (*client).inLength = 0;
+    if (connect((*client).connectedSocket, (struct sockaddr *)&serverAddress, sizeof(serverAddress)) != 0 && errno != EINPROGRESS)
+    {
+        return -1;
+    }
+
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLOUT | EPOLLET;
+    event.data.ptr = client;
+    return epoll_ctl(epollFd, EPOLL_CTL_ADD, (*client).connectedSocket, &event);
+}
+
+/**
+ * Send a compact frame from a benchmark client.
+ * @retval None.
+ */
+void benchSend(struct benchClient *client, int move, int complete, int completeDescriptor, int command)
+{
+    unsigned char fields[MESSAGE_FIELDS];
+    unsigned char wire[MESSAGE_SIZE];
+    memset(fields, 0, MESSAGE_FIELDS);
+    fields[0] = COMPACT_VERSION;
+    fields[1] = move;
+    fields[2] = complete;
+    fields[3] = completeDescriptor;
+    fields[4] = command;
+    fields[5] = (*client).gameNumber;
+    fields[6] = (*client).sequenceNumber;
+    int wireLength = encodeFrame(fields, REPLY_FIELDS, wire);
+    send((*client).connectedSocket, wire, wireLength, MSG_NOSIGNAL);
+}
+
+/**
+ * Send a RECONNECT for a game where the client took the center square.
+ * @retval None.
+ */
+void benchSendReconnect(struct benchClient *client)
+{
+    unsigned char fields[MESSAGE_FIELDS];
+    unsigned char wire[MESSAGE_SIZE];
+    memset(fields, 0, MESSAGE_FIELDS);
+    fields[0] = COMPACT_VERSION;
+    fields[4] = RECONNECT_COMMAND;
+    fields[7 + 4] = 1;
+    int wireLength = encodeFrame(fields, RECONNECT_FIELDS, wire);
+    send((*client).connectedSocket, wire, wireLength, MSG_NOSIGNAL);
+}
+
+/**
+ * Advance a benchmark client on a reply from the server: place the server's
+ * move and answer with the lowest free square, or acknowledge the end.
+ * @param  *client: The client.
+ * @param  fields[MESSAGE_FIELDS]: The reply.
+ * A reconnecting client is done once its game is resumed.
+ * @retval 0 while the game goes on; 1 when it is over; -1 on an error reply.
+ */
+int benchReply(struct benchClient *client, unsigned char fields[MESSAGE_FIELDS])
+{
+    if (fields[2] == GAME_ERROR)
+    {
+        return -1;
+    }
+    if ((*client).state == BENCH_DONE || (*client).state == BENCH_RECONNECT)
+    {
+        return 1;
+    }
+    if ((*client).state == BENCH_NEW_GAME)
+    {
+        (*client).gameNumber = fields[5];
+        (*client).state = BENCH_PLAYING;
+    }
+    else
+    {
+        placeMove(&(*client).board, fields[1], SERVER_PLAYER);
+        if (fields[2] == GAME_COMPLETE)
+        {
+            (*client).sequenceNumber += 2;
+            benchSend(client, 0, GAME_COMPLETE, fields[3], END_GAME_COMMAND);
+            return 1;
+        }
+    }
+
+    int move = 0;
+    do
+    {
+        move++;
+    } while (placeMove(&(*client).board, move, CLIENT_PLAYER) != 1);
+    int win = checkWin(&(*client).board, CLIENT_PLAYER);
+    (*client).sequenceNumber += 2;
+    if (win == -1)
+    {
+        benchSend(client, move, GAME_IN_PROGRESS, 0, MOVE_COMMAND);
+    }
+    else
+    {
+        benchSend(client, move, GAME_COMPLETE, win, MOVE_COMMAND);
+        (*client).state = BENCH_DONE;
+    }
+    return 0;
+}
+
+/**
+ * Handle readiness on a benchmark connection: start the game once connected,
+ * then read and answer every complete reply.
+ * @param  *client: The client.
+ * @retval 0 while the game goes on; 1 when it is over; -1 on error.
+ */
+int benchReadable(struct benchClient *client)
+{
+    if ((*client).state == BENCH_CONNECTING)
+    {
+        int error = 0;
+        socklen_t errorLength = sizeof(error);
+        getsockopt((*client).connectedSocket, SOL_SOCKET, SO_ERROR, &error, &errorLength);
+        if (error != 0)
+        {
+            return -1;
+        }
+        if ((*client).reconnect)
+        {
+            (*client).state = BENCH_RECONNECT;
+            benchSendReconnect(client);
+        }
+        else
+        {
+            (*client).state = BENCH_NEW_GAME;
+            benchSend(client, 0, GAME_IN_PROGRESS, 0, NEW_GAME_COMMAND);
+        }
+    }
+
+    while (1)
+    {
+        int bytesRead = recv((*client).connectedSocket, (*client).inBuffer + (*client).inLength, MESSAGE_SIZE - (*client).inLength, 0);
+        if (bytesRead < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            return 0;
+        }
+        if (bytesRead <= 0)
+        {
+            return -1;
+        }
+        (*client).inLength += bytesRead;
+
+        int frameSize = frameLength((*client).inBuffer, (*client).inLength);
+        while (frameSize > 0 && (*client).inLength >= frameSize)
+        {
+            unsigned char fields[MESSAGE_FIELDS];
+            decodeFrame((*client).inBuffer, frameSize, fields);
+            int result = benchReply(client, fields);
+            if (result != 0)
+            {
+                return result;
+            }
+            (*client).inLength -= frameSize;
+            memmove((*client).inBuffer, (*client).inBuffer + frameSize, (*client).inLength);
+            frameSize = frameLength((*client).inBuffer, (*client).inLength);
+        }
+        if (frameSize < 0)
+        {
+            return -1;
+        }
+    }
+}